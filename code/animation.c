@@ -1,216 +1,439 @@
 #include "animation.h"
+#include "frame_alloc.h"
+#include "profiler.h"
+#include "scene_arena.h"
 #include <malloc.h>
+#include <stdlib.h>
 #include <string.h>
 
-static float get_time_s() {
-    return (float)((double)get_ticks_us() / 1000000.0);
+#define ANIM_GRAPH_ANY -1            // Source of a transition valid from every state
+#define ANIM_FADE_DEFAULT -1.0f      // Transition uses the graph's default fade
+
+// Scratch skeletons for cross-fades, shared by every character
+typedef struct {
+    T3DSkeleton skeletons[ANIM_BLEND_POOL_MAX];
+    bool in_use[ANIM_BLEND_POOL_MAX];
+    int count;
+    int used;
+} AnimBlendPool;
+
+static AnimBlendPool blend_pool;
+
+// Per-frame work counters, and the measured cost of the work LOD avoids
+static AnimFrameStats frame_stats;
+static uint32_t next_lod_phase;
+#if PROFILER_ENABLED
+static uint32_t clip_update_ticks;   // Running averages, in CPU ticks
+static uint32_t skeleton_update_ticks;
+#endif
+
+typedef struct {
+    int from;
+    AnimTransition transition;
+} AnimGraphRule;
+
+static const struct {
+    const char* name;
+    uint32_t bit;
+} anim_condition_names[] = {
+    {"moving", ANIM_COND_MOVING},
+    {"running", ANIM_COND_RUNNING},
+    {"jumping", ANIM_COND_JUMPING},
+    {"jump_start", ANIM_COND_JUMP_START},
+    {"finished", ANIM_COND_FINISHED},
+};
+
+static uint32_t anim_condition_parse(const char* name, int line) {
+    for (int i = 0; i < sizeof(anim_condition_names) / sizeof(anim_condition_names[0]); i++) {
+        if (strcmp(anim_condition_names[i].name, name) == 0) return anim_condition_names[i].bit;
+    }
+    assertf(0, "Animation graph line %d: unknown condition '%s'", line, name);
+    return 0;
+}
+
+int animation_graph_find_state(const AnimGraph* graph, const char* name) {
+    for (int i = 0; i < graph->state_count; i++) {
+        if (strcmp(graph->states[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+static int anim_graph_require_state(const AnimGraph* graph, const char* name, int line) {
+    int state = name ? animation_graph_find_state(graph, name) : -1;
+    assertf(state >= 0, "Animation graph line %d: unknown state '%s'", line, name ? name : "");
+    return state;
+}
+
+// Descriptor format, one statement per line, '#' starts a comment:
+//   state <name> <clip> loop|once
+//   initial <state>
+//   fade <seconds>
+//   transition <state|any> <state> [+condition|-condition]... [fade=<seconds>]
+// Transitions are tried in file order, the first one whose conditions hold wins.
+// "fade" sets the cross-fade of the transitions that don't give their own.
+AnimGraph* animation_graph_load(const char* path) {
+    int size = 0;
+    char* text = asset_load(path, &size);
+    text = realloc(text, size + 1);
+    text[size] = '\0';
+
+    AnimGraph* graph = scene_alloc(sizeof(AnimGraph));
+    memset(graph, 0, sizeof(AnimGraph));
+    graph->states = scene_alloc(ANIM_GRAPH_MAX_STATES * sizeof(AnimGraphState));
+    graph->initial_state = -1;
+    graph->default_fade = ANIM_BLEND_DEFAULT_FADE;
+
+    AnimGraphRule* rules = malloc(ANIM_GRAPH_MAX_RULES * sizeof(AnimGraphRule));
+    int rule_count = 0;
+
+    char* line_save;
+    int line_number = 0;
+    for (char* line = strtok_r(text, "\n", &line_save); line; line = strtok_r(NULL, "\n", &line_save)) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char* save;
+        const char* keyword = strtok_r(line, " \t\r", &save);
+        if (keyword == NULL) continue;
+
+        if (strcmp(keyword, "state") == 0) {
+            const char* name = strtok_r(NULL, " \t\r", &save);
+            const char* clip = strtok_r(NULL, " \t\r", &save);
+            const char* mode = strtok_r(NULL, " \t\r", &save);
+            assertf(name && clip && mode, "Animation graph line %d: expected 'state <name> <clip> loop|once'", line_number);
+            assertf(strlen(name) < ANIM_NAME_LEN && strlen(clip) < ANIM_NAME_LEN, "Animation graph line %d: name too long", line_number);
+            assertf(graph->state_count < ANIM_GRAPH_MAX_STATES, "Animation graph line %d: too many states", line_number);
+            assertf(animation_graph_find_state(graph, name) < 0, "Animation graph line %d: duplicate state '%s'", line_number, name);
+
+            AnimGraphState* state = &graph->states[graph->state_count++];
+            memset(state, 0, sizeof(AnimGraphState));
+            strcpy(state->name, name);
+            strcpy(state->clip, clip);
+            state->loop = strcmp(mode, "loop") == 0;
+        } else if (strcmp(keyword, "initial") == 0) {
+            graph->initial_state = anim_graph_require_state(graph, strtok_r(NULL, " \t\r", &save), line_number);
+        } else if (strcmp(keyword, "fade") == 0) {
+            const char* seconds = strtok_r(NULL, " \t\r", &save);
+            assertf(seconds, "Animation graph line %d: expected 'fade <seconds>'", line_number);
+            graph->default_fade = strtof(seconds, NULL);
+        } else if (strcmp(keyword, "transition") == 0) {
+            const char* from = strtok_r(NULL, " \t\r", &save);
+            const char* to = strtok_r(NULL, " \t\r", &save);
+            assertf(from && to, "Animation graph line %d: expected 'transition <from> <to>'", line_number);
+            assertf(rule_count < ANIM_GRAPH_MAX_RULES, "Animation graph line %d: too many transitions", line_number);
+
+            AnimGraphRule* rule = &rules[rule_count++];
+            memset(rule, 0, sizeof(AnimGraphRule));
+            rule->from = strcmp(from, "any") == 0 ? ANIM_GRAPH_ANY : anim_graph_require_state(graph, from, line_number);
+            rule->transition.target = anim_graph_require_state(graph, to, line_number);
+            rule->transition.fade = ANIM_FADE_DEFAULT;
+
+            for (const char* cond = strtok_r(NULL, " \t\r", &save); cond; cond = strtok_r(NULL, " \t\r", &save)) {
+                if (strncmp(cond, "fade=", 5) == 0) {
+                    rule->transition.fade = strtof(cond + 5, NULL);
+                    continue;
+                }
+                assertf(cond[0] == '+' || cond[0] == '-', "Animation graph line %d: condition '%s' needs + or -", line_number, cond);
+                uint32_t bit = anim_condition_parse(cond + 1, line_number);
+                if (cond[0] == '+') rule->transition.require |= bit;
+                else rule->transition.forbid |= bit;
+            }
+        } else {
+            assertf(0, "Animation graph line %d: unknown keyword '%s'", line_number, keyword);
+        }
+    }
+    free(text);
+
+    assertf(graph->state_count > 0, "Animation graph %s has no states", path);
+    if (graph->initial_state < 0) graph->initial_state = 0;
+    for (int r = 0; r < rule_count; r++) {
+        if (rules[r].transition.fade < 0.0f) rules[r].transition.fade = graph->default_fade;
+    }
+
+    // Flatten into one transition list per state, so an update only walks
+    // the rules that can fire from where it is. "any" rules never target
+    // the state they are merged into, that would restart it every tick.
+    graph->transitions = scene_alloc(rule_count * graph->state_count * sizeof(AnimTransition));
+    for (int s = 0; s < graph->state_count; s++) {
+        AnimGraphState* state = &graph->states[s];
+        state->first_transition = graph->transition_count;
+        for (int r = 0; r < rule_count; r++) {
+            bool applies = rules[r].from == s ||
+                           (rules[r].from == ANIM_GRAPH_ANY && rules[r].transition.target != s);
+            if (applies) graph->transitions[graph->transition_count++] = rules[r].transition;
+        }
+        state->transition_count = graph->transition_count - state->first_transition;
+    }
+    free(rules);
+
+    //debugf("Animation graph %s: %d states, %d transitions\n", path, graph->state_count, graph->transition_count);
+    return graph;
 }
 
-void animation_system_init(AnimationSystem* anim_sys, T3DModel* model) {
+void animation_system_init(AnimationSystem* anim_sys, const AnimGraph* graph, T3DModel* model) {
     // Check for null pointers first
-    if (anim_sys == NULL || model == NULL) {
-        //debugf("Error: null animation system or model pointer\n");
+    if (anim_sys == NULL || graph == NULL || model == NULL) {
+        //debugf("Error: null animation system, graph or model pointer\n");
         return;
     }
-    
-    // Initialize animation system
-    anim_sys->anim_count = t3d_model_get_animation_count(model);
-    anim_sys->current_anim = -1;
-    anim_sys->walk_anim_index = -1;
-    anim_sys->run_anim_index = -1;
-    anim_sys->idle_anim_index = -1;
-    anim_sys->jump_anim_index = -1;
-    anim_sys->last_anim_time = get_time_s();
-    anim_sys->is_moving = false;
-    anim_sys->was_moving = false;
-    anim_sys->is_jumping = false;
-    anim_sys->was_jumping = false;
-    
-    //debugf("Player model has %lu animations\n", anim_sys->anim_count);
-    
-    if (anim_sys->anim_count > 0) {
-        anim_sys->anims = malloc(anim_sys->anim_count * sizeof(void*));
-        t3d_model_get_animations(model, anim_sys->anims);
-        
-        // Create animation instances
-        anim_sys->anim_instances = malloc(anim_sys->anim_count * sizeof(T3DAnim));
-        for (int i = 0; i < anim_sys->anim_count; i++) {
-            anim_sys->anim_instances[i] = t3d_anim_create(model, anim_sys->anims[i]->name);
-            //debugf("Animation %d: %s\n", i, anim_sys->anims[i]->name);
-            
-            // Verify animation was created successfully
-            if (anim_sys->anim_instances[i].animRef == NULL) {
-                //debugf("Failed to create animation %d: %s\n", i, anim_sys->anims[i]->name);
-                continue;
-            }
-            
-            // Find the walk animation
-            if (strcmp(anim_sys->anims[i]->name, "Walk") == 0) {
-                anim_sys->walk_anim_index = i;
-                //debugf("Found Walk animation at index %d\n", i);
-            }
-            // Find the run animation
-            else if (strcmp(anim_sys->anims[i]->name, "Run") == 0) {
-                anim_sys->run_anim_index = i;
-                //debugf("Found Run animation at index %d\n", i);
-            }
-            // Find the idle animation
-            else if (strcmp(anim_sys->anims[i]->name, "Idle") == 0) {
-                anim_sys->idle_anim_index = i;
-                //debugf("Found Idle animation at index %d\n", i);
-            }
-            // Find the jump animation
-            else if (strcmp(anim_sys->anims[i]->name, "Jump") == 0) {
-                anim_sys->jump_anim_index = i;
-                //debugf("Found Jump animation at index %d\n", i);
-            }
+
+    anim_sys->graph = graph;
+    anim_sys->current_state = -1;
+    anim_sys->last_conditions = 0;
+    anim_sys->priority = ANIM_PRIORITY_LOW;
+    anim_sys->blend_slot = -1;
+    anim_sys->blend_from_state = -1;
+    anim_sys->lod = ANIM_LOD_FULL;
+    anim_sys->lod_phase = next_lod_phase++ & 7;
+    anim_sys->tick = 0;
+    anim_sys->pending_time = 0.0f;
+    anim_sys->pose_dirty = true;
+    anim_sys->last_matrices = NULL;
+
+    // Bind every state to its clip once, so updates never look names up.
+    // A clip missing from the model leaves the state without animation,
+    // it then counts as finished straight away.
+    anim_sys->clips = scene_alloc(graph->state_count * sizeof(T3DAnim));
+    for (int i = 0; i < graph->state_count; i++) {
+        if (t3d_model_get_animation(model, graph->states[i].clip) != NULL) {
+            anim_sys->clips[i] = t3d_anim_create(model, graph->states[i].clip);
+        } else {
+            //debugf("Animation %s not found for state %s\n", graph->states[i].clip, graph->states[i].name);
+            memset(&anim_sys->clips[i], 0, sizeof(T3DAnim));
+        }
+    }
+
+    // Don't automatically start any animation during init
+    // Let the update function enter the initial state
+}
+
+void animation_blend_pool_init(const T3DSkeleton* prototype, int count) {
+    memset(&blend_pool, 0, sizeof(blend_pool));
+    if (count > ANIM_BLEND_POOL_MAX) count = ANIM_BLEND_POOL_MAX;
+
+    // Bones only, blended poses are never drawn from the scratch skeletons
+    for (int i = 0; i < count; i++) {
+        blend_pool.skeletons[i] = t3d_skeleton_clone(prototype, false);
+    }
+    blend_pool.count = count;
+}
+
+void animation_blend_pool_cleanup(void) {
+    for (int i = 0; i < blend_pool.count; i++) {
+        t3d_skeleton_destroy(&blend_pool.skeletons[i]);
+    }
+    memset(&blend_pool, 0, sizeof(blend_pool));
+}
+
+// Low priority characters leave the last slots and blends of the budget to
+// high priority ones, so the player keeps blending in a crowd
+static int anim_blend_reserve(const AnimationSystem* anim_sys) {
+    return anim_sys->priority == ANIM_PRIORITY_HIGH ? 0 : ANIM_BLEND_RESERVED;
+}
+
+static bool anim_blend_affordable(const AnimationSystem* anim_sys) {
+    return frame_stats.blends + anim_blend_reserve(anim_sys) < ANIM_BLEND_MAX_PER_FRAME;
+}
+
+static int anim_blend_acquire(const AnimationSystem* anim_sys) {
+    if (blend_pool.used + anim_blend_reserve(anim_sys) >= blend_pool.count) return -1;
+    for (int i = 0; i < blend_pool.count; i++) {
+        if (!blend_pool.in_use[i]) {
+            blend_pool.in_use[i] = true;
+            blend_pool.used++;
+            return i;
         }
-        
-        // Don't automatically start any animation during init
-        // Let the update function handle initial animation setup
-        //debugf("Animation system initialized, will start appropriate animation on first update\n");
-    } else {
-        //debugf("No animations found in player model\n");
-        anim_sys->anims = NULL;
-        anim_sys->anim_instances = NULL;
     }
+    return -1;
 }
 
-void animation_system_update(AnimationSystem* anim_sys, T3DSkeleton* skeleton, bool is_moving, bool is_jumping, bool debug_menu_active) {
+static void anim_blend_release(AnimationSystem* anim_sys) {
+    if (anim_sys->blend_slot < 0) return;
+    blend_pool.in_use[anim_sys->blend_slot] = false;
+    blend_pool.used--;
+    anim_sys->blend_slot = -1;
+    anim_sys->blend_from_state = -1;
+}
+
+static void animation_system_enter(AnimationSystem* anim_sys, T3DSkeleton* skeleton, int state, float fade) {
+    int previous = anim_sys->current_state;
+
+    // A fade still running is cut short, the new one starts from the current pose
+    anim_blend_release(anim_sys);
+
+    // Keep the outgoing clip playing on a scratch skeleton and fade from it.
+    // Without a free slot or budget left, snap like a zero-length fade.
+    if (previous >= 0 && fade > 0.0f && anim_sys->clips[previous].animRef != NULL &&
+        anim_blend_affordable(anim_sys)) {
+        int slot = anim_blend_acquire(anim_sys);
+        if (slot >= 0) {
+            T3DSkeleton* scratch = &blend_pool.skeletons[slot];
+            memcpy(scratch->bones, skeleton->bones, skeleton->skeletonRef->boneCount * sizeof(T3DBone));
+
+            T3DAnim* from = &anim_sys->clips[previous];
+            float time = from->time;
+            t3d_anim_attach(from, scratch);
+            t3d_anim_set_time(from, time);
+
+            anim_sys->blend_slot = slot;
+            anim_sys->blend_from_state = previous;
+            anim_sys->blend_time = 0.0f;
+            anim_sys->blend_duration = fade;
+        }
+    }
+
+    anim_sys->current_state = state;
+    T3DAnim* clip = &anim_sys->clips[state];
+    if (clip->animRef == NULL) return;
+
+    t3d_anim_attach(clip, skeleton);
+    t3d_anim_set_playing(clip, true);
+    t3d_anim_set_looping(clip, anim_sys->graph->states[state].loop);
+    //debugf("Entered %s animation state\n", anim_sys->graph->states[state].name);
+}
+
+void animation_system_update(AnimationSystem* anim_sys, T3DSkeleton* skeleton, uint32_t conditions, bool debug_menu_active, float delta_time) {
     // Check for null pointers first
-    if (anim_sys == NULL || skeleton == NULL) {
+    if (anim_sys == NULL || skeleton == NULL || anim_sys->graph == NULL) {
         //debugf("Error: null animation system or skeleton pointer\n");
         return;
     }
-    
+
     // Handle animation state changes - only if debug menu is not active
-    if (!debug_menu_active && anim_sys->anim_count > 0 && anim_sys->anim_instances != NULL) {
-        float new_time = get_time_s();
-        float delta_time = new_time - anim_sys->last_anim_time;
-        anim_sys->last_anim_time = new_time;
-        
-        // Update movement state
-        anim_sys->was_moving = anim_sys->is_moving;
-        anim_sys->is_moving = is_moving;
-        anim_sys->was_jumping = anim_sys->is_jumping;
-        anim_sys->is_jumping = is_jumping;
-        
-        // Jump has highest priority - check for jump first
-        if (anim_sys->is_jumping && !anim_sys->was_jumping) {
-            // Started jumping - switch to jump animation
-            if (anim_sys->jump_anim_index >= 0 && anim_sys->jump_anim_index < anim_sys->anim_count &&
-                anim_sys->anim_instances[anim_sys->jump_anim_index].animRef != NULL) {
-                // Switch to jump animation (don't loop - jump is a one-shot animation)
-                anim_sys->current_anim = anim_sys->jump_anim_index;
-                t3d_anim_attach(&anim_sys->anim_instances[anim_sys->current_anim], skeleton);
-                t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                t3d_anim_set_looping(&anim_sys->anim_instances[anim_sys->current_anim], false); // Don't loop jump
-                //debugf("Started Jump animation\n");
-            } else {
-                //debugf("Jump animation not available or invalid\n");
-            }
-        }
-        // Only handle movement animations if not jumping
-        else if (!anim_sys->is_jumping) {
-            // Movement animation logic (only when not jumping)
-            // If running, play Run animation
-            extern bool g_is_running; // Will be set in player.c
-            if (g_is_running && anim_sys->run_anim_index >= 0 && anim_sys->run_anim_index < anim_sys->anim_count &&
-                anim_sys->anim_instances[anim_sys->run_anim_index].animRef != NULL) {
-                if (anim_sys->current_anim != anim_sys->run_anim_index) {
-                    anim_sys->current_anim = anim_sys->run_anim_index;
-                    t3d_anim_attach(&anim_sys->anim_instances[anim_sys->current_anim], skeleton);
-                    t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                    t3d_anim_set_looping(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                    //debugf("Started Run animation\n");
-                }
-                // Ensure run animation keeps playing and restart if it finished
-                else if (!anim_sys->anim_instances[anim_sys->current_anim].isPlaying) {
-                    t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                    //debugf("Restarted Run animation\n");
-                }
-            } else if (anim_sys->is_moving && !anim_sys->was_moving) {
-                // Started moving - switch to walk animation
-                if (anim_sys->walk_anim_index >= 0 && anim_sys->walk_anim_index < anim_sys->anim_count &&
-                    anim_sys->anim_instances[anim_sys->walk_anim_index].animRef != NULL) {
-                    // Switch to walk animation
-                    anim_sys->current_anim = anim_sys->walk_anim_index;
-                    t3d_anim_attach(&anim_sys->anim_instances[anim_sys->current_anim], skeleton);
-                    t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                    t3d_anim_set_looping(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                    //debugf("Started Walk animation\n");
-                } else {
-                    //debugf("Walk animation not available or invalid\n");
-                }
-            } else if (!anim_sys->is_moving && anim_sys->was_moving) {
-                // Stopped moving - switch to idle animation
-                //debugf("Stopping movement, switching to idle\n");
-                if (anim_sys->idle_anim_index >= 0 && anim_sys->idle_anim_index < anim_sys->anim_count &&
-                    anim_sys->anim_instances[anim_sys->idle_anim_index].animRef != NULL) {
-                    // Switch to idle animation
-                    anim_sys->current_anim = anim_sys->idle_anim_index;
-                    t3d_anim_attach(&anim_sys->anim_instances[anim_sys->current_anim], skeleton);
-                    t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                    t3d_anim_set_looping(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                    //debugf("Started Idle animation\n");
-                } else {
-                    // No idle animation available, just stop current animation
-                    if (anim_sys->current_anim >= 0 && anim_sys->current_anim < anim_sys->anim_count) {
-                        t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], false);
-                        anim_sys->current_anim = -1;
-                    }
-                    //debugf("No idle animation available, stopped current animation\n");
-                }
-            }
-            // Initialize idle animation on first update if no movement and no current animation
-            if (anim_sys->current_anim == -1 && !anim_sys->is_moving && 
-                anim_sys->idle_anim_index >= 0 && anim_sys->idle_anim_index < anim_sys->anim_count &&
-                anim_sys->anim_instances[anim_sys->idle_anim_index].animRef != NULL) {
-                anim_sys->current_anim = anim_sys->idle_anim_index;
-                t3d_anim_attach(&anim_sys->anim_instances[anim_sys->current_anim], skeleton);
-                t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                t3d_anim_set_looping(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                //debugf("Initialized with Idle animation\n");
-            }
+    if (debug_menu_active) return;
+
+    const AnimGraph* graph = anim_sys->graph;
+    if (anim_sys->current_state < 0) {
+        animation_system_enter(anim_sys, skeleton, graph->initial_state, 0.0f);
+    }
+
+    // Derive the edge and clip conditions
+    T3DAnim* clip = &anim_sys->clips[anim_sys->current_state];
+    uint32_t bits = conditions;
+    if ((conditions & ANIM_COND_JUMPING) && !(anim_sys->last_conditions & ANIM_COND_JUMPING)) {
+        bits |= ANIM_COND_JUMP_START;
+    }
+    if (clip->animRef == NULL || !clip->isPlaying) {
+        bits |= ANIM_COND_FINISHED;
+    }
+    anim_sys->last_conditions = conditions;
+
+    // At most one transition per tick, the first match wins
+    const AnimGraphState* state = &graph->states[anim_sys->current_state];
+    const AnimTransition* transition = &graph->transitions[state->first_transition];
+    for (int i = 0; i < state->transition_count; i++, transition++) {
+        if ((bits & transition->require) == transition->require && !(bits & transition->forbid)) {
+            animation_system_enter(anim_sys, skeleton, transition->target, transition->fade);
+            clip = &anim_sys->clips[anim_sys->current_state];
+            break;
         }
-        
-        // Check if jump animation finished (only for non-looping animations)
-        if (anim_sys->current_anim == anim_sys->jump_anim_index && 
-            anim_sys->current_anim >= 0 && anim_sys->current_anim < anim_sys->anim_count &&
-            anim_sys->anim_instances != NULL &&
-            !anim_sys->anim_instances[anim_sys->current_anim].isPlaying) {
-            // Jump animation finished, return to appropriate state
-            //debugf("Jump animation finished, returning to movement state\n");
-            if (anim_sys->is_moving && anim_sys->walk_anim_index >= 0) {
-                // Return to walking
-                anim_sys->current_anim = anim_sys->walk_anim_index;
-                t3d_anim_attach(&anim_sys->anim_instances[anim_sys->current_anim], skeleton);
-                t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                t3d_anim_set_looping(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                //debugf("Returned to Walk animation after jump\n");
-            } else if (anim_sys->idle_anim_index >= 0) {
-                // Return to idle
-                anim_sys->current_anim = anim_sys->idle_anim_index;
-                t3d_anim_attach(&anim_sys->anim_instances[anim_sys->current_anim], skeleton);
-                t3d_anim_set_playing(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                t3d_anim_set_looping(&anim_sys->anim_instances[anim_sys->current_anim], true);
-                //debugf("Returned to Idle animation after jump\n");
-            }
+    }
+
+    // Far characters only advance their clips every few ticks, catching up
+    // on the skipped time in one step. Phases are staggered per character.
+    anim_sys->pending_time += delta_time;
+    uint32_t interval_mask = (1 << (anim_sys->lod < ANIM_LOD_EIGHTH ? anim_sys->lod : ANIM_LOD_EIGHTH)) - 1;
+    if ((anim_sys->tick++ + anim_sys->lod_phase) & interval_mask) {
+        frame_stats.ticks_skipped++;
+        return;
+    }
+    delta_time = anim_sys->pending_time;
+    anim_sys->pending_time = 0.0f;
+    anim_sys->pose_dirty = true;
+
+#if PROFILER_ENABLED
+    uint32_t start = TICKS_READ();
+#endif
+
+    // Update current animation - only if it has a clip still playing
+    if (clip->animRef != NULL && clip->isPlaying) {
+        t3d_anim_update(clip, delta_time);
+    }
+
+    // Cross-fade from the previous state's pose. Running out of budget
+    // mid-fade finishes it early rather than going over.
+    if (anim_sys->blend_slot >= 0) {
+        anim_sys->blend_time += delta_time;
+        if (anim_sys->blend_time >= anim_sys->blend_duration || !anim_blend_affordable(anim_sys)) {
+            anim_blend_release(anim_sys);
+        } else {
+            T3DSkeleton* scratch = &blend_pool.skeletons[anim_sys->blend_slot];
+            T3DAnim* from = &anim_sys->clips[anim_sys->blend_from_state];
+            if (from->isPlaying) t3d_anim_update(from, delta_time);
+            t3d_skeleton_blend(skeleton, scratch, skeleton, anim_sys->blend_time / anim_sys->blend_duration);
+            frame_stats.blends++;
         }
-        
-        // Update current animation - only if we have a valid active animation
-        if (anim_sys->current_anim >= 0 && anim_sys->current_anim < anim_sys->anim_count && 
-            anim_sys->anim_instances != NULL && 
-            anim_sys->anim_instances[anim_sys->current_anim].isPlaying) {
-            t3d_anim_update(&anim_sys->anim_instances[anim_sys->current_anim], delta_time);
+    }
+
+#if PROFILER_ENABLED
+    clip_update_ticks += ((int32_t)TICKS_DISTANCE(start, TICKS_READ()) - (int32_t)clip_update_ticks) / 16;
+#endif
+
+    // Bone matrices are rebuilt once per rendered frame by the owner
+    // (see animation_system_update_skeleton), not once per simulation tick
+}
+
+void animation_begin_frame(void) {
+#if PROFILER_ENABLED
+    frame_stats.saved_us = TICKS_TO_US(frame_stats.ticks_skipped * clip_update_ticks +
+                                       frame_stats.skeletons_skipped * skeleton_update_ticks);
+#endif
+    uint32_t saved_us = frame_stats.saved_us;
+    memset(&frame_stats, 0, sizeof(frame_stats));
+    frame_stats.saved_us = saved_us;   // Last frame's estimate until this one completes
+}
+
+const AnimFrameStats* animation_frame_stats(void) {
+    return &frame_stats;
+}
+
+void animation_system_set_lod(AnimationSystem* anim_sys, float camera_distance, bool visible) {
+    if (!visible) anim_sys->lod = ANIM_LOD_CULLED;
+    else if (camera_distance < ANIM_LOD_DIST_FULL) anim_sys->lod = ANIM_LOD_FULL;
+    else if (camera_distance < ANIM_LOD_DIST_HALF) anim_sys->lod = ANIM_LOD_HALF;
+    else if (camera_distance < ANIM_LOD_DIST_QUARTER) anim_sys->lod = ANIM_LOD_QUARTER;
+    else anim_sys->lod = ANIM_LOD_EIGHTH;
+}
+
+// Builds this frame's bone matrices in frame memory. Returns false for
+// culled characters, which have none and must not be drawn.
+bool animation_system_update_skeleton(AnimationSystem* anim_sys, T3DSkeleton* skeleton) {
+    frame_stats.lod_count[anim_sys->lod]++;
+    if (anim_sys->lod == ANIM_LOD_CULLED) {
+        anim_sys->last_matrices = NULL;
+        frame_stats.skeletons_skipped++;
+        return false;
+    }
+
+    // Last frame's slot is still valid, so an unchanged pose is copied
+    // instead of walking the bone hierarchy again
+    T3DMat4FP* previous = anim_sys->last_matrices;
+    frame_alloc_skeleton(skeleton);
+    int bone_count = skeleton->skeletonRef->boneCount;
+    if (!anim_sys->pose_dirty && previous != NULL) {
+        memcpy(skeleton->boneMatricesFP, previous, bone_count * sizeof(T3DMat4FP));
+        for (int i = 0; i < bone_count; i++) {
+            skeleton->bones[i].hasChanged = false;
         }
-        
-        // Always update skeleton
-        t3d_skeleton_update(skeleton);
+        frame_stats.skeletons_skipped++;
     } else {
-        // No animations available or debug menu is active, just update skeleton
+#if PROFILER_ENABLED
+        uint32_t start = TICKS_READ();
+#endif
         t3d_skeleton_update(skeleton);
+#if PROFILER_ENABLED
+        skeleton_update_ticks += ((int32_t)TICKS_DISTANCE(start, TICKS_READ()) - (int32_t)skeleton_update_ticks) / 16;
+#endif
     }
+    anim_sys->pose_dirty = false;
+    anim_sys->last_matrices = skeleton->boneMatricesFP;
+    return true;
+}
+
+const char* animation_system_state_name(const AnimationSystem* anim_sys) {
+    if (anim_sys == NULL || anim_sys->graph == NULL || anim_sys->current_state < 0) return "";
+    return anim_sys->graph->states[anim_sys->current_state].name;
 }
 
 void animation_system_cleanup(AnimationSystem* anim_sys) {
@@ -219,25 +442,16 @@ void animation_system_cleanup(AnimationSystem* anim_sys) {
         //debugf("Error: null animation system pointer\n");
         return;
     }
-    
-    // Cleanup animation system
-    if (anim_sys->anim_instances) {
-        for (int i = 0; i < anim_sys->anim_count; i++) {
-            t3d_anim_destroy(&anim_sys->anim_instances[i]);
+
+    // Cleanup animation system. The graph is shared and freed by its owner.
+    anim_blend_release(anim_sys);
+    if (anim_sys->clips) {
+        for (int i = 0; i < anim_sys->graph->state_count; i++) {
+            if (anim_sys->clips[i].animRef != NULL) t3d_anim_destroy(&anim_sys->clips[i]);
         }
-        free(anim_sys->anim_instances);
-        anim_sys->anim_instances = NULL;
-    }
-    
-    if (anim_sys->anims) {
-        free(anim_sys->anims);
-        anim_sys->anims = NULL;
-    }
-    
-    anim_sys->anim_count = 0;
-    anim_sys->current_anim = -1;
-    anim_sys->walk_anim_index = -1;
-    anim_sys->run_anim_index = -1;
-    anim_sys->idle_anim_index = -1;
-    anim_sys->jump_anim_index = -1;
-}
\ No newline at end of file
+        anim_sys->clips = NULL;
+    }
+
+    anim_sys->graph = NULL;
+    anim_sys->current_state = -1;
+}
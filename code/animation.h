@@ -8,25 +8,127 @@
 #include <t3d/t3dskeleton.h>
 #include <t3d/t3danim.h>
 
+#define ANIM_NAME_LEN 16
+#define ANIM_GRAPH_MAX_STATES 32
+#define ANIM_GRAPH_MAX_RULES 64
+
+// Cross-fades borrow a scratch skeleton from a pool shared by every character
+#define ANIM_BLEND_POOL_MAX 8
+#define ANIM_BLEND_POOL_SIZE 4        // Cross-fades in flight at once
+#define ANIM_BLEND_MAX_PER_FRAME 6    // Skeleton blends per rendered frame
+#define ANIM_BLEND_RESERVED 1         // Slots and blends only high priority characters may use
+#define ANIM_BLEND_DEFAULT_FADE 0.15f // Seconds, unless the graph says otherwise
+
+// Animation LOD distances from the camera, in world units
+#define ANIM_LOD_DIST_FULL 250.0f
+#define ANIM_LOD_DIST_HALF 400.0f
+#define ANIM_LOD_DIST_QUARTER 500.0f      // Beyond this, the far plane
+
+// Conditions a transition can require or forbid. The owner passes the
+// first three every tick; the others are derived by the state machine.
+typedef enum {
+    ANIM_COND_MOVING     = 1 << 0,
+    ANIM_COND_RUNNING    = 1 << 1,
+    ANIM_COND_JUMPING    = 1 << 2,
+    ANIM_COND_JUMP_START = 1 << 3,   // Jumping this tick but not the last
+    ANIM_COND_FINISHED   = 1 << 4,   // The state's one-shot clip has ended
+} AnimCondition;
+
+typedef enum {
+    ANIM_PRIORITY_LOW = 0,           // Snaps between states once the blend budget runs low
+    ANIM_PRIORITY_HIGH,              // May use the reserved part of the budget
+} AnimPriority;
+
+// Clips of a character advance every 1, 2, 4 or 8 ticks (60/30/15/7.5 Hz
+// at 60 ticks per second). Culled characters advance at the lowest rate
+// and skip their bone matrices entirely.
+typedef enum {
+    ANIM_LOD_FULL = 0,
+    ANIM_LOD_HALF,
+    ANIM_LOD_QUARTER,
+    ANIM_LOD_EIGHTH,
+    ANIM_LOD_CULLED,
+    ANIM_LOD_COUNT
+} AnimLod;
+
+// Work done and avoided this frame, for the profiler
+typedef struct {
+    uint32_t blends;                 // Skeleton cross-fade blends
+    uint32_t lod_count[ANIM_LOD_COUNT];
+    uint32_t ticks_skipped;          // Clip updates deferred by LOD
+    uint32_t skeletons_skipped;      // Bone matrix rebuilds avoided
+    uint32_t saved_us;               // Estimated from measured costs, profiler builds only
+} AnimFrameStats;
+
+typedef struct {
+    uint8_t target;
+    uint8_t require;                 // All of these conditions must hold...
+    uint8_t forbid;                  // ...and none of these
+    float fade;                      // Cross-fade length in seconds, 0 snaps
+} AnimTransition;
+
 typedef struct {
-    uint32_t anim_count;
-    T3DChunkAnim **anims;
-    T3DAnim *anim_instances;
-    int current_anim;
-    int walk_anim_index;
-    int run_anim_index;
-    int idle_anim_index;
-    int jump_anim_index;
-    float last_anim_time;
-    bool is_moving;
-    bool was_moving;
-    bool is_jumping;
-    bool was_jumping;
+    char name[ANIM_NAME_LEN];
+    char clip[ANIM_NAME_LEN];        // Animation name in the model
+    bool loop;
+    uint16_t first_transition;       // Slice of AnimGraph::transitions, in priority order
+    uint16_t transition_count;
+} AnimGraphState;
+
+// Immutable state machine description, shared by every character using it.
+// Loaded from a text descriptor (see assets/player3.anim).
+typedef struct {
+    AnimGraphState* states;
+    int state_count;
+    AnimTransition* transitions;     // Per-state lists, "any" rules already merged in
+    int transition_count;
+    int initial_state;
+    float default_fade;
+} AnimGraph;
+
+// Per-character playback state
+typedef struct {
+    const AnimGraph* graph;
+    T3DAnim* clips;                  // One instance per graph state
+    int current_state;               // -1 before the first update
+    uint32_t last_conditions;
+    AnimPriority priority;
+
+    // Level of detail, see animation_system_set_lod()
+    AnimLod lod;
+    uint8_t lod_phase;               // Staggers reduced-rate updates across characters
+    uint32_t tick;
+    float pending_time;              // Time not yet applied to the clips
+    bool pose_dirty;                 // Bones changed since the matrices were last built
+    T3DMat4FP* last_matrices;        // Last frame's bone matrices, reused while the pose holds
+
+    // Cross-fade from blend_from_state, whose clip plays on a pool skeleton
+    int blend_slot;                  // -1 when not fading
+    int blend_from_state;
+    float blend_time;
+    float blend_duration;
 } AnimationSystem;
 
+// Animation graph functions. Graphs live in the scene arena and go away
+// with the scene.
+AnimGraph* animation_graph_load(const char* path);
+int animation_graph_find_state(const AnimGraph* graph, const char* name);
+
+// Blend pool functions. Scratch skeletons are cloned from the prototype,
+// so every character sharing the pool needs the same skeleton layout.
+void animation_blend_pool_init(const T3DSkeleton* prototype, int count);
+void animation_blend_pool_cleanup(void);
+
+// Once per rendered frame, before the simulation ticks
+void animation_begin_frame(void);
+const AnimFrameStats* animation_frame_stats(void);
+
 // Animation system functions
-void animation_system_init(AnimationSystem* anim_sys, T3DModel* model);
-void animation_system_update(AnimationSystem* anim_sys, T3DSkeleton* skeleton, bool is_moving, bool is_jumping, bool debug_menu_active);
+void animation_system_init(AnimationSystem* anim_sys, const AnimGraph* graph, T3DModel* model);
+void animation_system_update(AnimationSystem* anim_sys, T3DSkeleton* skeleton, uint32_t conditions, bool debug_menu_active, float delta_time);
+void animation_system_set_lod(AnimationSystem* anim_sys, float camera_distance, bool visible);
+bool animation_system_update_skeleton(AnimationSystem* anim_sys, T3DSkeleton* skeleton);
+const char* animation_system_state_name(const AnimationSystem* anim_sys);
 void animation_system_cleanup(AnimationSystem* anim_sys);
 
 #endif
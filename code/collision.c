@@ -0,0 +1,344 @@
+#include "collision.h"
+#include "scene_arena.h"
+#include <math.h>
+#include <string.h>
+
+#define COLLISION_MAX_SUBSTEPS 8      // Limits sweep cost for very fast moves
+#define COLLISION_RESOLVE_PASSES 2    // Relaxation passes per substep for corners
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// The baked file is big-endian like the N64, only host builds swap it
+static void collision_swap(CollisionHeader* header) {
+    uint32_t* words = (uint32_t*)header;
+    uint32_t word_count = sizeof(CollisionHeader) / 4;
+    for (uint32_t i = 1; i < word_count; i++) words[i] = __builtin_bswap32(words[i]);
+
+    word_count += header->tri_count * (sizeof(CollisionTri) / 4) + header->grid_w * header->grid_h + 1;
+    for (uint32_t i = sizeof(CollisionHeader) / 4; i < word_count; i++) words[i] = __builtin_bswap32(words[i]);
+
+    uint16_t* indices = (uint16_t*)(words + word_count);
+    for (uint32_t i = 0; i < header->index_count; i++) indices[i] = __builtin_bswap16(indices[i]);
+}
+#endif
+
+void collision_init(CollisionWorld* world, const char* path) {
+    int size = 0;
+    CollisionHeader* header = scene_alloc_file(path, &size);
+    assertf(memcmp(header->magic, COLLISION_MAGIC, 4) == 0, "Bad collision file: %s", path);
+    collision_init_in_place(world, header);
+}
+
+// Grid data already in memory, e.g. embedded in a level file; the caller keeps it alive
+void collision_init_in_place(CollisionWorld* world, CollisionHeader* header) {
+    world->header = header;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    collision_swap(world->header);
+#endif
+    assertf(memcmp(world->header->magic, COLLISION_MAGIC, 4) == 0 &&
+            world->header->version == COLLISION_VERSION,
+            "Bad collision data");
+
+    world->tris = (const CollisionTri*)(world->header + 1);
+    world->cell_start = (const uint32_t*)(world->tris + world->header->tri_count);
+    world->cell_tris = (const uint16_t*)(world->cell_start + world->header->grid_w * world->header->grid_h + 1);
+    world->tri_stamp = scene_alloc(world->header->tri_count * sizeof(uint16_t));
+    memset(world->tri_stamp, 0, world->header->tri_count * sizeof(uint16_t));
+    world->stamp = 0;
+}
+
+void collision_cleanup(CollisionWorld* world) {
+    // Scene arena memory
+    world->tri_stamp = NULL;
+    world->header = NULL;
+}
+
+static uint16_t collision_next_stamp(CollisionWorld* world) {
+    if (++world->stamp == 0) {
+        memset(world->tri_stamp, 0, world->header->tri_count * sizeof(uint16_t));
+        world->stamp = 1;
+    }
+    return world->stamp;
+}
+
+static bool collision_cell(const CollisionWorld* world, float x, float z, int* cx, int* cz) {
+    const CollisionHeader* h = world->header;
+    *cx = (int)floorf((x - h->origin_x) / h->cell_size);
+    *cz = (int)floorf((z - h->origin_z) / h->cell_size);
+    return *cx >= 0 && *cz >= 0 && *cx < (int)h->grid_w && *cz < (int)h->grid_h;
+}
+
+static bool point_in_tri_xz(const CollisionTri* tri, float x, float z) {
+    const T3DVec3* a = &tri->v[0];
+    const T3DVec3* b = &tri->v[1];
+    const T3DVec3* c = &tri->v[2];
+    float d0 = (b->x - a->x) * (z - a->z) - (b->z - a->z) * (x - a->x);
+    float d1 = (c->x - b->x) * (z - b->z) - (c->z - b->z) * (x - b->x);
+    float d2 = (a->x - c->x) * (z - c->z) - (a->z - c->z) * (x - c->x);
+    bool has_neg = d0 < 0.0f || d1 < 0.0f || d2 < 0.0f;
+    bool has_pos = d0 > 0.0f || d1 > 0.0f || d2 > 0.0f;
+    return !(has_neg && has_pos);
+}
+
+bool collision_ground_height(CollisionWorld* world, float x, float z, float max_y, float* out_y) {
+    int cx, cz;
+    if (!collision_cell(world, x, z, &cx, &cz)) return false;
+
+    uint32_t cell = cz * world->header->grid_w + cx;
+    bool found = false;
+    float best = 0.0f;
+
+    for (uint32_t i = world->cell_start[cell]; i < world->cell_start[cell + 1]; i++) {
+        const CollisionTri* tri = &world->tris[world->cell_tris[i]];
+        if (tri->normal.y < COLLISION_FLOOR_MIN_NY) continue;
+        if (!point_in_tri_xz(tri, x, z)) continue;
+
+        float y = (tri->d - tri->normal.x * x - tri->normal.z * z) / tri->normal.y;
+        if (y <= max_y && (!found || y > best)) {
+            best = y;
+            found = true;
+        }
+    }
+
+    if (found) *out_y = best;
+    return found;
+}
+
+// Two-sided Moller-Trumbore
+static bool ray_vs_tri(const T3DVec3* origin, const T3DVec3* dir, const CollisionTri* tri, float* t) {
+    T3DVec3 e1, e2, p, s, q;
+    t3d_vec3_diff(&e1, &tri->v[1], &tri->v[0]);
+    t3d_vec3_diff(&e2, &tri->v[2], &tri->v[0]);
+    t3d_vec3_cross(&p, dir, &e2);
+
+    float det = t3d_vec3_dot(&e1, &p);
+    if (fabsf(det) < 1e-8f) return false;
+    float inv_det = 1.0f / det;
+
+    t3d_vec3_diff(&s, origin, &tri->v[0]);
+    float u = t3d_vec3_dot(&s, &p) * inv_det;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    t3d_vec3_cross(&q, &s, &e1);
+    float v = t3d_vec3_dot(dir, &q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    *t = t3d_vec3_dot(&e2, &q) * inv_det;
+    return *t >= 0.0f;
+}
+
+// Clips the ray to the grid slab [0, size] along one axis, in grid units
+static bool clip_axis(float p, float d, float size, float* t_min, float* t_max) {
+    if (fabsf(d) < 1e-12f) return p >= 0.0f && p <= size;
+    float t0 = -p / d;
+    float t1 = (size - p) / d;
+    if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+    if (t0 > *t_min) *t_min = t0;
+    if (t1 < *t_max) *t_max = t1;
+    return *t_min <= *t_max;
+}
+
+bool collision_raycast(CollisionWorld* world, const T3DVec3* origin, const T3DVec3* dir, float max_distance, CollisionHit* hit) {
+    const CollisionHeader* h = world->header;
+    float inv_cell = 1.0f / h->cell_size;
+    float gx = (origin->x - h->origin_x) * inv_cell;
+    float gz = (origin->z - h->origin_z) * inv_cell;
+
+    float t_enter = 0.0f, t_exit = max_distance;
+    if (!clip_axis(gx, dir->x * inv_cell, h->grid_w, &t_enter, &t_exit)) return false;
+    if (!clip_axis(gz, dir->z * inv_cell, h->grid_h, &t_enter, &t_exit)) return false;
+
+    // Walk the cells the ray crosses in order (Amanatides & Woo)
+    int cx = (int)floorf(gx + dir->x * inv_cell * t_enter);
+    int cz = (int)floorf(gz + dir->z * inv_cell * t_enter);
+    if (cx >= (int)h->grid_w) cx = h->grid_w - 1;
+    if (cz >= (int)h->grid_h) cz = h->grid_h - 1;
+    if (cx < 0) cx = 0;
+    if (cz < 0) cz = 0;
+
+    int step_x = dir->x > 0.0f ? 1 : -1;
+    int step_z = dir->z > 0.0f ? 1 : -1;
+    float delta_x = dir->x != 0.0f ? fabsf(h->cell_size / dir->x) : INFINITY;
+    float delta_z = dir->z != 0.0f ? fabsf(h->cell_size / dir->z) : INFINITY;
+    float next_x = dir->x != 0.0f ? (h->origin_x + (cx + (step_x > 0)) * h->cell_size - origin->x) / dir->x : INFINITY;
+    float next_z = dir->z != 0.0f ? (h->origin_z + (cz + (step_z > 0)) * h->cell_size - origin->z) / dir->z : INFINITY;
+
+    uint16_t stamp = collision_next_stamp(world);
+    const CollisionTri* best_tri = NULL;
+    float best_t = max_distance;
+
+    while (true) {
+        uint32_t cell = cz * h->grid_w + cx;
+        for (uint32_t i = world->cell_start[cell]; i < world->cell_start[cell + 1]; i++) {
+            uint16_t index = world->cell_tris[i];
+            if (world->tri_stamp[index] == stamp) continue;
+            world->tri_stamp[index] = stamp;
+
+            float t;
+            if (ray_vs_tri(origin, dir, &world->tris[index], &t) && t < best_t) {
+                best_t = t;
+                best_tri = &world->tris[index];
+            }
+        }
+
+        // A hit inside this cell can't be beaten by cells further along
+        float cell_exit = next_x < next_z ? next_x : next_z;
+        if ((best_tri && best_t <= cell_exit) || cell_exit > t_exit) break;
+
+        if (next_x < next_z) {
+            cx += step_x;
+            next_x += delta_x;
+            if (cx < 0 || cx >= (int)h->grid_w) break;
+        } else {
+            cz += step_z;
+            next_z += delta_z;
+            if (cz < 0 || cz >= (int)h->grid_h) break;
+        }
+    }
+
+    if (!best_tri) return false;
+    if (hit) {
+        hit->distance = best_t;
+        hit->point = (T3DVec3){{origin->x + dir->x * best_t, origin->y + dir->y * best_t, origin->z + dir->z * best_t}};
+        hit->normal = best_tri->normal;
+        if (t3d_vec3_dot(&hit->normal, dir) > 0.0f) t3d_vec3_scale(&hit->normal, &hit->normal, -1.0f);
+    }
+    return true;
+}
+
+// Closest point on a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+static void closest_point_on_tri(const T3DVec3* p, const CollisionTri* tri, T3DVec3* out) {
+    const T3DVec3* a = &tri->v[0];
+    const T3DVec3* b = &tri->v[1];
+    const T3DVec3* c = &tri->v[2];
+    T3DVec3 ab, ac, ap, bp, cp;
+    t3d_vec3_diff(&ab, b, a);
+    t3d_vec3_diff(&ac, c, a);
+    t3d_vec3_diff(&ap, p, a);
+
+    float d1 = t3d_vec3_dot(&ab, &ap);
+    float d2 = t3d_vec3_dot(&ac, &ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) { *out = *a; return; }
+
+    t3d_vec3_diff(&bp, p, b);
+    float d3 = t3d_vec3_dot(&ab, &bp);
+    float d4 = t3d_vec3_dot(&ac, &bp);
+    if (d3 >= 0.0f && d4 <= d3) { *out = *b; return; }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        float v = d1 / (d1 - d3);
+        *out = (T3DVec3){{a->x + ab.x * v, a->y + ab.y * v, a->z + ab.z * v}};
+        return;
+    }
+
+    t3d_vec3_diff(&cp, p, c);
+    float d5 = t3d_vec3_dot(&ab, &cp);
+    float d6 = t3d_vec3_dot(&ac, &cp);
+    if (d6 >= 0.0f && d5 <= d6) { *out = *c; return; }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        float w = d2 / (d2 - d6);
+        *out = (T3DVec3){{a->x + ac.x * w, a->y + ac.y * w, a->z + ac.z * w}};
+        return;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        *out = (T3DVec3){{b->x + (c->x - b->x) * w, b->y + (c->y - b->y) * w, b->z + (c->z - b->z) * w}};
+        return;
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    float v = vb * denom;
+    float w = vc * denom;
+    *out = (T3DVec3){{a->x + ab.x * v + ac.x * w, a->y + ab.y * v + ac.y * w, a->z + ab.z * v + ac.z * w}};
+}
+
+// Pushes the capsule out of every wall and ceiling it overlaps. The capsule
+// is approximated by spheres spaced at most one radius apart along its axis.
+static bool capsule_resolve(CollisionWorld* world, const CollisionCapsule* capsule, T3DVec3* position, T3DVec3* contact_normal) {
+    const CollisionHeader* h = world->header;
+    float r = capsule->radius;
+    float span = capsule->height - 2.0f * r;
+    if (span < 0.0f) span = 0.0f;
+    int sphere_count = (int)ceilf(span / r) + 1;
+
+    int x0, z0, x1, z1;
+    collision_cell(world, position->x - r, position->z - r, &x0, &z0);
+    collision_cell(world, position->x + r, position->z + r, &x1, &z1);
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= (int)h->grid_w) x1 = h->grid_w - 1;
+    if (z1 >= (int)h->grid_h) z1 = h->grid_h - 1;
+
+    bool touched = false;
+    uint16_t stamp = collision_next_stamp(world);
+
+    for (int cz = z0; cz <= z1; cz++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            uint32_t cell = cz * h->grid_w + cx;
+            for (uint32_t i = world->cell_start[cell]; i < world->cell_start[cell + 1]; i++) {
+                uint16_t index = world->cell_tris[i];
+                if (world->tri_stamp[index] == stamp) continue;
+                world->tri_stamp[index] = stamp;
+
+                const CollisionTri* tri = &world->tris[index];
+                if (tri->normal.y >= COLLISION_FLOOR_MIN_NY) continue;
+                bool is_wall = tri->normal.y > -COLLISION_FLOOR_MIN_NY;
+
+                for (int s = 0; s < sphere_count; s++) {
+                    float offset = sphere_count > 1 ? span * s / (sphere_count - 1) : 0.0f;
+                    T3DVec3 center = {{position->x, position->y + r + offset, position->z}};
+
+                    float plane_dist = t3d_vec3_dot(&tri->normal, &center) - tri->d;
+                    if (fabsf(plane_dist) >= r) continue;
+
+                    T3DVec3 closest, push;
+                    closest_point_on_tri(&center, tri, &closest);
+                    t3d_vec3_diff(&push, &center, &closest);
+                    if (is_wall) push.y = 0.0f;   // Walls never lift or sink the capsule
+
+                    float dist = t3d_vec3_len(&push);
+                    if (dist >= r) continue;
+                    if (dist > 1e-4f) {
+                        t3d_vec3_scale(&push, &push, 1.0f / dist);
+                    } else {
+                        push = tri->normal;
+                        if (is_wall) push.y = 0.0f;
+                        dist = 0.0f;
+                    }
+
+                    float depth = r - dist + COLLISION_SKIN;
+                    position->x += push.x * depth;
+                    position->y += push.y * depth;
+                    position->z += push.z * depth;
+                    if (contact_normal) *contact_normal = push;
+                    touched = true;
+                }
+            }
+        }
+    }
+    return touched;
+}
+
+bool collision_sweep_capsule(CollisionWorld* world, const CollisionCapsule* capsule, T3DVec3* position, const T3DVec3* motion, T3DVec3* contact_normal) {
+    // Sub-step so no step moves further than half a radius and tunnels through a wall
+    int steps = (int)ceilf(t3d_vec3_len(motion) / (capsule->radius * 0.5f));
+    if (steps < 1) steps = 1;
+    if (steps > COLLISION_MAX_SUBSTEPS) steps = COLLISION_MAX_SUBSTEPS;
+
+    T3DVec3 step;
+    t3d_vec3_scale(&step, motion, 1.0f / steps);
+
+    bool touched = false;
+    for (int i = 0; i < steps; i++) {
+        t3d_vec3_add(position, position, &step);
+        for (int pass = 0; pass < COLLISION_RESOLVE_PASSES; pass++) {
+            if (!capsule_resolve(world, capsule, position, contact_normal)) break;
+            touched = true;
+        }
+    }
+    return touched;
+}
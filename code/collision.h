@@ -0,0 +1,69 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <libdragon.h>
+#include <t3d/t3dmath.h>
+
+// Static level collision baked by tools/gltf_collision.py into a uniform XZ
+// grid of triangle lists. The file is used in place after loading.
+#define COLLISION_MAGIC "COLL"
+#define COLLISION_VERSION 1
+
+#define COLLISION_FLOOR_MIN_NY 0.7f   // Triangles facing up more than this are walkable floor
+#define COLLISION_SKIN 0.5f           // Gap kept between shapes and walls after resolution
+
+typedef struct {
+    T3DVec3 v[3];
+    T3DVec3 normal;
+    float d;                          // Plane: dot(normal, p) == d
+} CollisionTri;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t tri_count;
+    uint32_t index_count;
+    uint32_t grid_w;
+    uint32_t grid_h;
+    float cell_size;
+    float origin_x;
+    float origin_z;
+} CollisionHeader;
+
+typedef struct {
+    CollisionHeader* header;          // Grid data in the scene arena, the arrays below point into it
+    const CollisionTri* tris;
+    const uint32_t* cell_start;       // grid_w * grid_h + 1 offsets into cell_tris
+    const uint16_t* cell_tris;
+    uint16_t* tri_stamp;              // Visits triangles shared by several cells once per query
+    uint16_t stamp;
+} CollisionWorld;
+
+// Vertical capsule standing on its base point
+typedef struct {
+    float radius;
+    float height;
+} CollisionCapsule;
+
+typedef struct {
+    T3DVec3 point;
+    T3DVec3 normal;
+    float distance;
+} CollisionHit;
+
+// Collision world functions
+void collision_init(CollisionWorld* world, const char* path);
+void collision_init_in_place(CollisionWorld* world, CollisionHeader* header);
+void collision_cleanup(CollisionWorld* world);
+
+// Highest floor at (x, z) that is not above max_y
+bool collision_ground_height(CollisionWorld* world, float x, float z, float max_y, float* out_y);
+
+// Closest hit along dir (normalized) within max_distance
+bool collision_raycast(CollisionWorld* world, const T3DVec3* origin, const T3DVec3* dir, float max_distance, CollisionHit* hit);
+
+// Moves the capsule by motion, sliding along walls and ceilings. Floors are
+// left to collision_ground_height(). Returns true if anything was touched.
+bool collision_sweep_capsule(CollisionWorld* world, const CollisionCapsule* capsule, T3DVec3* position, const T3DVec3* motion, T3DVec3* contact_normal);
+
+#endif // COLLISION_H
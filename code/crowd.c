@@ -0,0 +1,284 @@
+#include "crowd.h"
+#include "frame_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define CROWD_MODEL_SCALE 1.22f      // Same rig and scale as the player
+
+// Own generator so spawning doesn't disturb rand() (seeded by replays)
+static uint32_t crowd_random(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float crowd_random_float(uint32_t* state) {
+    return (crowd_random(state) & 0xFFFF) / 65535.0f;
+}
+
+void crowd_init(Crowd* crowd, const MeshLod* mesh_lod, const T3DSkeleton* prototype, const char* const* clip_names, int clip_count) {
+    memset(crowd, 0, sizeof(Crowd));
+    crowd->mesh_lod = mesh_lod;
+    crowd->model = mesh_lod->levels[0];
+    T3DModel* model = crowd->model;
+    crowd->walk_clip = -1;
+
+    // Clips the crowd can play, missing ones are skipped
+    for (int i = 0; i < clip_count && crowd->clip_count < CROWD_MAX_CLIPS; i++) {
+        if (t3d_model_get_animation(model, clip_names[i]) == NULL) {
+            //debugf("Crowd: no animation %s\n", clip_names[i]);
+            continue;
+        }
+        if (strcmp(clip_names[i], "Walk") == 0) crowd->walk_clip = crowd->clip_count;
+        T3DAnim* clip = &crowd->clips[crowd->clip_count++];
+        *clip = t3d_anim_create(model, clip_names[i]);
+        t3d_anim_set_looping(clip, true);
+    }
+
+    // Bones only, matrices come from the frame allocator
+    for (int i = 0; i < CROWD_MAX_POSES; i++) {
+        crowd->pose_skeletons[i] = t3d_skeleton_clone(prototype, false);
+    }
+}
+
+// Adds an instance standing on the floor; spots outside the level are skipped
+static void crowd_place(Crowd* crowd, CollisionWorld* collision, const T3DVec3* position, float rotation_y,
+                        int clip, uint32_t* seed) {
+    CrowdInstance* inst = &crowd->instances[crowd->count];
+    inst->position = *position;
+    if (collision) {
+        float floor_y;
+        if (!collision_ground_height(collision, inst->position.x, inst->position.z,
+                                     inst->position.y + CROWD_CULL_HEIGHT, &floor_y)) {
+            return;
+        }
+        inst->position.y = floor_y;
+    }
+
+    inst->prev_position = inst->position;
+    inst->rotation_y = rotation_y;
+    inst->clip = clip;
+    inst->pacing = inst->clip == crowd->walk_clip;
+    inst->pace_timer = CROWD_PACE_TIME * crowd_random_float(seed);
+    inst->time = crowd_random_float(seed) * crowd->clips[inst->clip].animRef->duration;
+    crowd->count++;
+}
+
+void crowd_spawn_along(Crowd* crowd, CollisionWorld* collision, const T3DVec3* start, const T3DVec3* direction, int count, float spacing) {
+    if (crowd->clip_count == 0) return;
+
+    uint32_t seed = 0x5EED;
+    T3DVec3 side = {{-direction->z, 0.0f, direction->x}};
+    for (int i = 0; i < count && crowd->count < CROWD_MAX_INSTANCES; i++) {
+        float along = spacing * (i + 1);
+        float across = (crowd_random_float(&seed) - 0.5f) * 160.0f;
+        T3DVec3 position = {{
+            start->x + direction->x * along + side.x * across,
+            start->y,
+            start->z + direction->z * along + side.z * across,
+        }};
+        float rotation_y = crowd_random_float(&seed) * 2.0f * M_PI;
+        crowd_place(crowd, collision, &position, rotation_y, crowd_random(&seed) % crowd->clip_count, &seed);
+    }
+    crowd->active = CROWD_STRESS ? (crowd->count < CROWD_STRESS_STEP ? crowd->count : CROWD_STRESS_STEP) : crowd->count;
+}
+
+// Placement from the level file; unknown clips fall back to the first one
+void crowd_spawn_at(Crowd* crowd, CollisionWorld* collision, const T3DVec3* position, float rotation_y, const char* clip_name) {
+    if (crowd->clip_count == 0 || crowd->count == CROWD_MAX_INSTANCES) return;
+
+    int clip = 0;
+    for (int i = 0; i < crowd->clip_count; i++) {
+        if (strcmp(crowd->clips[i].animRef->name, clip_name) == 0) clip = i;
+    }
+    uint32_t seed = 0x5EED + crowd->count;
+    crowd_place(crowd, collision, position, rotation_y, clip, &seed);
+    crowd->active = crowd->count;
+}
+
+void crowd_update(Crowd* crowd, float delta_time) {
+    for (int i = 0; i < crowd->active; i++) {
+        CrowdInstance* inst = &crowd->instances[i];
+        inst->prev_position = inst->position;
+
+        float duration = crowd->clips[inst->clip].animRef->duration;
+        inst->time += delta_time;
+        if (inst->time >= duration) inst->time = fmodf(inst->time, duration);
+
+        // Walkers pace back and forth on the spot they spawned
+        if (inst->pacing) {
+            inst->position.x += sinf(inst->rotation_y) * CROWD_WALK_SPEED * delta_time;
+            inst->position.z -= cosf(inst->rotation_y) * CROWD_WALK_SPEED * delta_time;
+            inst->pace_timer -= delta_time;
+            if (inst->pace_timer <= 0.0f) {
+                inst->pace_timer += CROWD_PACE_TIME;
+                inst->rotation_y += M_PI;
+                if (inst->rotation_y >= 2 * M_PI) inst->rotation_y -= 2 * M_PI;
+            }
+        }
+    }
+}
+
+// Returns the pose slot for a clip frame, evaluating it on first use, or
+// -1 when there is no room for it and no other frame of the clip to share
+static int crowd_pose_for(Crowd* crowd, int clip, int frame) {
+    uint32_t key = (clip << 16) | frame;
+    for (int p = 0; p < crowd->pose_count; p++) {
+        if (crowd->pose_keys[p] == key) return p;
+    }
+
+    // A new pose needs its bone matrices, with the instance matrices still
+    // to come out of the same frame slot
+    uint32_t pose_bytes = crowd->pose_skeletons[0].skeletonRef->boneCount * sizeof(T3DMat4FP);
+    uint32_t reserved = crowd->active * sizeof(T3DMat4FP);
+    if (crowd->pose_count == CROWD_MAX_POSES || frame_alloc_remaining() < pose_bytes + reserved) {
+        // Out of room: the nearest evaluated frame of the same clip will do
+        int best = -1, best_dist = 0x7FFFFFFF;
+        for (int p = 0; p < crowd->pose_count; p++) {
+            if ((int)(crowd->pose_keys[p] >> 16) != clip) continue;
+            int dist = abs((int)(crowd->pose_keys[p] & 0xFFFF) - frame);
+            if (dist < best_dist) {
+                best = p;
+                best_dist = dist;
+            }
+        }
+        return best;
+    }
+
+    int p = crowd->pose_count++;
+    crowd->pose_keys[p] = key;
+
+    T3DSkeleton* skeleton = &crowd->pose_skeletons[p];
+    T3DAnim* anim = &crowd->clips[clip];
+    t3d_anim_attach(anim, skeleton);
+    t3d_anim_set_playing(anim, true);
+    t3d_anim_set_time(anim, (float)frame / CROWD_POSE_FPS);
+    t3d_anim_update(anim, 0.0f);
+
+    frame_alloc_skeleton(skeleton);
+    t3d_skeleton_update(skeleton);
+    return p;
+}
+
+void crowd_prepare(Crowd* crowd, const T3DViewport* viewport, float alpha) {
+    crowd->pose_count = 0;
+    crowd->pose_skipped = 0;
+    crowd->visible_count = 0;
+    crowd->instance_mats = NULL;
+    if (crowd->active == 0) return;
+
+    // Cull, then find or evaluate each visible instance's pose
+    int pose_instances[CROWD_MAX_POSES] = {0};
+    for (int i = 0; i < crowd->active; i++) {
+        CrowdInstance* inst = &crowd->instances[i];
+        T3DVec3 pos;
+        t3d_vec3_lerp(&pos, &inst->prev_position, &inst->position, alpha);
+        inst->render_position = pos;
+        T3DVec3 min = {{pos.x - CROWD_CULL_RADIUS, pos.y, pos.z - CROWD_CULL_RADIUS}};
+        T3DVec3 max = {{pos.x + CROWD_CULL_RADIUS, pos.y + CROWD_CULL_HEIGHT, pos.z + CROWD_CULL_RADIUS}};
+        inst->visible = t3d_frustum_vs_aabb(&viewport->viewFrustum, &min, &max);
+        if (!inst->visible) continue;
+
+        // Better missing for a frame than playing another clip
+        int pose = crowd_pose_for(crowd, inst->clip, (int)(inst->time * CROWD_POSE_FPS));
+        if (pose < 0) {
+            inst->visible = false;
+            crowd->pose_skipped++;
+            continue;
+        }
+        inst->pose = pose;
+        T3DVec3 center = {{pos.x, pos.y + CROWD_CULL_HEIGHT * 0.5f, pos.z}};
+        float size = mesh_lod_screen_size(viewport, &center, crowd->mesh_lod->radius);
+        inst->mesh_level = mesh_lod_select(crowd->mesh_lod, inst->mesh_level, size);
+        pose_instances[inst->pose]++;
+        crowd->visible_count++;
+    }
+    if (crowd->visible_count == 0) return;
+
+    // Group visible instances by pose (counting sort), so each batch
+    // draws with one set of bone matrices
+    int pose_start[CROWD_MAX_POSES];
+    int offset = 0;
+    for (int p = 0; p < crowd->pose_count; p++) {
+        pose_start[p] = offset;
+        offset += pose_instances[p];
+    }
+
+    crowd->instance_mats = frame_alloc_mat4fp(crowd->visible_count);
+    for (int i = 0; i < crowd->active; i++) {
+        CrowdInstance* inst = &crowd->instances[i];
+        if (!inst->visible) continue;
+
+        int slot = pose_start[inst->pose]++;
+        crowd->draw_order[slot] = i;
+
+        float scale[3] = {CROWD_MODEL_SCALE, CROWD_MODEL_SCALE, CROWD_MODEL_SCALE};
+        float rotation[3] = {0.0f, inst->rotation_y + M_PI, 0.0f};
+        float position[3] = {inst->render_position.x, inst->render_position.y, inst->render_position.z};
+        t3d_mat4fp_from_srt_euler(&crowd->instance_mats[slot], scale, rotation, position);
+    }
+}
+
+void crowd_draw(Crowd* crowd, LightManager* lights) {
+    if (crowd->visible_count == 0) return;
+
+    rdpq_set_prim_color(RGBA32(255, 255, 255, 255));
+    for (int slot = 0; slot < crowd->visible_count; slot++) {
+        const CrowdInstance* inst = &crowd->instances[crowd->draw_order[slot]];
+        if (lights) {
+            const T3DVec3* pos = &inst->render_position;
+            T3DVec3 center = {{pos->x, pos->y + CROWD_CULL_HEIGHT * 0.5f, pos->z}};
+            lights_apply(lights, &center, crowd->mesh_lod->radius);
+        }
+        t3d_matrix_push(&crowd->instance_mats[slot]);
+        mesh_lod_draw_skinned(crowd->mesh_lod, inst->mesh_level, &crowd->pose_skeletons[inst->pose]);
+        t3d_matrix_pop(1);
+    }
+}
+
+void crowd_stress_frame_end(Crowd* crowd, uint32_t frame_us) {
+    if (!CROWD_STRESS || crowd->count == 0) return;
+
+    if (crowd->stress_frames == 0) crowd->stress_start = TICKS_READ();
+    crowd->stress_frames++;
+    crowd->stress_frame_us += frame_us;
+    if (frame_us > crowd->stress_max_us) crowd->stress_max_us = frame_us;
+
+    // Report this crowd size, then grow it
+    if (TICKS_DISTANCE(crowd->stress_start, TICKS_READ()) >= TICKS_FROM_MS(CROWD_STRESS_SECONDS * 1000)) {
+        debugf("CROWD %3d instances, %2d visible, %2d poses (%2d skipped): avg %5lu us, max %5lu us over %lu frames\n",
+               crowd->active, crowd->visible_count, crowd->pose_count, crowd->pose_skipped,
+               (unsigned long)(crowd->stress_frame_us / crowd->stress_frames),
+               (unsigned long)crowd->stress_max_us, (unsigned long)crowd->stress_frames);
+
+        if (crowd->active < crowd->count) {
+            crowd->active += CROWD_STRESS_STEP;
+            if (crowd->active > crowd->count) crowd->active = crowd->count;
+            for (int i = 0; i < crowd->active; i++) {
+                crowd->instances[i].prev_position = crowd->instances[i].position;
+            }
+        }
+        crowd->stress_frames = 0;
+        crowd->stress_frame_us = 0;
+        crowd->stress_max_us = 0;
+    }
+}
+
+void crowd_cleanup(Crowd* crowd) {
+    for (int i = 0; i < crowd->clip_count; i++) {
+        t3d_anim_destroy(&crowd->clips[i]);
+    }
+    crowd->clip_count = 0;
+
+    // Matrices belong to the frame allocator
+    for (int i = 0; i < CROWD_MAX_POSES; i++) {
+        crowd->pose_skeletons[i].boneMatricesFP = NULL;
+        t3d_skeleton_destroy(&crowd->pose_skeletons[i]);
+    }
+    crowd->count = 0;
+    crowd->active = 0;
+}
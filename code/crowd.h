@@ -0,0 +1,91 @@
+#ifndef CROWD_H
+#define CROWD_H
+
+#include <libdragon.h>
+#include <t3d/t3d.h>
+#include <t3d/t3dmath.h>
+#include <t3d/t3dmodel.h>
+#include <t3d/t3dskeleton.h>
+#include <t3d/t3danim.h>
+#include "collision.h"
+#include "mesh_lod.h"
+#include "lights.h"
+
+// Crowd of NPCs sharing one skinned model. Instead of a skeleton per
+// instance, every frame evaluates one pose per distinct (clip, quantized
+// time) among the visible instances, and all instances on that pose draw
+// with the same bone matrices.
+
+#define CROWD_MAX_INSTANCES 128
+#define CROWD_MAX_POSES 24           // Distinct poses evaluated per frame, fewer if frame memory runs short
+#define CROWD_MAX_CLIPS 8
+#define CROWD_POSE_FPS 15            // Clip time quantization, lower means more sharing
+#define CROWD_STRESS_SPACING 40.0f   // Distance between stress scene spawn points
+#define CROWD_CULL_RADIUS 48.0f      // Instance bounds around its feet
+#define CROWD_CULL_HEIGHT 170.0f
+#define CROWD_WALK_SPEED 60.0f       // units/s for pacing instances
+#define CROWD_PACE_TIME 2.5f         // Seconds before a pacing instance turns around
+
+// Stress scene, selectable at build time (CROWD_STRESS in the makefile).
+// Starts with CROWD_STRESS_STEP instances and adds that many every
+// CROWD_STRESS_SECONDS, logging frame times for each crowd size.
+#ifndef CROWD_STRESS
+#define CROWD_STRESS 0
+#endif
+#define CROWD_STRESS_STEP 8
+#define CROWD_STRESS_SECONDS 5
+
+typedef struct {
+    T3DVec3 position;
+    T3DVec3 prev_position;       // State at the previous tick, for render interpolation
+    T3DVec3 render_position;     // Interpolated by crowd_prepare, drawn and lit there
+    float rotation_y;
+    float time;                  // Seconds into the clip
+    float pace_timer;            // Pacing instances turn around when this runs out
+    uint8_t clip;
+    bool pacing;
+    bool visible;                // Set per frame by crowd_prepare
+    uint8_t pose;                // Pose slot this frame
+    uint8_t mesh_level;          // Mesh LOD, kept across frames for hysteresis
+} CrowdInstance;
+
+typedef struct {
+    const MeshLod* mesh_lod;     // Detail levels of the shared model
+    T3DModel* model;
+    T3DAnim clips[CROWD_MAX_CLIPS];
+    int clip_count;
+    int walk_clip;               // Clip pacing instances play, -1 if the model has none
+
+    CrowdInstance instances[CROWD_MAX_INSTANCES];
+    int count;
+    int active;                  // Instances updated and drawn, <= count
+
+    // Poses evaluated this frame, bone matrices in frame memory
+    T3DSkeleton pose_skeletons[CROWD_MAX_POSES];
+    uint32_t pose_keys[CROWD_MAX_POSES];
+    int pose_count;
+    int pose_skipped;            // Visible instances left undrawn, no pose of their clip fit
+
+    // Visible instances grouped by pose, with their model matrices
+    uint8_t draw_order[CROWD_MAX_INSTANCES];
+    T3DMat4FP* instance_mats;
+    int visible_count;
+
+    // Stress scene
+    uint32_t stress_frames;
+    uint64_t stress_frame_us;
+    uint32_t stress_max_us;
+    uint32_t stress_start;
+} Crowd;
+
+// Crowd functions
+void crowd_init(Crowd* crowd, const MeshLod* mesh_lod, const T3DSkeleton* prototype, const char* const* clip_names, int clip_count);
+void crowd_spawn_along(Crowd* crowd, CollisionWorld* collision, const T3DVec3* start, const T3DVec3* direction, int count, float spacing);
+void crowd_spawn_at(Crowd* crowd, CollisionWorld* collision, const T3DVec3* position, float rotation_y, const char* clip_name);
+void crowd_update(Crowd* crowd, float delta_time);
+void crowd_prepare(Crowd* crowd, const T3DViewport* viewport, float alpha);
+void crowd_draw(Crowd* crowd, LightManager* lights);
+void crowd_stress_frame_end(Crowd* crowd, uint32_t frame_us);
+void crowd_cleanup(Crowd* crowd);
+
+#endif // CROWD_H
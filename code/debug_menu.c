@@ -1,5 +1,5 @@
 #include "debug_menu.h"
-#include <malloc.h>
+#include "scene_arena.h"
 #include <math.h>
 
 #define STRINGIFY(x) #x
@@ -29,11 +29,11 @@ void debug_menu_init(DebugMenu* menu, Player* player) {
     // Get animation data from player model
     menu->anim_count = t3d_model_get_animation_count(player->model);
     if (menu->anim_count > 0) {
-        menu->anims = malloc(menu->anim_count * sizeof(void*));
+        menu->anims = scene_alloc(menu->anim_count * sizeof(void*));
         t3d_model_get_animations(player->model, menu->anims);
         
         // Create animation instances that work with the player's skeleton
-        menu->anim_instances = malloc(menu->anim_count * sizeof(T3DAnim));
+        menu->anim_instances = scene_alloc(menu->anim_count * sizeof(T3DAnim));
         for (int i = 0; i < menu->anim_count; i++) {
             menu->anim_instances[i] = t3d_anim_create(player->model, menu->anims[i]->name);
             // Don't attach here - we'll attach the active one in update
@@ -280,15 +280,9 @@ void debug_menu_render(DebugMenu* menu, Player* player) {
 }
 
 void debug_menu_cleanup(DebugMenu* menu) {
-    if (menu->anims) {
-        free(menu->anims);
-        menu->anims = NULL;
-    }
-    
-    if (menu->anim_instances) {
-        free(menu->anim_instances);
-        menu->anim_instances = NULL;
-    }
+    // Animation lists are scene arena memory
+    menu->anims = NULL;
+    menu->anim_instances = NULL;
     
     if (menu->anim_count > 0) {
         t3d_skeleton_destroy(&menu->skel_blend);
@@ -0,0 +1,136 @@
+#include "dynres.h"
+#include <rdpq_tex.h>
+
+static const uint16_t preset_sizes[DYNRES_PRESET_COUNT][2] = {
+    {640, 480},
+    {512, 384},
+    {320, 240},
+};
+
+static DynamicResolution dynres;
+
+static uint32_t preset_pixels(DynresPreset preset) {
+    return preset_sizes[preset][0] * preset_sizes[preset][1];
+}
+
+void dynres_init(void) {
+    dynres.preset = DYNRES_PRESET_640x480;
+    dynres.pinned = false;
+    dynres.rdp_avg_us = 0.0f;
+    dynres.over_frames = 0;
+    dynres.under_frames = 0;
+    dynres.cooldown = DYNRES_COOLDOWN_FRAMES;
+    dynres.switch_count = 0;
+    dynres.scene_offscreen = false;
+    
+    // One color buffer big enough for the largest reduced preset. Smaller
+    // presets are linear views into the same memory.
+    dynres.offscreen_color = surface_alloc(FMT_RGBA16, preset_sizes[DYNRES_PRESET_512x384][0],
+                                           preset_sizes[DYNRES_PRESET_512x384][1]);
+}
+
+static void dynres_switch(DynresPreset preset) {
+    if (preset == dynres.preset) return;
+    
+    // Rescale the running average so the next decision starts from a
+    // sensible estimate instead of the old resolution's load
+    dynres.rdp_avg_us *= (float)preset_pixels(preset) / (float)preset_pixels(dynres.preset);
+    dynres.preset = preset;
+    dynres.over_frames = 0;
+    dynres.under_frames = 0;
+    dynres.cooldown = DYNRES_COOLDOWN_FRAMES;
+    dynres.switch_count++;
+    debugf("Dynres: switched to %dx%d\n", preset_sizes[preset][0], preset_sizes[preset][1]);
+}
+
+void dynres_update(uint32_t rdp_busy_us) {
+    dynres.rdp_avg_us += ((float)rdp_busy_us - dynres.rdp_avg_us) * DYNRES_SMOOTHING;
+    
+    if (dynres.pinned) return;
+    if (dynres.cooldown > 0) {
+        dynres.cooldown--;
+        return;
+    }
+    
+    float budget_us = 1000000.0f / DYNRES_TARGET_FPS;
+    
+    // Too slow: step down after a sustained overrun
+    if (dynres.rdp_avg_us > budget_us * DYNRES_DOWN_THRESHOLD) {
+        dynres.under_frames = 0;
+        if (++dynres.over_frames >= DYNRES_DOWN_FRAMES && dynres.preset < DYNRES_PRESET_COUNT - 1) {
+            dynres_switch(dynres.preset + 1);
+        }
+        return;
+    }
+    dynres.over_frames = 0;
+    
+    // Headroom: step up only if the next preset is predicted to fit, scaling
+    // the measured cost by the pixel ratio between the two presets
+    if (dynres.preset > DYNRES_PRESET_640x480) {
+        DynresPreset higher = dynres.preset - 1;
+        float predicted_us = dynres.rdp_avg_us * (float)preset_pixels(higher) / (float)preset_pixels(dynres.preset);
+        if (predicted_us < budget_us * DYNRES_UP_THRESHOLD) {
+            if (++dynres.under_frames >= DYNRES_UP_FRAMES) {
+                dynres_switch(higher);
+            }
+        } else {
+            dynres.under_frames = 0;
+        }
+    }
+}
+
+void dynres_begin_scene(surface_t* disp, surface_t* zbuf, T3DViewport* viewport) {
+    int width = preset_sizes[dynres.preset][0];
+    int height = preset_sizes[dynres.preset][1];
+    
+    if (dynres.preset == DYNRES_PRESET_640x480) {
+        // Native resolution renders straight into the framebuffer, no blit
+        dynres.scene_offscreen = false;
+        rdpq_attach(disp, zbuf);
+    } else {
+        // The RDP shares the color image stride with the depth buffer, so the
+        // depth view is a tightly packed reuse of the display's z-buffer memory
+        dynres.scene_offscreen = true;
+        dynres.scene_color = surface_make_linear(dynres.offscreen_color.buffer, FMT_RGBA16, width, height);
+        dynres.scene_depth = surface_make_linear(zbuf->buffer, FMT_RGBA16, width, height);
+        rdpq_attach(&dynres.scene_color, &dynres.scene_depth);
+    }
+    
+    t3d_viewport_set_area(viewport, 0, 0, width, height);
+}
+
+void dynres_end_scene(surface_t* disp) {
+    if (!dynres.scene_offscreen) return;
+    
+    // Upscale the scene onto the framebuffer; anything drawn after this
+    // (HUD, text, profiler) lands at full resolution
+    rdpq_detach();
+    rdpq_attach(disp, NULL);
+    
+    rdpq_set_mode_standard();
+    rdpq_mode_filter(FILTER_BILINEAR);
+    rdpq_tex_blit(&dynres.scene_color, 0, 0, &(rdpq_blitparms_t){
+        .scale_x = (float)disp->width / dynres.scene_color.width,
+        .scale_y = (float)disp->height / dynres.scene_color.height,
+    });
+}
+
+void dynres_pin(DynresPreset preset) {
+    // Holds a preset for benchmarking; the average keeps updating
+    dynres_switch(preset);
+    dynres.pinned = true;
+}
+
+void dynres_unpin(void) {
+    dynres.pinned = false;
+    dynres.cooldown = DYNRES_COOLDOWN_FRAMES;
+}
+
+DynresPreset dynres_get_preset(void) {
+    return dynres.preset;
+}
+
+void dynres_cleanup(void) {
+    rspq_wait();
+    surface_free(&dynres.offscreen_color);
+}
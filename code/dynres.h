@@ -0,0 +1,48 @@
+#ifndef DYNRES_H
+#define DYNRES_H
+
+#include <libdragon.h>
+#include <t3d/t3d.h>
+
+// Resolution presets for the 3D scene, highest first. The HUD always
+// draws at the native display resolution.
+typedef enum {
+    DYNRES_PRESET_640x480 = 0,
+    DYNRES_PRESET_512x384,
+    DYNRES_PRESET_320x240,
+    DYNRES_PRESET_COUNT
+} DynresPreset;
+
+#define DYNRES_TARGET_FPS 30             // Frame rate the controller aims for
+#define DYNRES_SMOOTHING 0.1f            // EMA weight of the newest RDP sample
+#define DYNRES_DOWN_THRESHOLD 0.90f      // Drop a level above 90% of the budget...
+#define DYNRES_DOWN_FRAMES 15            // ...sustained for this many frames
+#define DYNRES_UP_THRESHOLD 0.75f        // Raise a level if predicted load stays below 75%...
+#define DYNRES_UP_FRAMES 90              // ...for this many frames
+#define DYNRES_COOLDOWN_FRAMES 60        // Frames to settle after any change
+
+typedef struct {
+    DynresPreset preset;         // Preset used for the current frame
+    bool pinned;                 // Controller disabled, preset held fixed
+    float rdp_avg_us;            // Smoothed RDP busy time per frame
+    int over_frames;             // Consecutive frames above the down threshold
+    int under_frames;            // Consecutive frames below the up threshold
+    int cooldown;
+    uint32_t switch_count;
+    surface_t offscreen_color;   // Backing store for reduced presets
+    surface_t scene_color;       // Views for the current frame
+    surface_t scene_depth;
+    bool scene_offscreen;
+} DynamicResolution;
+
+// Dynamic resolution functions
+void dynres_init(void);
+void dynres_update(uint32_t rdp_busy_us);
+void dynres_begin_scene(surface_t* disp, surface_t* zbuf, T3DViewport* viewport);
+void dynres_end_scene(surface_t* disp);
+void dynres_pin(DynresPreset preset);
+void dynres_unpin(void);
+DynresPreset dynres_get_preset(void);
+void dynres_cleanup(void);
+
+#endif // DYNRES_H
@@ -0,0 +1,98 @@
+#include "frame_alloc.h"
+#include <malloc.h>
+
+// Single allocator shared by every entity; the RSP reads all per-frame
+// data for a frame from the same slot.
+static FrameAllocator frame_allocator;
+
+void frame_alloc_init(uint32_t slot_size) {
+    FrameAllocator* fa = &frame_allocator;
+    
+    fa->slot_size = (slot_size + FRAME_ALLOC_ALIGN - 1) & ~(FRAME_ALLOC_ALIGN - 1);
+    fa->buffer = malloc_uncached_aligned(FRAME_ALLOC_ALIGN, fa->slot_size * DISPLAY_BUFFER_COUNT);
+    fa->offset = 0;
+    fa->slot = 0;
+    fa->high_water = 0;
+    fa->fence_waits = 0;
+    
+    for (int i = 0; i < DISPLAY_BUFFER_COUNT; i++) {
+        fa->fence_valid[i] = false;
+    }
+}
+
+void frame_alloc_begin_frame(void) {
+    FrameAllocator* fa = &frame_allocator;
+    
+    fa->slot = (fa->slot + 1) % DISPLAY_BUFFER_COUNT;
+    fa->offset = 0;
+    
+    // The slot was last filled DISPLAY_BUFFER_COUNT frames ago. Normally the
+    // RSP is long past it, since display_get already waited for that frame.
+    if (fa->fence_valid[fa->slot]) {
+        if (!rspq_syncpoint_check(fa->fences[fa->slot])) {
+            fa->fence_waits++;
+            rspq_syncpoint_wait(fa->fences[fa->slot]);
+        }
+        fa->fence_valid[fa->slot] = false;
+    }
+}
+
+void frame_alloc_end_frame(void) {
+    FrameAllocator* fa = &frame_allocator;
+    
+    // Marks the point after which the RSP no longer reads this slot
+    fa->fences[fa->slot] = rspq_syncpoint_new();
+    fa->fence_valid[fa->slot] = true;
+    
+    if (fa->offset > fa->high_water) {
+        fa->high_water = fa->offset;
+    }
+}
+
+void* frame_alloc(uint32_t size) {
+    FrameAllocator* fa = &frame_allocator;
+    
+    size = (size + FRAME_ALLOC_ALIGN - 1) & ~(FRAME_ALLOC_ALIGN - 1);
+    assertf(fa->offset + size <= fa->slot_size,
+            "Frame allocator overflow: %lu + %lu > %lu bytes",
+            (unsigned long)fa->offset, (unsigned long)size, (unsigned long)fa->slot_size);
+    
+    void* ptr = fa->buffer + fa->slot * fa->slot_size + fa->offset;
+    fa->offset += size;
+    return ptr;
+}
+
+T3DMat4FP* frame_alloc_mat4fp(int count) {
+    return frame_alloc(count * sizeof(T3DMat4FP));
+}
+
+void frame_alloc_skeleton(T3DSkeleton* skeleton) {
+    // Redirect the skeleton's bone matrices to this frame's slot. Every bone
+    // is flagged dirty so t3d_skeleton_update rewrites the whole fresh buffer.
+    int bone_count = skeleton->skeletonRef->boneCount;
+    skeleton->boneMatricesFP = frame_alloc_mat4fp(bone_count);
+    for (int i = 0; i < bone_count; i++) {
+        skeleton->bones[i].hasChanged = true;
+    }
+}
+
+// Bytes still free in this frame's slot
+uint32_t frame_alloc_remaining(void) {
+    return frame_allocator.slot_size - frame_allocator.offset;
+}
+
+uint32_t frame_alloc_get_high_water(void) {
+    return frame_allocator.high_water;
+}
+
+void frame_alloc_cleanup(void) {
+    FrameAllocator* fa = &frame_allocator;
+    
+    // Make sure nothing in flight still points into the buffer
+    rspq_wait();
+    
+    if (fa->buffer) {
+        free_uncached(fa->buffer);
+        fa->buffer = NULL;
+    }
+}
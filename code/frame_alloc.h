@@ -0,0 +1,42 @@
+#ifndef FRAME_ALLOC_H
+#define FRAME_ALLOC_H
+
+#include <libdragon.h>
+#include <t3d/t3d.h>
+#include <t3d/t3dmath.h>
+#include <t3d/t3dskeleton.h>
+
+// Number of frames that can be in flight at once. Must match the buffer
+// count passed to display_init so a slot is only reused once its frame
+// has left the RSP.
+#define DISPLAY_BUFFER_COUNT 3
+
+// Uncached bytes available per frame: the player's skeleton and the crowd's
+// instance matrices, with the rest going to crowd poses (crowd_prepare
+// evaluates only as many as still fit)
+#define FRAME_ALLOC_SIZE (48 * 1024)
+#define FRAME_ALLOC_ALIGN 16
+
+typedef struct {
+    uint8_t* buffer;                                 // Uncached backing store for all slots
+    uint32_t slot_size;
+    uint32_t offset;                                 // Bump offset inside the current slot
+    int slot;                                        // Slot being filled this frame
+    rspq_syncpoint_t fences[DISPLAY_BUFFER_COUNT];   // RSP progress marker per slot
+    bool fence_valid[DISPLAY_BUFFER_COUNT];
+    uint32_t high_water;                             // Largest per-frame usage seen
+    uint32_t fence_waits;                            // Times the CPU had to wait on a fence
+} FrameAllocator;
+
+// Frame allocator functions
+void frame_alloc_init(uint32_t slot_size);
+void frame_alloc_begin_frame(void);
+void frame_alloc_end_frame(void);
+void* frame_alloc(uint32_t size);
+T3DMat4FP* frame_alloc_mat4fp(int count);
+void frame_alloc_skeleton(T3DSkeleton* skeleton);
+uint32_t frame_alloc_remaining(void);
+uint32_t frame_alloc_get_high_water(void);
+void frame_alloc_cleanup(void);
+
+#endif // FRAME_ALLOC_H
@@ -1,59 +1,162 @@
 #include "game.h"
+#include "profiler.h"
+#include "frame_alloc.h"
+#include "dynres.h"
+#include "timestep.h"
+#include "scene_arena.h"
+#include "replay.h"
+#include "latency.h"
 #include <rdpq_tex.h>
-#include <malloc.h>
+#include <string.h>
 #include <t3d/t3dskeleton.h>
 
 TunnelScene tunnel_scene;
 
 sprite_t* tunnelTexture = NULL;
 
-void tunnel_scene_init() {
-    // Initialize lighting vectors
-    tunnel_scene.lightDirVec = (T3DVec3){{0.3f, -0.8f, 0.5f}};
-    tunnel_scene.lightDirVec2 = (T3DVec3){{-0.5f, 0.2f, -0.3f}};
+static void tunnel_scene_load_level() {
+    scene_arena_begin("tunnel");
+    
+    // Everything level-specific comes from the packed level file (assets/tunnel2.scene)
+    Level* level = &tunnel_scene.level_data;
+    level_load(level, "rom:/tunnel2.level");
+    assertf(level->segments && level->collision, "Level without segments or collision");
+    
+    // Scene lights: ambient and directionals from the level, point lights
+    // handed out per draw by the light manager
+    memcpy(tunnel_scene.colorAmbient, level->header->ambient, 4);
+    memcpy(tunnel_scene.colorDir, level->header->directional[0].color, 4);
+    memcpy(tunnel_scene.colorDir2, level->header->directional[1].color, 4);
+    tunnel_scene.lightDirVec = level->header->directional[0].direction;
+    tunnel_scene.lightDirVec2 = level->header->directional[1].direction;
     t3d_vec3_norm(&tunnel_scene.lightDirVec);
     t3d_vec3_norm(&tunnel_scene.lightDirVec2);
+    lights_init(&tunnel_scene.lights, TUNNEL_FAR_PLANE);
+    for (int i = 0; i < level->light_count; i++) {
+        const LevelLight* l = &level->lights[i];
+        lights_add(&tunnel_scene.lights, &l->position, l->color, l->radius);
+    }
     
-    // Load tunnel model
-    tunnel_scene.tunnel_model = t3d_model_load("rom:/tunnel2.t3dm");
+    // Tunnel segments are loaded on demand, see tunnel_scene_stream()
+    level_stream_init_in_place(&tunnel_scene.level, level->segments);
     tunnelTexture = NULL;  // Not needed for T3D models
-    
-    // Create display list for tunnel
-    rspq_block_begin();
-    t3d_model_draw(tunnel_scene.tunnel_model);
-    tunnel_scene.tunnelDpl = rspq_block_end();
-    
-    // Initialize player
+    collision_init_in_place(&tunnel_scene.collision, level->collision);
+}
+
+static void tunnel_scene_load_player() {
+    // Initialize player at the level's spawn point
+    Level* level = &tunnel_scene.level_data;
     player_init(&tunnel_scene.player);
-    
+    const LevelEntity* spawn = level_find_entity(level, LEVEL_ENTITY_SPAWN);
+    if (spawn) {
+        tunnel_scene.player.position = spawn->position;
+        tunnel_scene.player.rotation_y = spawn->yaw;
+        tunnel_scene.player.prev_position = spawn->position;
+        tunnel_scene.player.prev_rotation_y = spawn->yaw;
+    }
+    tunnel_scene.player.collision = &tunnel_scene.collision;
+    animation_blend_pool_init(&tunnel_scene.player.skeleton, ANIM_BLEND_POOL_SIZE);
+}
+
+static void tunnel_scene_load_crowd() {
+    // NPCs spread down the tunnel ahead of the player
+    Level* level = &tunnel_scene.level_data;
+    static const char* const crowd_clips[] = {"Idle", "Walk", "Talk", "GestureCheer", "RadioContact", "AttackIdle"};
+    crowd_init(&tunnel_scene.crowd, &tunnel_scene.player.mesh_lod, &tunnel_scene.player.skeleton,
+               crowd_clips, sizeof(crowd_clips) / sizeof(crowd_clips[0]));
+    T3DVec3 ahead = {{sinf(tunnel_scene.player.rotation_y), 0.0f, -cosf(tunnel_scene.player.rotation_y)}};
+    if (CROWD_STRESS) {
+        crowd_spawn_along(&tunnel_scene.crowd, &tunnel_scene.collision, &tunnel_scene.player.position, &ahead,
+                          CROWD_MAX_INSTANCES, CROWD_STRESS_SPACING);
+    } else {
+        for (int i = 0; i < level->entity_count; i++) {
+            const LevelEntity* e = &level->entities[i];
+            if (e->type != LEVEL_ENTITY_NPC) continue;
+            crowd_spawn_at(&tunnel_scene.crowd, &tunnel_scene.collision, &e->position, e->yaw, e->name);
+        }
+    }
+}
+
+static void tunnel_scene_load_sound() {
+    // Sound effects: the player's, plus the level's ambient emitters
+    Level* level = &tunnel_scene.level_data;
+    sfx_init(&tunnel_scene.sfx);
+    tunnel_scene.sfxStep = sfx_sample_load(&tunnel_scene.sfx, "step", false);
+    tunnel_scene.sfxJump = sfx_sample_load(&tunnel_scene.sfx, "jump", false);
+    tunnel_scene.sfxLand = sfx_sample_load(&tunnel_scene.sfx, "land", false);
+    for (int i = 0; i < level->entity_count; i++) {
+        const LevelEntity* e = &level->entities[i];
+        if (e->type != LEVEL_ENTITY_SOUND) continue;
+        int sample = sfx_sample_load(&tunnel_scene.sfx, e->name, true);
+        sfx_emitter_add(&tunnel_scene.sfx, sample, &e->position, TUNNEL_DRIP_VOLUME, TUNNEL_DRIP_RADIUS, SFX_PRIORITY_AMBIENT);
+    }
+}
+
+static void tunnel_scene_load_camera() {
     // Debug menu disabled - commented out to avoid conflicts
     // debug_menu_init(&tunnel_scene.debug_menu, &tunnel_scene.player);
     
     // Initialize third-person camera settings - Raised camera for better player centering
-    tunnel_scene.camDistance = 200.0f;  // Further back for better view
-    tunnel_scene.camHeight = 200.0f;    // Raised camera height to show less ground
-    tunnel_scene.camPos = (T3DVec3){{0.0f, tunnel_scene.camHeight, tunnel_scene.camDistance}};
-    tunnel_scene.camTarget = (T3DVec3){{0.0f, 0.0f, 0.0f}};
-    
-    // Initialize lighting colors - neutral/warm dungeon lighting
-    tunnel_scene.colorAmbient[0] = 40;   // R - slightly warmer ambient
-    tunnel_scene.colorAmbient[1] = 35;   // G  
-    tunnel_scene.colorAmbient[2] = 25;   // B - reduced blue
-    tunnel_scene.colorAmbient[3] = 0xFF; // A
-    
-    tunnel_scene.colorDir[0] = 220;      // R - warm main light
-    tunnel_scene.colorDir[1] = 200;      // G
-    tunnel_scene.colorDir[2] = 160;      // B - reduced blue
-    tunnel_scene.colorDir[3] = 0xFF;     // A
-    
-    tunnel_scene.colorDir2[0] = 80;      // R - warmer secondary light
-    tunnel_scene.colorDir2[1] = 70;      // G
-    tunnel_scene.colorDir2[2] = 50;      // B - much less blue
-    tunnel_scene.colorDir2[3] = 0xFF;    // A
+    Level* level = &tunnel_scene.level_data;
+    tunnel_scene.camDistance = level->header->camera_distance;
+    tunnel_scene.camHeight = level->header->camera_height;
+    tunnel_scene.camPos = player_get_camera_position(&tunnel_scene.player, tunnel_scene.camDistance, tunnel_scene.camHeight);
+    tunnel_scene.camTarget = player_get_camera_target(&tunnel_scene.player, 100.0f, 125.0f);
+    tunnel_scene.prevCamPos = tunnel_scene.camPos;
+    tunnel_scene.prevCamTarget = tunnel_scene.camTarget;
     
     // Create viewport like T3D examples
-    tunnel_scene.viewport = malloc(sizeof(T3DViewport));
-    *tunnel_scene.viewport = t3d_viewport_create();
+    // Buffered so the camera matrix has one copy per frame in flight
+    tunnel_scene.viewport = scene_alloc(sizeof(T3DViewport));
+    *tunnel_scene.viewport = t3d_viewport_create_buffered(DISPLAY_BUFFER_COUNT);
+}
+
+// The segments around the spawn point, budgeted per call unless blocking
+static bool tunnel_scene_load_segments(bool blocking) {
+    T3DVec3 forward;
+    t3d_vec3_diff(&forward, &tunnel_scene.camTarget, &tunnel_scene.camPos);
+    return level_stream_update(&tunnel_scene.level, &tunnel_scene.player.position, &forward, blocking);
+}
+
+void tunnel_scene_load_begin() {
+    tunnel_scene.loadStage = TUNNEL_LOAD_LEVEL;
+    tunnel_scene.loadUs = 0;
+    tunnel_scene.loadMaxStepUs = 0;
+}
+
+// Loads the scene a stage at a time, so it can happen behind the startup
+// screens. Non-blocking calls run whole stages until TUNNEL_LOAD_BUDGET_US
+// is spent and return true once the scene is ready to play.
+bool tunnel_scene_load(bool blocking) {
+    uint32_t start = TICKS_READ();
+    while (tunnel_scene.loadStage != TUNNEL_LOAD_DONE) {
+        if (!blocking && TICKS_TO_US(TICKS_DISTANCE(start, TICKS_READ())) >= TUNNEL_LOAD_BUDGET_US) break;
+        
+        uint32_t stage_start = TICKS_READ();
+        bool stage_done = true;
+        switch (tunnel_scene.loadStage) {
+            case TUNNEL_LOAD_LEVEL: tunnel_scene_load_level(); break;
+            case TUNNEL_LOAD_PLAYER: tunnel_scene_load_player(); break;
+            case TUNNEL_LOAD_CROWD: tunnel_scene_load_crowd(); break;
+            case TUNNEL_LOAD_SOUND: tunnel_scene_load_sound(); break;
+            case TUNNEL_LOAD_CAMERA: tunnel_scene_load_camera(); break;
+            case TUNNEL_LOAD_SEGMENTS: stage_done = tunnel_scene_load_segments(blocking); break;
+            default: break;
+        }
+        
+        uint32_t us = TICKS_TO_US(TICKS_DISTANCE(stage_start, TICKS_READ()));
+        tunnel_scene.loadUs += us;
+        if (us > tunnel_scene.loadMaxStepUs) tunnel_scene.loadMaxStepUs = us;
+        if (stage_done) tunnel_scene.loadStage++;
+        //debugf("Tunnel load stage %d: %lu us\n", tunnel_scene.loadStage, (unsigned long)us);
+    }
+    return tunnel_scene.loadStage == TUNNEL_LOAD_DONE;
+}
+
+// Loads everything at once
+void tunnel_scene_init() {
+    tunnel_scene_load_begin();
+    tunnel_scene_load(true);
 }
 
 void tunnel_scene_update(joypad_buttons_t button, joypad_inputs_t inputs) {
@@ -71,21 +174,136 @@ void tunnel_scene_update(joypad_buttons_t button, joypad_inputs_t inputs) {
     
     // Always update player movement (debug menu disabled, so always pass false)
     player_update(&tunnel_scene.player, button, inputs, false);
+    crowd_update(&tunnel_scene.crowd, SIM_DT);
+    
+    // Player sounds, from the feet
+    Player* player = &tunnel_scene.player;
+    if (player->events & PLAYER_EVENT_JUMPED) {
+        sfx_play(&tunnel_scene.sfx, tunnel_scene.sfxJump, &player->position, 0.8f, SFX_PRIORITY_ACTION);
+    }
+    if (player->events & PLAYER_EVENT_LANDED) {
+        sfx_play(&tunnel_scene.sfx, tunnel_scene.sfxLand, &player->position, 1.0f, SFX_PRIORITY_ACTION);
+    } else if (player->events & PLAYER_EVENT_STEP) {
+        sfx_play(&tunnel_scene.sfx, tunnel_scene.sfxStep, &player->position, 0.5f, SFX_PRIORITY_FOOTSTEP);
+    }
     
     // Update camera to follow player
+    tunnel_scene.prevCamPos = tunnel_scene.camPos;
+    tunnel_scene.prevCamTarget = tunnel_scene.camTarget;
     tunnel_scene.camPos = player_get_camera_position(&tunnel_scene.player, tunnel_scene.camDistance, tunnel_scene.camHeight);
     tunnel_scene.camTarget = player_get_camera_target(&tunnel_scene.player, 100.0f, 125.0f);  // Look up 50 units to center player better
 }
 
-void tunnel_scene_render() {
-    // Use T3D example values for better Z-buffer precision and avoid clipping
-    t3d_viewport_set_projection(tunnel_scene.viewport, T3D_DEG_TO_RAD(85.0f), 10.0f, 500.0f);
-    t3d_viewport_look_at(tunnel_scene.viewport, &tunnel_scene.camPos, &tunnel_scene.camTarget, &(T3DVec3){{0,1,0}});
+// Spends at most LEVEL_STREAM_FRAME_BUDGET_US per frame loading segments.
+// Replays load whatever the window needs right away instead, so which
+// segments are resident doesn't depend on timing.
+static void tunnel_scene_stream() {
+    profiler_scope_begin(PROF_SCOPE_STREAMING);
+    T3DVec3 forward;
+    t3d_vec3_diff(&forward, &tunnel_scene.camTarget, &tunnel_scene.camPos);
+    level_stream_update(&tunnel_scene.level, &tunnel_scene.player.position, &forward, replay_is_playing());
+    profiler_scope_end(PROF_SCOPE_STREAMING);
+    
+    profiler_set_counter(PROF_COUNTER_SEGMENTS_RESIDENT, level_stream_resident_count(&tunnel_scene.level));
+    profiler_set_counter(PROF_COUNTER_STREAM_KB, tunnel_scene.level.resident_bytes / 1024);
+    profiler_set_counter(PROF_COUNTER_STREAM_PEAK_KB, tunnel_scene.level.high_water_bytes / 1024);
+}
 
-    rdpq_attach(display_get(), display_get_zbuf());
+static void tunnel_scene_animation_counters() {
+    const AnimFrameStats* stats = animation_frame_stats();
+    profiler_set_counter(PROF_COUNTER_ANIM_BLENDS, stats->blends);
+    for (int lod = 0; lod < ANIM_LOD_COUNT; lod++) {
+        profiler_set_counter(PROF_COUNTER_ANIM_LOD_FULL + lod, stats->lod_count[lod]);
+    }
+    profiler_set_counter(PROF_COUNTER_ANIM_SAVED_US, stats->saved_us);
+}
+
+// Set up atmospheric lighting (KEEP YOUR LIGHTING). Same lights as the
+// first entries of assets/tunnel2.lights.
+static void tunnel_scene_set_lights() {
+    t3d_light_set_ambient(tunnel_scene.colorAmbient);
+    t3d_light_set_directional(0, tunnel_scene.colorDir, &tunnel_scene.lightDirVec);
+    t3d_light_set_directional(1, tunnel_scene.colorDir2, &tunnel_scene.lightDirVec2);
+    t3d_light_set_count(LIGHTS_DIRECTIONAL);
+    lights_begin_frame(&tunnel_scene.lights);
+}
+
+static void tunnel_scene_mesh_lod_counters() {
+    const MeshLodFrameStats* stats = mesh_lod_frame_stats();
+    for (int level = 0; level < MESH_LOD_MAX; level++) {
+        profiler_set_counter(PROF_COUNTER_MESH_LOD0_TRIS + level, stats->tris[level]);
+    }
+}
+
+static void tunnel_scene_draw_chunks() {
+    // Baked chunks are drawn unlit, the others get their nearest lights
+    LevelDrawHook hook = BAKED_LIGHTING ? NULL : lights_apply_object;
+    level_stream_draw(&tunnel_scene.level, tunnel_scene.viewport, hook, &tunnel_scene.lights,
+                      &tunnel_scene.visibleChunks, &tunnel_scene.culledChunks);
+    
+    profiler_set_counter(PROF_COUNTER_CHUNKS_VISIBLE, tunnel_scene.visibleChunks);
+    profiler_set_counter(PROF_COUNTER_CHUNKS_CULLED, tunnel_scene.culledChunks);
+}
+
+// Turns a point around the vertical axis through pivot, the same way
+// increasing rotation_y turns the player and the camera behind it
+static void tunnel_scene_orbit(T3DVec3* point, const T3DVec3* pivot, float yaw) {
+    float c = cosf(yaw), s = sinf(yaw);
+    float x = point->x - pivot->x;
+    float z = point->z - pivot->z;
+    point->x = pivot->x + x * c - z * s;
+    point->z = pivot->z + z * c + x * s;
+}
+
+// disp is the frame's one framebuffer, acquired by the caller
+void tunnel_scene_render(surface_t* disp, float alpha) {
+    tunnel_scene_stream();
+    
+    // Interpolate camera and player between the last two simulation ticks
+    T3DVec3 camPos, camTarget;
+    t3d_vec3_lerp(&camPos, &tunnel_scene.prevCamPos, &tunnel_scene.camPos, alpha);
+    t3d_vec3_lerp(&camTarget, &tunnel_scene.prevCamTarget, &tunnel_scene.camTarget, alpha);
+    
+    // Late-latched input: with streaming done, poll again and turn the view
+    // by what the newest stick adds over the last tick's input. Replays
+    // render exactly what was simulated.
+    if (LATE_INPUT && !replay_is_playing()) {
+        joypad_poll();
+        latency_late_sampled();
+        float yaw = player_late_turn(&tunnel_scene.player, joypad_get_buttons(JOYPAD_PORT_1),
+                                     joypad_get_inputs(JOYPAD_PORT_1), alpha * SIM_DT);
+        if (yaw != 0.0f) {
+            T3DVec3 pivot;
+            t3d_vec3_lerp(&pivot, &tunnel_scene.player.prev_position, &tunnel_scene.player.position, alpha);
+            tunnel_scene_orbit(&camPos, &pivot, yaw);
+            tunnel_scene_orbit(&camTarget, &pivot, yaw);
+        }
+    }
+    animation_system_set_lod(&tunnel_scene.player.anim_system,
+                             t3d_vec3_distance(&camPos, &tunnel_scene.player.position),
+                             player_in_view(&tunnel_scene.player, tunnel_scene.viewport));
+    player_update_render(&tunnel_scene.player, alpha);
+    tunnel_scene_animation_counters();
+    
+    // Sounds started or culled since the last frame, then hear from this one
+    profiler_set_counter(PROF_COUNTER_SFX_STARTED, tunnel_scene.sfx.started);
+    profiler_set_counter(PROF_COUNTER_SFX_CULLED, tunnel_scene.sfx.culled);
+    sfx_begin_frame(&tunnel_scene.sfx, &camPos, &camTarget);
+    
+    // Attach the scene target first: dynamic resolution may shrink the viewport
+    dynres_begin_scene(disp, display_get_zbuf(), tunnel_scene.viewport);
+    profiler_gpu_begin();
+    
+    // Use T3D example values for better Z-buffer precision and avoid clipping
+    t3d_viewport_set_projection(tunnel_scene.viewport, T3D_DEG_TO_RAD(85.0f), 10.0f, TUNNEL_FAR_PLANE);
+    t3d_viewport_look_at(tunnel_scene.viewport, &camPos, &camTarget, &(T3DVec3){{0,1,0}});
 
     t3d_frame_start();
     t3d_viewport_attach(tunnel_scene.viewport);
+    
+    // Mesh detail by projected size, now the camera is set
+    mesh_lod_begin_frame();
+    player_update_mesh_lod(&tunnel_scene.player, tunnel_scene.viewport);
 
     // Dark atmosphere for dungeon
     t3d_screen_clear_color(RGBA32(10, 10, 20, 0xFF));
@@ -95,42 +313,84 @@ void tunnel_scene_render() {
     t3d_state_set_drawflags(T3D_FLAG_SHADED | T3D_FLAG_TEXTURED | T3D_FLAG_DEPTH);
     t3d_state_set_vertex_fx(T3D_VERTEX_FX_NONE, 0, 0);
     
-    // Set up atmospheric lighting (KEEP YOUR LIGHTING)
-    t3d_light_set_ambient(tunnel_scene.colorAmbient);
-    t3d_light_set_directional(0, tunnel_scene.colorDir, &tunnel_scene.lightDirVec);
-    t3d_light_set_directional(1, tunnel_scene.colorDir2, &tunnel_scene.lightDirVec2);
-    t3d_light_set_count(2);
+#if BAKED_LIGHTING
+    // The tunnel's static lighting is in its vertex colours: full ambient
+    // and no lights passes them straight through
+    t3d_light_set_ambient((uint8_t[4]){0xFF, 0xFF, 0xFF, 0xFF});
+    t3d_light_set_count(0);
+#else
+    tunnel_scene_set_lights();
+#endif
 
-    // Draw the tunnel using display list
-    rspq_block_run(tunnel_scene.tunnelDpl);
+    // Pick and evaluate the crowd's shared poses for this view
+    profiler_scope_begin(PROF_SCOPE_CROWD);
+    crowd_prepare(&tunnel_scene.crowd, tunnel_scene.viewport, alpha);
+    profiler_scope_end(PROF_SCOPE_CROWD);
+    profiler_set_counter(PROF_COUNTER_CROWD_VISIBLE, tunnel_scene.crowd.visible_count);
+    profiler_set_counter(PROF_COUNTER_CROWD_POSES, tunnel_scene.crowd.pose_count);
+    
+    // Draw the tunnel chunks that survive frustum culling
+    profiler_scope_begin(PROF_SCOPE_TUNNEL_DRAW);
+    tunnel_scene_draw_chunks();
+    profiler_scope_end(PROF_SCOPE_TUNNEL_DRAW);
+    
+#if BAKED_LIGHTING
+    // Only moving, skinned geometry is lit at runtime
+    tunnel_scene_set_lights();
+#endif
     
     // Draw the player using skinned rendering
+    profiler_scope_begin(PROF_SCOPE_PLAYER_DRAW);
+    T3DVec3 player_center;
+    player_get_model_position(&tunnel_scene.player, &player_center.x, &player_center.y, &player_center.z);
+    player_center.y += PLAYER_HEIGHT * 0.5f;
+    lights_apply(&tunnel_scene.lights, &player_center, tunnel_scene.player.mesh_lod.radius);
     player_render(&tunnel_scene.player);
+    profiler_scope_end(PROF_SCOPE_PLAYER_DRAW);
+    
+    // Draw the crowd, batched by pose
+    profiler_scope_begin(PROF_SCOPE_CROWD);
+    crowd_draw(&tunnel_scene.crowd, &tunnel_scene.lights);
+    profiler_scope_end(PROF_SCOPE_CROWD);
+    tunnel_scene_mesh_lod_counters();
+    profiler_set_counter(PROF_COUNTER_LIGHT_UPLOADS, tunnel_scene.lights.uploads);
+    profiler_set_counter(PROF_COUNTER_LIGHT_SKIPS, tunnel_scene.lights.skipped);
+
+    // Upscale a reduced-resolution scene; 2D below draws at full resolution
+    dynres_end_scene(disp);
 
     // Debug menu disabled - commented out to avoid conflicts
     // debug_menu_render(&tunnel_scene.debug_menu, &tunnel_scene.player);
 
+    // Profiler overlay draws on top of everything (R to toggle)
+    profiler_render_overlay();
+    profiler_gpu_end();
+
     rdpq_detach_show();
 }
 
 void tunnel_scene_cleanup() {
-    if (tunnel_scene.tunnel_model) {
-        t3d_model_free(tunnel_scene.tunnel_model);
-        tunnel_scene.tunnel_model = NULL;
-    }
+    level_stream_cleanup(&tunnel_scene.level);
     
 
     
     // No need to free textures - T3D handles this internally
     
     // Cleanup player
+    sfx_cleanup(&tunnel_scene.sfx);
+    crowd_cleanup(&tunnel_scene.crowd);
     player_cleanup(&tunnel_scene.player);
+    animation_blend_pool_cleanup();
+    collision_cleanup(&tunnel_scene.collision);
+    level_cleanup(&tunnel_scene.level_data);
     
     // Debug menu disabled - commented out to avoid conflicts
     // debug_menu_cleanup(&tunnel_scene.debug_menu);
     
-    if (tunnel_scene.viewport) {
-        free(tunnel_scene.viewport);
-        tunnel_scene.viewport = NULL;
-    }
+    // The viewport struct is in the scene arena, its buffers are not
+    t3d_viewport_destroy(tunnel_scene.viewport);
+    tunnel_scene.viewport = NULL;
+    
+    // Drops every scene allocation and reports what the scene used
+    scene_arena_end();
 }
@@ -9,32 +9,90 @@
 #include <math.h>
 #include "player.h"
 #include "debug_menu.h"
+#include "level.h"
+#include "level_stream.h"
+#include "crowd.h"
+#include "lights.h"
+#include "sfx.h"
+
+// Static tunnel lighting baked into vertex colours (BAKE_LIGHTING in the makefile)
+#ifndef BAKED_LIGHTING
+#define BAKED_LIGHTING 0
+#endif
+
+// Camera turned by input polled just before rendering (LATE_INPUT in the makefile)
+#ifndef LATE_INPUT
+#define LATE_INPUT 1
+#endif
+
+#define TUNNEL_FAR_PLANE 500.0f
+#define TUNNEL_LOAD_BUDGET_US 8000           // Loading per frame behind the startup screens
+#define TUNNEL_DRIP_VOLUME 0.6f
+#define TUNNEL_DRIP_RADIUS 900.0f
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// Scene loading stages, in order
+typedef enum {
+    TUNNEL_LOAD_LEVEL = 0,          // Level file, lights, collision
+    TUNNEL_LOAD_PLAYER,
+    TUNNEL_LOAD_CROWD,
+    TUNNEL_LOAD_SOUND,
+    TUNNEL_LOAD_CAMERA,
+    TUNNEL_LOAD_SEGMENTS,           // Several calls, within the streaming budget
+    TUNNEL_LOAD_DONE
+} TunnelLoadStage;
+
 typedef struct {
-    T3DModel *tunnel_model;
     T3DViewport *viewport;
     Player player;
     DebugMenu debug_menu;
     
-    // Display list for tunnel
-    rspq_block_t *tunnelDpl;
+    // Scene settings, placements, lights, segment table and collision,
+    // loaded in one piece; the systems below point into it
+    Level level_data;
+    
+    // Tunnel segments streamed from DFS around the player. Each segment's
+    // chunks are culled against the view frustum through its BVH
+    LevelStream level;
+    uint32_t visibleChunks;
+    uint32_t culledChunks;
+    
+    // Static collision for the whole level, always resident
+    CollisionWorld collision;
+    
+    // NPCs sharing the player's model and poses
+    Crowd crowd;
     
     // Third-person camera
     T3DVec3 camPos;
     T3DVec3 camTarget;
+    T3DVec3 prevCamPos;      // Camera at the previous tick, for render interpolation
+    T3DVec3 prevCamTarget;
     float camDistance;
     float camHeight;
     
-    // Lighting
+    // Lighting: scene-wide ambient and directionals, plus the torches and
+    // effects the light manager hands out per draw
+    LightManager lights;
     uint8_t colorAmbient[4];
     uint8_t colorDir[4];
     uint8_t colorDir2[4];
     T3DVec3 lightDirVec;
     T3DVec3 lightDirVec2;
+    
+    // Positional sound effects heard from the camera
+    SfxEngine sfx;
+    int sfxStep;
+    int sfxJump;
+    int sfxLand;
+    
+    // Loading
+    int loadStage;           // TunnelLoadStage
+    uint32_t loadUs;         // CPU time spent in load stages
+    uint32_t loadMaxStepUs;  // Longest single stage call
 } TunnelScene;
 
 // External variables
@@ -42,8 +100,10 @@ extern TunnelScene tunnel_scene;
 
 // Function declarations
 void tunnel_scene_init();
+void tunnel_scene_load_begin();
+bool tunnel_scene_load(bool blocking);
 void tunnel_scene_update(joypad_buttons_t button, joypad_inputs_t inputs);
-void tunnel_scene_render();
+void tunnel_scene_render(surface_t* disp, float alpha);
 void tunnel_scene_cleanup();
 
 #endif
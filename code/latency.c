@@ -0,0 +1,55 @@
+#include "latency.h"
+#include <string.h>
+
+static LatencyStats latency;
+
+void latency_init(void) {
+    memset(&latency, 0, sizeof(latency));
+}
+
+// Right after the frame's joypad_poll
+void latency_frame_sampled(void) {
+    latency.frame_sample = TICKS_READ();
+    latency.late_sample = latency.frame_sample;
+}
+
+// After polling again just before the camera is set
+void latency_late_sampled(void) {
+    latency.late_sample = TICKS_READ();
+}
+
+// Once the frame is handed to the RSP (rdpq_detach_show or display_show)
+void latency_frame_submitted(void) {
+    uint32_t now = TICKS_READ();
+    latency.last_us = TICKS_TO_US(TICKS_DISTANCE(latency.late_sample, now));
+    if (!LATENCY_TEST) return;
+
+    if (latency.frames == 0) latency.report_start = now;
+    latency.frames++;
+    latency.late_us += latency.last_us;
+    latency.frame_us += TICKS_TO_US(TICKS_DISTANCE(latency.frame_sample, now));
+    if (latency.last_us > latency.late_max_us) latency.late_max_us = latency.last_us;
+}
+
+void latency_frame_end(uint32_t rdp_us) {
+    if (!LATENCY_TEST || latency.frames == 0) return;
+    latency.rdp_us += rdp_us;
+
+    if (TICKS_DISTANCE(latency.report_start, TICKS_READ()) >= TICKS_FROM_MS(LATENCY_TEST_SECONDS * 1000)) {
+        uint32_t late_avg = latency.late_us / latency.frames;
+        uint32_t rdp_avg = latency.rdp_us / latency.frames;
+        debugf("LATENCY input to submit avg %5lu us (max %5lu), from frame start %5lu us; + RDP %5lu us = %5lu us before vblank, over %lu frames\n",
+               (unsigned long)late_avg, (unsigned long)latency.late_max_us,
+               (unsigned long)(latency.frame_us / latency.frames), (unsigned long)rdp_avg,
+               (unsigned long)(late_avg + rdp_avg), (unsigned long)latency.frames);
+        latency.frames = 0;
+        latency.late_us = 0;
+        latency.frame_us = 0;
+        latency.rdp_us = 0;
+        latency.late_max_us = 0;
+    }
+}
+
+uint32_t latency_last_us(void) {
+    return latency.last_us;
+}
@@ -0,0 +1,40 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <libdragon.h>
+
+// Input-to-submit latency: how old the newest input a frame used is when
+// the frame goes to the RSP. The frame then still needs its RDP time and
+// the next vertical blank before it is on screen.
+//
+// Latency test mode, selectable at build time (LATENCY_TEST in the
+// makefile), logs the averages every LATENCY_TEST_SECONDS; build with
+// LATE_INPUT=0 to compare against the first sample of the frame only.
+#ifndef LATENCY_TEST
+#define LATENCY_TEST 0
+#endif
+#define LATENCY_TEST_SECONDS 5
+
+typedef struct {
+    uint32_t frame_sample;        // First input sample of the frame
+    uint32_t late_sample;         // Newest, same as frame_sample without a late one
+    uint32_t last_us;             // Newest sample to submit, last frame
+
+    // Test mode report
+    uint32_t report_start;
+    uint32_t frames;
+    uint64_t late_us;
+    uint64_t frame_us;
+    uint64_t rdp_us;
+    uint32_t late_max_us;
+} LatencyStats;
+
+// Latency functions
+void latency_init(void);
+void latency_frame_sampled(void);
+void latency_late_sampled(void);
+void latency_frame_submitted(void);
+void latency_frame_end(uint32_t rdp_us);
+uint32_t latency_last_us(void);
+
+#endif // LATENCY_H
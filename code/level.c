@@ -0,0 +1,62 @@
+#include "level.h"
+#include "scene_arena.h"
+#include <string.h>
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// The packed file is big-endian like the N64, only host builds swap it.
+// Embedded files are swapped by their own loaders; the segment manifest
+// isn't, level streaming doesn't run on the host.
+static void level_swap_words(void* data, uint32_t word_count) {
+    uint32_t* words = data;
+    for (uint32_t i = 0; i < word_count; i++) words[i] = __builtin_bswap32(words[i]);
+}
+
+static void level_swap(LevelHeader* header) {
+    level_swap_words(&header->version, 4);
+    for (int i = 0; i < LEVEL_DIRECTIONAL; i++) level_swap_words(&header->directional[i].direction, 3);
+    level_swap_words(&header->entities, 8);
+
+    uint8_t* base = (uint8_t*)header;
+    LevelEntity* entities = (LevelEntity*)(base + header->entities.offset);
+    for (uint32_t i = 0; i < header->entities.count; i++) level_swap_words(&entities[i], 5);
+    LevelLight* lights = (LevelLight*)(base + header->lights.offset);
+    for (uint32_t i = 0; i < header->lights.count; i++) {
+        level_swap_words(&lights[i].position, 3);
+        level_swap_words(&lights[i].radius, 1);
+    }
+}
+#endif
+
+void level_load(Level* level, const char* path) {
+    int size = 0;
+    level->header = scene_alloc_file(path, &size);
+    LevelHeader* header = level->header;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    level_swap(header);
+#endif
+    assertf(memcmp(header->magic, LEVEL_MAGIC, 4) == 0 && header->version == LEVEL_VERSION &&
+            header->size == (uint32_t)size,
+            "Bad level file: %s", path);
+
+    // Offsets to pointers, the data stays where it was loaded
+    uint8_t* base = (uint8_t*)header;
+    level->entities = (const LevelEntity*)(base + header->entities.offset);
+    level->entity_count = header->entities.count;
+    level->lights = (const LevelLight*)(base + header->lights.offset);
+    level->light_count = header->lights.count;
+    level->segments = header->segments.offset ? base + header->segments.offset : NULL;
+    level->collision = header->collision.offset ? (CollisionHeader*)(base + header->collision.offset) : NULL;
+    //debugf("Level %s: %d entities, %d lights, %d bytes\n", path, level->entity_count, level->light_count, size);
+}
+
+const LevelEntity* level_find_entity(const Level* level, LevelEntityType type) {
+    for (int i = 0; i < level->entity_count; i++) {
+        if (level->entities[i].type == (uint32_t)type) return &level->entities[i];
+    }
+    return NULL;
+}
+
+void level_cleanup(Level* level) {
+    // The file is scene arena memory
+    memset(level, 0, sizeof(Level));
+}
@@ -0,0 +1,76 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <libdragon.h>
+#include <t3d/t3dmath.h>
+#include "collision.h"
+
+// Level file packed by tools/level_pack.py from assets/<level>.scene: scene
+// settings, entity placements, point lights, the streaming segment table
+// and the collision grid, loaded with one read and used in place. Sections
+// are stored as offsets from the start of the file and resolved to
+// pointers at load, so nothing is parsed or allocated per entry.
+#define LEVEL_MAGIC "LEVL"
+#define LEVEL_VERSION 1
+#define LEVEL_NAME_LEN 16
+#define LEVEL_DIRECTIONAL 2
+
+typedef enum {
+    LEVEL_ENTITY_SPAWN = 0,           // Player start
+    LEVEL_ENTITY_NPC = 1,             // Crowd member, name is its clip
+    LEVEL_ENTITY_SOUND = 2            // Ambient sound emitter, name is its sample
+} LevelEntityType;
+
+typedef struct {
+    uint32_t type;
+    T3DVec3 position;
+    float yaw;
+    char name[LEVEL_NAME_LEN];
+} LevelEntity;
+
+typedef struct {
+    T3DVec3 position;
+    uint8_t color[4];
+    float radius;
+} LevelLight;
+
+typedef struct {
+    uint8_t color[4];
+    T3DVec3 direction;                // Towards the light
+} LevelDirectional;
+
+typedef struct {
+    uint32_t offset;                  // From the start of the file, 0 if absent
+    uint32_t count;                   // Entries, or bytes for embedded files
+} LevelSection;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t size;
+    float camera_distance;
+    float camera_height;
+    uint8_t ambient[4];
+    LevelDirectional directional[LEVEL_DIRECTIONAL];
+    LevelSection entities;
+    LevelSection lights;
+    LevelSection segments;            // .segs manifest, see level_stream.h
+    LevelSection collision;           // .col grid, see collision.h
+} LevelHeader;
+
+typedef struct {
+    LevelHeader* header;              // Loaded file in the scene arena, holds everything below
+    const LevelEntity* entities;
+    int entity_count;
+    const LevelLight* lights;
+    int light_count;
+    void* segments;                   // LevelStreamManifest, NULL if absent
+    CollisionHeader* collision;       // NULL if absent
+} Level;
+
+// Level functions
+void level_load(Level* level, const char* path);
+const LevelEntity* level_find_entity(const Level* level, LevelEntityType type);
+void level_cleanup(Level* level);
+
+#endif // LEVEL_H
@@ -0,0 +1,239 @@
+#include "level_stream.h"
+#include "scene_arena.h"
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t file_size(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) return 0;
+    fseek(f, 0, SEEK_END);
+    uint32_t size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+void level_stream_init(LevelStream* stream, const char* manifest_path) {
+    int size = 0;
+    LevelStreamManifest* manifest = scene_alloc_file(manifest_path, &size);
+    assertf(memcmp(manifest->magic, LEVEL_STREAM_MAGIC, 4) == 0, "Bad segment manifest: %s", manifest_path);
+    level_stream_init_in_place(stream, manifest);
+}
+
+// Manifest already in memory, e.g. embedded in a level file; the caller keeps it alive
+void level_stream_init_in_place(LevelStream* stream, LevelStreamManifest* manifest) {
+    stream->manifest = manifest;
+    assertf(memcmp(stream->manifest->magic, LEVEL_STREAM_MAGIC, 4) == 0 &&
+            stream->manifest->version == LEVEL_STREAM_VERSION,
+            "Bad segment manifest");
+    
+    stream->segment_count = stream->manifest->count;
+    stream->segments = scene_alloc(stream->segment_count * sizeof(LevelSegment));
+    for (int i = 0; i < stream->segment_count; i++) {
+        LevelSegment* seg = &stream->segments[i];
+        seg->desc = &stream->manifest->segments[i];
+        seg->state = SEGMENT_UNLOADED;
+        seg->model = NULL;
+        seg->bvh = NULL;
+        seg->object_count = 0;
+        // File size is a close estimate of the model's resident size
+        seg->size = file_size(seg->desc->path);
+    }
+    
+    stream->budget_bytes = is_memory_expanded() ? LEVEL_STREAM_BUDGET_8MB : LEVEL_STREAM_BUDGET_4MB;
+    stream->resident_bytes = 0;
+    stream->high_water_bytes = 0;
+    stream->loads = 0;
+    stream->evictions = 0;
+}
+
+static bool segment_in_window(const LevelSegment* seg, float window_min, float window_max) {
+    return seg->desc->range_max >= window_min && seg->desc->range_min <= window_max;
+}
+
+static float segment_distance(const LevelSegment* seg, float pos) {
+    if (pos < seg->desc->range_min) return seg->desc->range_min - pos;
+    if (pos > seg->desc->range_max) return pos - seg->desc->range_max;
+    return 0.0f;
+}
+
+// Runs once the RDP has finished every command queued before the free:
+// textures are loaded by the RDP straight from the model's memory
+static void segment_model_free(void* model) {
+    t3d_model_free(model);
+}
+
+// Call once the RSP is past the segment's blocks. deferred: leave the model
+// to the RDP's completion, otherwise the RDP must be idle already.
+static void segment_free(LevelStream* stream, LevelSegment* seg, bool deferred) {
+    T3DModelIter it = t3d_model_iter_create(seg->model, T3D_CHUNK_TYPE_OBJECT);
+    while (t3d_model_iter_next(&it)) {
+        if (it.object->userBlock) {
+            rspq_block_free(it.object->userBlock);
+            it.object->userBlock = NULL;
+        }
+    }
+    if (deferred) {
+        rdpq_call_deferred(segment_model_free, seg->model);
+    } else {
+        t3d_model_free(seg->model);
+    }
+    seg->model = NULL;
+    seg->bvh = NULL;
+    seg->state = SEGMENT_UNLOADED;
+    stream->resident_bytes -= seg->size;
+}
+
+// Records chunk blocks until done or out of time. Returns true once resident.
+static bool segment_record_blocks(LevelSegment* seg, uint32_t start_ticks, bool blocking) {
+    T3DModelIter it = t3d_model_iter_create(seg->model, T3D_CHUNK_TYPE_OBJECT);
+    while (t3d_model_iter_next(&it)) {
+        if (it.object->userBlock) continue;
+        
+        rspq_block_begin();
+        t3d_model_draw_object(it.object, NULL);
+        it.object->userBlock = rspq_block_end();
+        seg->object_count++;
+        
+        if (!blocking && TICKS_TO_US(TICKS_DISTANCE(start_ticks, TICKS_READ())) >= LEVEL_STREAM_FRAME_BUDGET_US) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true once everything in the load window is resident (or doesn't
+// fit the budget), false when the frame budget ran out first
+bool level_stream_update(LevelStream* stream, const T3DVec3* focus, const T3DVec3* forward, bool blocking) {
+    uint32_t start_ticks = TICKS_READ();
+    float axis_x = stream->manifest->axis_x;
+    float axis_z = stream->manifest->axis_z;
+    
+    // Project the player onto the level axis and bias the window towards
+    // the direction they are facing
+    float pos = focus->x * axis_x + focus->z * axis_z;
+    bool facing_positive = (forward->x * axis_x + forward->z * axis_z) >= 0.0f;
+    float ahead = facing_positive ? LEVEL_STREAM_LOAD_AHEAD : LEVEL_STREAM_LOAD_BEHIND;
+    float behind = facing_positive ? LEVEL_STREAM_LOAD_BEHIND : LEVEL_STREAM_LOAD_AHEAD;
+    float load_min = pos - behind;
+    float load_max = pos + ahead;
+    float keep_min = load_min - LEVEL_STREAM_EVICT_MARGIN;
+    float keep_max = load_max + LEVEL_STREAM_EVICT_MARGIN;
+    
+    for (int i = 0; i < stream->segment_count; i++) {
+        LevelSegment* seg = &stream->segments[i];
+        
+        // Free evicted segments once the RSP has moved past their blocks; the
+        // model itself waits for the RDP
+        if (seg->state == SEGMENT_EVICTING && blocking) {
+            rspq_wait();
+            segment_free(stream, seg, false);
+        } else if (seg->state == SEGMENT_EVICTING && rspq_syncpoint_check(seg->evict_fence)) {
+            segment_free(stream, seg, true);
+        }
+        
+        // Evict segments that fell out of the keep window
+        if ((seg->state == SEGMENT_RESIDENT || seg->state == SEGMENT_LOADING) &&
+            !segment_in_window(seg, keep_min, keep_max)) {
+            seg->state = SEGMENT_EVICTING;
+            seg->evict_fence = rspq_syncpoint_new();
+            stream->evictions++;
+            //debugf("Evicting %s\n", seg->desc->path);
+        }
+    }
+    
+    // Load work, nearest segment first, until the frame budget runs out
+    while (blocking || TICKS_TO_US(TICKS_DISTANCE(start_ticks, TICKS_READ())) < LEVEL_STREAM_FRAME_BUDGET_US) {
+        LevelSegment* next = NULL;
+        for (int i = 0; i < stream->segment_count; i++) {
+            LevelSegment* seg = &stream->segments[i];
+            if (seg->state == SEGMENT_LOADING) {
+                next = seg;
+                break;
+            }
+            if (seg->state == SEGMENT_UNLOADED && segment_in_window(seg, load_min, load_max) &&
+                stream->resident_bytes + seg->size <= stream->budget_bytes &&
+                (next == NULL || segment_distance(seg, pos) < segment_distance(next, pos))) {
+                next = seg;
+            }
+        }
+        if (next == NULL) return true;
+        
+        if (next->state == SEGMENT_UNLOADED) {
+            next->model = t3d_model_load(next->desc->path);
+            next->bvh = t3d_model_bvh_get(next->model);
+            next->object_count = 0;
+            next->state = SEGMENT_LOADING;
+            
+            stream->resident_bytes += next->size;
+            if (stream->resident_bytes > stream->high_water_bytes) {
+                stream->high_water_bytes = stream->resident_bytes;
+            }
+            stream->loads++;
+            //debugf("Loading %s\n", next->desc->path);
+        } else if (segment_record_blocks(next, start_ticks, blocking)) {
+            next->state = SEGMENT_RESIDENT;
+        }
+    }
+    return false;
+}
+
+void level_stream_draw(LevelStream* stream, T3DViewport* viewport, LevelDrawHook hook, void* user,
+                       uint32_t* visible, uint32_t* culled) {
+    *visible = 0;
+    *culled = 0;
+    
+    // Materials are shared across segments, so one state skips redundant switches
+    T3DModelState state = t3d_model_state_create();
+    
+    for (int i = 0; i < stream->segment_count; i++) {
+        LevelSegment* seg = &stream->segments[i];
+        if (seg->state != SEGMENT_RESIDENT) continue;
+        
+        // Whole segment outside the frustum: skip its BVH entirely
+        if (!t3d_frustum_vs_aabb(&viewport->viewFrustum, &seg->desc->aabb_min, &seg->desc->aabb_max)) {
+            *culled += seg->object_count;
+            continue;
+        }
+        
+        if (seg->bvh) {
+            t3d_model_bvh_query_frustum(seg->bvh, &viewport->viewFrustum);
+        }
+        
+        T3DModelIter it = t3d_model_iter_create(seg->model, T3D_CHUNK_TYPE_OBJECT);
+        while (t3d_model_iter_next(&it)) {
+            if (seg->bvh && !it.object->isVisible) {
+                (*culled)++;
+                continue;
+            }
+            if (hook) hook(user, it.object);
+            t3d_model_draw_material(it.object->material, &state);
+            rspq_block_run(it.object->userBlock);
+            it.object->isVisible = false;  // The BVH query only sets visible objects
+            (*visible)++;
+        }
+    }
+}
+
+int level_stream_resident_count(const LevelStream* stream) {
+    int count = 0;
+    for (int i = 0; i < stream->segment_count; i++) {
+        if (stream->segments[i].state == SEGMENT_RESIDENT) count++;
+    }
+    return count;
+}
+
+void level_stream_cleanup(LevelStream* stream) {
+    rspq_wait();
+    for (int i = 0; i < stream->segment_count; i++) {
+        if (stream->segments[i].state != SEGMENT_UNLOADED) {
+            segment_free(stream, &stream->segments[i], false);
+        }
+    }
+    debugf("Level stream: peak %lu/%lu bytes resident\n",
+           (unsigned long)stream->high_water_bytes, (unsigned long)stream->budget_bytes);
+    
+    // Scene arena memory
+    stream->segments = NULL;
+    stream->manifest = NULL;
+    stream->segment_count = 0;
+}
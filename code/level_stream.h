@@ -0,0 +1,87 @@
+#ifndef LEVEL_STREAM_H
+#define LEVEL_STREAM_H
+
+#include <libdragon.h>
+#include <t3d/t3d.h>
+#include <t3d/t3dmath.h>
+#include <t3d/t3dmodel.h>
+
+// Resident model memory allowed for level segments, per console configuration
+#ifndef LEVEL_STREAM_BUDGET_4MB
+#define LEVEL_STREAM_BUDGET_4MB (512 * 1024)
+#endif
+#ifndef LEVEL_STREAM_BUDGET_8MB
+#define LEVEL_STREAM_BUDGET_8MB (2 * 1024 * 1024)
+#endif
+
+#define LEVEL_STREAM_FRAME_BUDGET_US 2000   // CPU time per frame spent loading
+#define LEVEL_STREAM_LOAD_AHEAD 2500.0f     // Load segments this far ahead of the player...
+#define LEVEL_STREAM_LOAD_BEHIND 800.0f     // ...and this far behind
+#define LEVEL_STREAM_EVICT_MARGIN 600.0f    // Extra distance before a loaded segment is evicted
+
+// Segment manifest written by tools/gltf_chunk.py --segments (big-endian):
+//   char magic[4] "SEGS", u32 version, u32 count, f32 axis_x, f32 axis_z
+//   count x { f32 range_min, range_max; f32 aabb_min[3], aabb_max[3]; char path[32] }
+#define LEVEL_STREAM_MAGIC "SEGS"
+#define LEVEL_STREAM_VERSION 1
+#define LEVEL_STREAM_PATH_LEN 32
+
+typedef enum {
+    SEGMENT_UNLOADED = 0,
+    SEGMENT_LOADING,      // Model loaded, chunk blocks still being recorded
+    SEGMENT_RESIDENT,
+    SEGMENT_EVICTING      // Waiting for the RSP to leave its blocks
+} SegmentState;
+
+typedef struct {
+    float range_min;              // Extent along the level axis
+    float range_max;
+    T3DVec3 aabb_min;
+    T3DVec3 aabb_max;
+    char path[LEVEL_STREAM_PATH_LEN];
+} LevelSegmentDesc;
+
+// The manifest is used in place: the file layout matches these structs
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    float axis_x;
+    float axis_z;
+    LevelSegmentDesc segments[];
+} LevelStreamManifest;
+
+typedef struct {
+    const LevelSegmentDesc* desc;
+    SegmentState state;
+    T3DModel* model;
+    const T3DBvh* bvh;
+    uint32_t size;                // Bytes charged against the memory budget
+    uint32_t object_count;
+    rspq_syncpoint_t evict_fence;
+} LevelSegment;
+
+typedef struct {
+    LevelStreamManifest* manifest;
+    LevelSegment* segments;
+    int segment_count;
+    uint32_t budget_bytes;
+    uint32_t resident_bytes;
+    uint32_t high_water_bytes;
+    uint32_t loads;
+    uint32_t evictions;          // Segments dropped for leaving the keep window, not cleanup
+} LevelStream;
+
+// Called before each visible chunk is drawn, e.g. to pick its lights
+typedef void (*LevelDrawHook)(void* user, const T3DObject* object);
+
+// Level streaming functions
+void level_stream_init(LevelStream* stream, const char* manifest_path);
+void level_stream_init_in_place(LevelStream* stream, LevelStreamManifest* manifest);
+bool level_stream_update(LevelStream* stream, const T3DVec3* focus, const T3DVec3* forward, bool blocking);
+void level_stream_draw(LevelStream* stream, T3DViewport* viewport, LevelDrawHook hook, void* user,
+                       uint32_t* visible, uint32_t* culled);
+int level_stream_resident_count(const LevelStream* stream);
+void level_stream_cleanup(LevelStream* stream);
+
+#endif // LEVEL_STREAM_H
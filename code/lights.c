@@ -0,0 +1,212 @@
+#include "lights.h"
+#include <string.h>
+#include <math.h>
+
+void lights_init(LightManager* mgr, float far_plane) {
+    memset(mgr, 0, sizeof(LightManager));
+    // Point light sizes are relative to the far plane
+    mgr->size_scale = 1.0f / far_plane;
+    mgr->bound_count = -1;
+}
+
+int lights_add(LightManager* mgr, const T3DVec3* position, const uint8_t color[4], float radius) {
+    // Reuse a removed slot first, so effects can come and go
+    int light = -1;
+    for (int i = 0; i < mgr->count; i++) {
+        if (!mgr->lights[i].active) {
+            light = i;
+            break;
+        }
+    }
+    if (light < 0) {
+        assertf(mgr->count < LIGHTS_MAX, "Too many scene lights (max %d)", LIGHTS_MAX);
+        light = mgr->count++;
+    }
+
+    SceneLight* l = &mgr->lights[light];
+    uint16_t version = l->version + 1;
+    l->position = *position;
+    memcpy(l->color, color, 4);
+    l->radius = radius;
+    l->intensity = 1.0f;
+    l->active = true;
+    l->version = version;
+    mgr->grid_dirty = true;
+    return light;
+}
+
+void lights_remove(LightManager* mgr, int light) {
+    mgr->lights[light].active = false;
+    mgr->lights[light].version++;
+    mgr->grid_dirty = true;
+}
+
+void lights_set_position(LightManager* mgr, int light, const T3DVec3* position) {
+    mgr->lights[light].position = *position;
+    mgr->lights[light].version++;
+    mgr->grid_dirty = true;
+}
+
+void lights_set_intensity(LightManager* mgr, int light, float intensity) {
+    if (mgr->lights[light].intensity == intensity) return;
+    mgr->lights[light].intensity = intensity;
+    mgr->lights[light].version++;
+}
+
+static void lights_rebuild_grid(LightManager* mgr) {
+    mgr->grid_dirty = false;
+    memset(mgr->cell_count, 0, sizeof(mgr->cell_count));
+
+    float min_x = INFINITY, min_z = INFINITY, max_x = -INFINITY, max_z = -INFINITY;
+    for (int i = 0; i < mgr->count; i++) {
+        const SceneLight* l = &mgr->lights[i];
+        if (!l->active) continue;
+        min_x = fminf(min_x, l->position.x - l->radius);
+        max_x = fmaxf(max_x, l->position.x + l->radius);
+        min_z = fminf(min_z, l->position.z - l->radius);
+        max_z = fmaxf(max_z, l->position.z + l->radius);
+    }
+    if (min_x > max_x) {
+        mgr->grid_w = mgr->grid_h = 0;
+        return;
+    }
+
+    // Cells grow until the grid covers every light
+    mgr->cell_size = LIGHTS_CELL_SIZE;
+    while ((max_x - min_x) / mgr->cell_size >= LIGHTS_GRID_MAX ||
+           (max_z - min_z) / mgr->cell_size >= LIGHTS_GRID_MAX) {
+        mgr->cell_size *= 2.0f;
+    }
+    mgr->grid_min_x = min_x;
+    mgr->grid_min_z = min_z;
+    mgr->grid_w = (int)((max_x - min_x) / mgr->cell_size) + 1;
+    mgr->grid_h = (int)((max_z - min_z) / mgr->cell_size) + 1;
+
+    for (int i = 0; i < mgr->count; i++) {
+        const SceneLight* l = &mgr->lights[i];
+        if (!l->active) continue;
+        int x0 = (int)((l->position.x - l->radius - min_x) / mgr->cell_size);
+        int x1 = (int)((l->position.x + l->radius - min_x) / mgr->cell_size);
+        int z0 = (int)((l->position.z - l->radius - min_z) / mgr->cell_size);
+        int z1 = (int)((l->position.z + l->radius - min_z) / mgr->cell_size);
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                int cell = z * mgr->grid_w + x;
+                if (mgr->cell_count[cell] == LIGHTS_PER_CELL) {
+                    //debugf("Lights: cell %d,%d full, light %d dropped there\n", x, z, i);
+                    continue;
+                }
+                mgr->cell_lights[cell][mgr->cell_count[cell]++] = i;
+            }
+        }
+    }
+}
+
+// How much a light contributes around a bounding sphere, 0 if out of reach
+static float lights_influence(const SceneLight* l, const T3DVec3* center, float radius) {
+    float dist = t3d_vec3_distance(&l->position, center) - radius;
+    if (dist < 0.0f) dist = 0.0f;
+    if (dist >= l->radius) return 0.0f;
+    float falloff = 1.0f - dist / l->radius;
+    float brightness = (l->color[0] + l->color[1] + l->color[2]) * l->intensity;
+    return brightness * falloff * falloff;
+}
+
+int lights_select(LightManager* mgr, const T3DVec3* center, float radius, int* out) {
+    if (mgr->grid_dirty) lights_rebuild_grid(mgr);
+    if (mgr->grid_w == 0) return 0;
+
+    int x0 = (int)floorf((center->x - radius - mgr->grid_min_x) / mgr->cell_size);
+    int x1 = (int)floorf((center->x + radius - mgr->grid_min_x) / mgr->cell_size);
+    int z0 = (int)floorf((center->z - radius - mgr->grid_min_z) / mgr->cell_size);
+    int z1 = (int)floorf((center->z + radius - mgr->grid_min_z) / mgr->cell_size);
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= mgr->grid_w) x1 = mgr->grid_w - 1;
+    if (z1 >= mgr->grid_h) z1 = mgr->grid_h - 1;
+
+    // Keep the strongest LIGHTS_PER_DRAW, best first. A light spanning
+    // several cells is seen more than once; the duplicate check skips it.
+    float best[LIGHTS_PER_DRAW];
+    int count = 0;
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            int cell = z * mgr->grid_w + x;
+            for (int c = 0; c < mgr->cell_count[cell]; c++) {
+                int light = mgr->cell_lights[cell][c];
+                float influence = lights_influence(&mgr->lights[light], center, radius);
+                if (influence <= 0.0f) continue;
+
+                bool seen = false;
+                for (int i = 0; i < count; i++) seen |= out[i] == light;
+                if (seen) continue;
+                if (count == LIGHTS_PER_DRAW && influence <= best[count - 1]) continue;
+
+                int slot = count < LIGHTS_PER_DRAW ? count++ : count - 1;
+                while (slot > 0 && best[slot - 1] < influence) {
+                    best[slot] = best[slot - 1];
+                    out[slot] = out[slot - 1];
+                    slot--;
+                }
+                best[slot] = influence;
+                out[slot] = light;
+            }
+        }
+    }
+
+    // Stable order, so the same set compares equal whatever the ranking
+    for (int i = 1; i < count; i++) {
+        int light = out[i];
+        int j = i;
+        for (; j > 0 && out[j - 1] > light; j--) out[j] = out[j - 1];
+        out[j] = light;
+    }
+    return count;
+}
+
+void lights_begin_frame(LightManager* mgr) {
+    // The camera moved, so positions in the RSP's view space are stale
+    mgr->bound_count = -1;
+    mgr->uploads = 0;
+    mgr->skipped = 0;
+}
+
+void lights_apply(LightManager* mgr, const T3DVec3* center, float radius) {
+    int selected[LIGHTS_PER_DRAW];
+    int count = lights_select(mgr, center, radius, selected);
+
+    bool same = count == mgr->bound_count;
+    for (int i = 0; same && i < count; i++) {
+        same = mgr->bound[i] == selected[i] && mgr->bound_version[i] == mgr->lights[selected[i]].version;
+    }
+    if (same) {
+        mgr->skipped++;
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const SceneLight* l = &mgr->lights[selected[i]];
+        uint8_t color[4];
+        for (int c = 0; c < 3; c++) {
+            float v = l->color[c] * l->intensity;
+            color[c] = v > 255.0f ? 255 : (uint8_t)v;
+        }
+        color[3] = 0xFF;
+        t3d_light_set_point(LIGHTS_DIRECTIONAL + i, color, &l->position, l->radius * mgr->size_scale, false);
+        mgr->bound[i] = selected[i];
+        mgr->bound_version[i] = l->version;
+    }
+    t3d_light_set_count(LIGHTS_DIRECTIONAL + count);
+    mgr->bound_count = count;
+    mgr->uploads++;
+}
+
+// Level draw hook: lights a chunk by its bounding box
+void lights_apply_object(void* mgr, const T3DObject* object) {
+    T3DVec3 center, half;
+    for (int i = 0; i < 3; i++) {
+        center.v[i] = (object->aabbMin[i] + object->aabbMax[i]) * 0.5f;
+        half.v[i] = (object->aabbMax[i] - object->aabbMin[i]) * 0.5f;
+    }
+    lights_apply((LightManager*)mgr, &center, t3d_vec3_len(&half));
+}
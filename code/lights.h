@@ -0,0 +1,69 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <libdragon.h>
+#include <t3d/t3d.h>
+#include <t3d/t3dmath.h>
+#include <t3d/t3dmodel.h>
+
+// Scene point lights (torches, effects) kept in a uniform XZ grid. Each
+// draw (an actor or a level chunk) gets the few lights that affect its
+// bounds most, uploaded only when they differ from what the RSP already
+// has, so the light count of the scene doesn't change the cost per draw.
+
+#define LIGHTS_MAX 64
+#define LIGHTS_PER_DRAW 4            // Point lights per draw, after the directionals
+#define LIGHTS_DIRECTIONAL 2         // Slots the scene's directional lights occupy
+#define LIGHTS_CELL_SIZE 512.0f      // Grid cell edge, world units
+#define LIGHTS_GRID_MAX 16           // Cells per axis, cells grow to cover larger scenes
+#define LIGHTS_PER_CELL 16
+
+typedef struct {
+    T3DVec3 position;
+    uint8_t color[4];
+    float radius;                    // No influence beyond this distance
+    float intensity;                 // Scales color, e.g. for flicker
+    bool active;
+    uint16_t version;                // Bumped on every change, to detect stale uploads
+} SceneLight;
+
+typedef struct {
+    SceneLight lights[LIGHTS_MAX];
+    int count;
+    float size_scale;                // World units to t3d_light_set_point sizes
+
+    // Grid over the lights' bounds, rebuilt lazily after changes
+    float grid_min_x;
+    float grid_min_z;
+    float cell_size;
+    int grid_w;
+    int grid_h;
+    uint8_t cell_count[LIGHTS_GRID_MAX * LIGHTS_GRID_MAX];
+    uint8_t cell_lights[LIGHTS_GRID_MAX * LIGHTS_GRID_MAX][LIGHTS_PER_CELL];
+    bool grid_dirty;
+
+    // What the RSP has right now
+    int8_t bound[LIGHTS_PER_DRAW];
+    uint16_t bound_version[LIGHTS_PER_DRAW];
+    int bound_count;                 // -1 when unknown
+
+    // Per frame
+    uint32_t uploads;                // Light sets sent to the RSP
+    uint32_t skipped;                // Draws that kept the previous set
+} LightManager;
+
+// Light manager functions
+void lights_init(LightManager* mgr, float far_plane);
+int lights_add(LightManager* mgr, const T3DVec3* position, const uint8_t color[4], float radius);
+void lights_remove(LightManager* mgr, int light);
+void lights_set_position(LightManager* mgr, int light, const T3DVec3* position);
+void lights_set_intensity(LightManager* mgr, int light, float intensity);
+int lights_select(LightManager* mgr, const T3DVec3* center, float radius, int* out);
+
+// Rendering: begin_frame after the viewport is attached and the
+// directional lights are set, then apply before each lit draw
+void lights_begin_frame(LightManager* mgr);
+void lights_apply(LightManager* mgr, const T3DVec3* center, float radius);
+void lights_apply_object(void* mgr, const T3DObject* object);
+
+#endif // LIGHTS_H
@@ -8,6 +8,16 @@
 #include <math.h>
 #include "startup.h"
 #include "game.h"
+#include "profiler.h"
+#include "timestep.h"
+#include "frame_alloc.h"
+#include "scene_arena.h"
+#include "rdp_stats.h"
+#include "dynres.h"
+#include "replay.h"
+#include "animation.h"
+#include "sound.h"
+#include "latency.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -15,18 +25,13 @@
 
 #define SCREEN_TIME_TICKS (2 * TICKS_PER_SECOND)
 
-sprite_t *libdr_title;
-sprite_t *tiny3D_title;
-sprite_t *startscreen;
-wav64_t gamestart;
-wav64_t titlesong;
-
 surface_t *depthBuffer;
 
 startup_state_t startup_state;
 bool isGameStarted;
 bool isPaused;
 u_uint32_t last_time;
+FixedTimestep sim_timestep;
 
 struct player {
     T3DVec3 position;
@@ -53,80 +58,171 @@ void initialize() {
     timer_init();
     console_init();
     joypad_init();
-    audio_init(48000, 4);
-    mixer_init(20);
+    sound_init();
 
-	display_init(RESOLUTION_640x480, DEPTH_16_BPP, 3, GAMMA_NONE, FILTERS_RESAMPLE_ANTIALIAS_DEDITHER);
+	display_init(RESOLUTION_640x480, DEPTH_16_BPP, DISPLAY_BUFFER_COUNT, GAMMA_NONE, FILTERS_RESAMPLE_ANTIALIAS_DEDITHER);
 	dfs_init(DFS_DEFAULT_LOCATION);
     t3d_init((T3DInitParams){});
     rdpq_init();
     rdpq_debug_start();
+    frame_alloc_init(FRAME_ALLOC_SIZE);
+    scene_arena_init(SCENE_ARENA_SIZE, SCENE_ARENA_UNCACHED_SIZE);
+    rdp_stats_init();
+    dynres_init();
+    replay_init();
+    latency_init();
 
-    //libdr_title = sprite_load("rom:/libdragon.sprite");
-    //tiny3D_title = sprite_load("rom:/tiny3d.sprite");
-    //startscreen = sprite_load("rom:/startscreen.sprite");
-    //wav64_open(&gamestart, "rom:/gamestart.wav64");
-    //wav64_open(&titlesong, "rom:/pianoanime.wav64");
-    
     // Initialize fonts for menu
     startup_init_fonts();
+
+    // Frame profiler (compiled out when DEBUG=0)
+    profiler_init();
 }
 
 int main(void) {
+    startup_timing_begin();
     initialize();
     
     // Initialize lighting vectors
     t3d_vec3_norm(&lightDirVec);
     t3d_vec3_norm(&lightDirVec2);
     
-    // Initialize tunnel scene
-    tunnel_scene_init();
-    
     depthBuffer = display_get_zbuf();
 
-    // startup_state = STARTUP_LIBDRAGON_LOGO;
-    // isGameStarted = false;
-    // last_time = timer_ticks();
+    // The tunnel scene loads a stage at a time behind the startup screens.
+    // Replays skip them and load it at once.
+    tunnel_scene_load_begin();
+    bool sceneReady = false;
+    if (STARTUP_SCREENS && !replay_is_playing()) {
+        startup_begin();
+        startup_state = STARTUP_LIBDRAGON_LOGO;
+        isGameStarted = false;
+        last_time = timer_ticks();
+    } else {
+        sceneReady = tunnel_scene_load(true);
+        startup_timing_scene_ready(tunnel_scene.loadUs, tunnel_scene.loadMaxStepUs);
+        isGameStarted = true;
+    }
+    timestep_init(&sim_timestep);
+    
+    // Replays measure a fixed workload, so don't let the resolution adapt
+    if (replay_is_playing()) {
+        dynres_pin(DYNRES_PRESET_640x480);
+    }
 
-    isGameStarted = true; //debug disabling startup
+    SoundStats sound_last = *sound_stats();
+    joypad_buttons_t held_last = {0};
 
 	while (1) {
+        profiler_frame_begin();
+
+        // Top up the audio before possibly blocking on a free framebuffer
+        profiler_scope_begin(PROF_SCOPE_AUDIO);
+        sound_pump();
+        profiler_scope_end(PROF_SCOPE_AUDIO);
+
+        // The frame's only framebuffer: drawn by the startup screens or the
+        // scene, shown once at the end
+        profiler_scope_begin(PROF_SCOPE_DISPLAY_WAIT);
         surface_t* disp = display_get();
+        profiler_scope_end(PROF_SCOPE_DISPLAY_WAIT);
+        uint32_t frame_start = TICKS_READ();
+        
+        // Mixes and decodes streamed music. Pumped again between the heavy
+        // phases below, so a slow frame eats into the buffered lead instead
+        // of starving playback.
+        profiler_scope_begin(PROF_SCOPE_AUDIO);
+        sound_update();
+        profiler_scope_end(PROF_SCOPE_AUDIO);
+
+        // Startup images stream in, and are freed once drawn for the last
+        // time. Behind the startup screens, the scene loads a budget's worth.
+        startup_stream(STARTUP_STREAM_BUDGET_US);
+        if (!isGameStarted && !sceneReady) {
+            sceneReady = tunnel_scene_load(false);
+            if (sceneReady) startup_timing_scene_ready(tunnel_scene.loadUs, tunnel_scene.loadMaxStepUs);
+            
+            profiler_scope_begin(PROF_SCOPE_AUDIO);
+            sound_pump();
+            profiler_scope_end(PROF_SCOPE_AUDIO);
+        }
 
+        // Input is sampled after every wait, right before the simulation.
+        // Presses are edges against last frame's first poll, so the scene
+        // polling again later in the frame can't swallow them.
         joypad_poll();
-        
-        if (audio_can_write()) {
-            // Select an audio buffer that we can write to
-            short *buf = audio_write_begin();
-            // Write to the audio buffer from the mixer
-            mixer_poll(buf, audio_get_buffer_length());
-            // Tell the audio system that the buffer has
-            // been filled and is ready for playback
-            audio_write_end();
-	    }
-	    
-	    // Ensure audio playback coordination
-	    mixer_try_play();
-
-        joypad_buttons_t button = joypad_get_buttons_pressed(JOYPAD_PORT_1);
+        latency_frame_sampled();
+        joypad_buttons_t held = joypad_get_buttons(JOYPAD_PORT_1);
+        joypad_buttons_t button = {.raw = held.raw & ~held_last.raw};
+        held_last = held;
+        profiler_handle_input(button, held);
+        replay_handle_input(button, held);
         
         if (!isGameStarted) {
-            isGameStarted = handle_startup_sequence(disp, button, &startup_state, &last_time);
-        }
-
-        if (isGameStarted) {
+            isGameStarted = handle_startup_sequence(disp, button, &startup_state, &last_time, sceneReady);
+            if (isGameStarted) {
+                // Don't let the time spent in menus turn into catch-up ticks
+                timestep_init(&sim_timestep);
+            }
+            // The screens show disp themselves, once the RDP is done with it
+            startup_timing_frame_shown();
+        } else {
             // Get continuous button input for smooth movement
-            joypad_buttons_t continuous_button = joypad_get_buttons(JOYPAD_PORT_1);
             joypad_inputs_t continuous_inputs = joypad_get_inputs(JOYPAD_PORT_1);
             
-            // Update tunnel scene
-            tunnel_scene_update(continuous_button, continuous_inputs);
+            // Run however many fixed simulation ticks have elapsed. Replays
+            // run in lockstep instead, one tick per frame and no blending,
+            // so every run renders exactly the same frames.
+            int ticks = timestep_begin_frame(&sim_timestep);
+            float alpha = timestep_alpha(&sim_timestep);
+            if (replay_is_playing()) {
+                ticks = 1;
+                alpha = 1.0f;
+            }
             
-            // Render tunnel scene
-            tunnel_scene_render();
+            profiler_scope_begin(PROF_SCOPE_UPDATE);
+            animation_begin_frame();
+            for (int i = 0; i < ticks; i++) {
+                // Recorded or replaced by the replay stream, per tick
+                joypad_inputs_t tick_inputs = replay_tick(continuous_inputs);
+                tunnel_scene_update(tick_inputs.btn, tick_inputs);
+            }
+            profiler_scope_end(PROF_SCOPE_UPDATE);
+
+            profiler_scope_begin(PROF_SCOPE_AUDIO);
+            sound_pump();
+            profiler_scope_end(PROF_SCOPE_AUDIO);
+            
+            // Render tunnel scene, interpolated between the last two ticks;
+            // it shows disp when done
+            frame_alloc_begin_frame();
+            tunnel_scene_render(disp, alpha);
+            frame_alloc_end_frame();
+            profiler_set_counter(PROF_COUNTER_FRAME_PEAK_BYTES, frame_alloc_get_high_water());
+            startup_timing_frame_shown();
+            startup_timing_interactive();
+
+            profiler_scope_begin(PROF_SCOPE_AUDIO);
+            sound_pump();
+            profiler_scope_end(PROF_SCOPE_AUDIO);
         }
-        
-        // Show the completed frame
-        display_show(disp);
+        latency_frame_submitted();
+        profiler_set_counter(PROF_COUNTER_INPUT_LATENCY_US, latency_last_us());
+
+        // Feed this frame's RDP load to the resolution controller
+        rdp_stats_sample();
+        dynres_update(rdp_stats_last_us());
+        uint32_t frame_us = TICKS_TO_US(TICKS_DISTANCE(frame_start, TICKS_READ()));
+        replay_frame_end(frame_us, rdp_stats_last_us());
+        crowd_stress_frame_end(&tunnel_scene.crowd, frame_us);
+        sound_stress_frame_end();
+        latency_frame_end(rdp_stats_last_us());
+
+        const SoundStats* sound = sound_stats();
+        profiler_set_counter(PROF_COUNTER_AUDIO_FILLS, sound->fills - sound_last.fills);
+        profiler_set_counter(PROF_COUNTER_AUDIO_UNDERRUNS, sound->underruns - sound_last.underruns);
+        sound_last = *sound;
+
+        profiler_frame_end();
     }
 }
\ No newline at end of file
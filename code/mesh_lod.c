@@ -0,0 +1,88 @@
+#include "mesh_lod.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static const float mesh_lod_switch[MESH_LOD_MAX - 1] = {MESH_LOD_SIZE_1, MESH_LOD_SIZE_2};
+
+static MeshLodFrameStats mesh_lod_stats;
+
+static uint32_t mesh_lod_count_tris(const T3DModel* model) {
+    uint32_t tris = 0;
+    T3DModelIter it = t3d_model_iter_create(model, T3D_CHUNK_TYPE_OBJECT);
+    while (t3d_model_iter_next(&it)) {
+        tris += it.object->triCount;
+    }
+    return tris;
+}
+
+void mesh_lod_init(MeshLod* lod, T3DModel* model, const char* base_path, int count, float radius) {
+    assertf(count >= 1 && count <= MESH_LOD_MAX, "Mesh LOD: %d levels for %s", count, base_path);
+    memset(lod, 0, sizeof(MeshLod));
+    lod->levels[0] = model;
+    lod->tris[0] = mesh_lod_count_tris(model);
+    lod->count = count;
+    lod->radius = radius;
+
+    for (int i = 1; i < count; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "%s_lod%d.t3dm", base_path, i);
+        lod->levels[i] = t3d_model_load(path);
+        lod->tris[i] = mesh_lod_count_tris(lod->levels[i]);
+        //debugf("Mesh LOD %s: %lu triangles\n", path, (unsigned long)lod->tris[i]);
+    }
+}
+
+float mesh_lod_screen_size(const T3DViewport* viewport, const T3DVec3* center, float radius) {
+    // View-space depth from the camera matrix (column-major), then the
+    // projection's vertical scale: 1 / tan(fov / 2)
+    const T3DMat4* cam = &viewport->matCamera;
+    float depth = fabsf(cam->m[0][2] * center->x + cam->m[1][2] * center->y +
+                        cam->m[2][2] * center->z + cam->m[3][2]);
+    if (depth <= radius) return 1.0f;
+    return radius * viewport->matProj.m[1][1] / depth;
+}
+
+int mesh_lod_select(const MeshLod* lod, int current, float screen_size) {
+    int level = current < lod->count ? current : lod->count - 1;
+
+    // Only move once clearly past a switch point, so sizes near one don't flicker
+    while (level + 1 < lod->count && screen_size < mesh_lod_switch[level] * (1.0f - MESH_LOD_HYSTERESIS)) {
+        level++;
+    }
+    while (level > 0 && screen_size > mesh_lod_switch[level - 1] * (1.0f + MESH_LOD_HYSTERESIS)) {
+        level--;
+    }
+    return level;
+}
+
+void mesh_lod_draw(const MeshLod* lod, int level) {
+    t3d_model_draw(lod->levels[level]);
+    mesh_lod_stats.tris[level] += lod->tris[level];
+    mesh_lod_stats.draws[level]++;
+}
+
+void mesh_lod_draw_skinned(const MeshLod* lod, int level, const T3DSkeleton* skeleton) {
+    t3d_model_draw_skinned(lod->levels[level], skeleton);
+    mesh_lod_stats.tris[level] += lod->tris[level];
+    mesh_lod_stats.draws[level]++;
+}
+
+void mesh_lod_cleanup(MeshLod* lod) {
+    for (int i = 1; i < lod->count; i++) {
+        if (lod->levels[i]) {
+            t3d_model_free(lod->levels[i]);
+            lod->levels[i] = NULL;
+        }
+    }
+    lod->levels[0] = NULL;
+    lod->count = 0;
+}
+
+void mesh_lod_begin_frame(void) {
+    memset(&mesh_lod_stats, 0, sizeof(mesh_lod_stats));
+}
+
+const MeshLodFrameStats* mesh_lod_frame_stats(void) {
+    return &mesh_lod_stats;
+}
@@ -0,0 +1,49 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <libdragon.h>
+#include <t3d/t3d.h>
+#include <t3d/t3dmath.h>
+#include <t3d/t3dmodel.h>
+#include <t3d/t3dskeleton.h>
+
+// Simplified versions of a model, <base>_lod1.t3dm and up, generated by
+// tools/gltf_lod.py (LOD_MODELS in the makefile). Every level keeps the
+// full model's skin, so all of them draw with the same skeleton. Props
+// without a skin draw through mesh_lod_draw.
+
+#define MESH_LOD_MAX 3
+
+// Projected size (bounding sphere diameter over viewport height) below
+// which level 1, then level 2 is drawn. Sizes are relative, so dynamic
+// resolution doesn't move the switch points.
+#define MESH_LOD_SIZE_1 0.40f
+#define MESH_LOD_SIZE_2 0.22f
+#define MESH_LOD_HYSTERESIS 0.15f    // Relative margin around each switch point
+
+typedef struct {
+    T3DModel* levels[MESH_LOD_MAX];  // levels[0] is the full model, owned by the caller
+    uint32_t tris[MESH_LOD_MAX];
+    int count;
+    float radius;                    // Bounding sphere radius, world units
+} MeshLod;
+
+// Triangles submitted this frame, for the profiler
+typedef struct {
+    uint32_t tris[MESH_LOD_MAX];
+    uint32_t draws[MESH_LOD_MAX];
+} MeshLodFrameStats;
+
+// Mesh LOD functions
+void mesh_lod_init(MeshLod* lod, T3DModel* model, const char* base_path, int count, float radius);
+float mesh_lod_screen_size(const T3DViewport* viewport, const T3DVec3* center, float radius);
+int mesh_lod_select(const MeshLod* lod, int current, float screen_size);
+void mesh_lod_draw(const MeshLod* lod, int level);
+void mesh_lod_draw_skinned(const MeshLod* lod, int level, const T3DSkeleton* skeleton);
+void mesh_lod_cleanup(MeshLod* lod);
+
+// Once per rendered frame, before drawing
+void mesh_lod_begin_frame(void);
+const MeshLodFrameStats* mesh_lod_frame_stats(void);
+
+#endif // MESH_LOD_H
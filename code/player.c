@@ -1,7 +1,8 @@
-#include <stdbool.h>
-bool g_is_running = false;
 #include "player.h"
 #include "controls.h"
+#include "timestep.h"
+#include "frame_alloc.h"
+#include "profiler.h"
 #include <malloc.h>
 #include <math.h>
 
@@ -15,38 +16,61 @@ void player_init(Player* player) {
     player->rotation_y = M_PI/2 + M_PI;  // Face opposite direction (180 degrees rotated)
     player->move_speed = PLAYER_SPEED;
     player->turn_speed = TURN_SPEED;
+    player->input = (PlayerInput){0};
+    player->yaw_correction = 0.0f;
+    player->prev_position = player->position;
+    player->prev_rotation_y = player->rotation_y;
     
     // Initialize jump physics
     player->velocity_y = 0.0f;
     player->ground_y = 0.0f;  // Ground level
     player->is_grounded = true;
     player->jump_requested = false;
+    player->events = 0;
+    player->stride = 0.0f;
+    player->collision = NULL;
     
     // Load player model (textures are embedded in .t3dm file)
     player->model = t3d_model_load("rom:/player3.t3dm");
     player->texture = NULL;  // Not needed for T3D models
+    mesh_lod_init(&player->mesh_lod, player->model, "rom:/player3", PLAYER_MESH_LODS, PLAYER_MESH_RADIUS);
+    player->mesh_level = 0;
     
     // Create skeleton for skinned rendering like animation example
     player->skeleton = t3d_skeleton_create(player->model);
     t3d_skeleton_update(&player->skeleton);
+    player->skeleton_owned_mats = player->skeleton.boneMatricesFP;
     
-    // Allocate uncached memory for player model matrix (required for RSP DMA)
-    player->modelMat = malloc_uncached(sizeof(T3DMat4FP));
-    t3d_mat4fp_identity(player->modelMat);
+    // Model and bone matrices are taken from the frame allocator every frame,
+    // so the CPU never overwrites data the RSP is still reading
+    player->modelMat = NULL;
     
-    // Initialize animation system
-    animation_system_init(&player->anim_system, player->model);
+    // Initialize animation system from the player's state machine
+    player->anim_graph = animation_graph_load("rom:/player3.anim");
+    animation_system_init(&player->anim_system, player->anim_graph, player->model);
+    player->anim_system.priority = ANIM_PRIORITY_HIGH;
+}
+
+static float player_turn_speed(const Player* player, const PlayerInput* input) {
+    return input->run ? player->turn_speed * RUN_TURN_FACTOR : player->turn_speed;
 }
 
 void player_update(Player* player, joypad_buttons_t buttons, joypad_inputs_t inputs, bool debug_menu_active) {
+    // Remember last tick's pose so rendering can interpolate towards this one
+    player->prev_position = player->position;
+    player->prev_rotation_y = player->rotation_y;
+    player->events = 0;
+    bool was_grounded = player->is_grounded;
+    
     // Get normalized input from controls system
     PlayerInput input = controls_get_player_input(buttons, inputs);
+    player->input = input;
     
     // Check if player has any movement input for animation system
     bool is_moving = (fabs(input.move_forward) > 0.1f) || (fabs(input.move_right) > 0.1f) || (fabs(input.turn_rate) > 0.1f);
 
     // Detect running: Z trigger + analog stick forward/back
-    g_is_running = input.run && (fabs(input.move_forward) > 0.1f);
+    bool is_running = input.run && (fabs(input.move_forward) > 0.1f);
     
     // Check if player is jumping
     bool is_jumping = input.jump;
@@ -57,24 +81,42 @@ void player_update(Player* player, joypad_buttons_t buttons, joypad_inputs_t inp
         player->velocity_y = JUMP_SPEED;
         player->is_grounded = false;
         player->jump_requested = true;
+        player->events |= PLAYER_EVENT_JUMPED;
         //debugf("Jump started with velocity: %.2f\n", player->velocity_y);
     } else if (!input.jump) {
         // Reset jump request when button is released
         player->jump_requested = false;
     }
     
-    // Apply gravity and update vertical position (direct per-frame physics)
-    player->velocity_y -= GRAVITY;
-    player->position.y += player->velocity_y;
+    // Find the floor under the player, stepping up small ledges
+    if (player->collision) {
+        float floor_y;
+        if (collision_ground_height(player->collision, player->position.x, player->position.z,
+                                    player->position.y + PLAYER_STEP_HEIGHT, &floor_y)) {
+            player->ground_y = floor_y;
+        }
+    }
+    
+    // Apply gravity and update vertical position. Integrating the constant
+    // acceleration exactly keeps the jump arc identical at any tick rate.
+    player->position.y += player->velocity_y * SIM_DT - 0.5f * GRAVITY * SIM_DT * SIM_DT;
+    player->velocity_y -= GRAVITY * SIM_DT;
     
     //debugf("Jump physics - Y: %.2f, Vel: %.2f, Grounded: %d\n", player->position.y, player->velocity_y, player->is_grounded);
     
-    // Ground collision
-    if (player->position.y <= player->ground_y) {
+    // Ground collision. While walking, stay glued to floors sloping or
+    // stepping down instead of briefly going airborne.
+    bool snap_down = player->is_grounded && player->velocity_y <= 0.0f &&
+                     player->position.y - player->ground_y <= PLAYER_STEP_HEIGHT;
+    if (player->position.y <= player->ground_y || snap_down) {
         player->position.y = player->ground_y;
         player->velocity_y = 0.0f;
         player->is_grounded = true;
+        if (!was_grounded) player->events |= PLAYER_EVENT_LANDED;
         //debugf("Player landed\n");
+    } else {
+        // Walked off a ledge or still in the air
+        player->is_grounded = false;
     }
     
     // Update jump state for animation - only consider jumping if in air
@@ -84,8 +126,8 @@ void player_update(Player* player, joypad_buttons_t buttons, joypad_inputs_t inp
     float moveX = 0.0f, moveZ = 0.0f;
     
     // Apply movement speed modifier if running
-    float currentMoveSpeed = player->move_speed;
-    if (g_is_running) {
+    float currentMoveSpeed = player->move_speed * SIM_DT;
+    if (is_running) {
         currentMoveSpeed *= 2.0f; // Much faster when running
     }
     
@@ -105,66 +147,144 @@ void player_update(Player* player, joypad_buttons_t buttons, joypad_inputs_t inp
     
     // Turning
     if (input.turn_rate != 0.0f) {
-        float currentTurnSpeed = player->turn_speed;
-        if (input.run) {
-            currentTurnSpeed *= 1.3f; // Faster turning when running
+        player->rotation_y += input.turn_rate * player_turn_speed(player, &input) * SIM_DT;
+    }
+    
+    // Apply movement, sliding along walls when there is level collision
+    if (player->collision) {
+        CollisionCapsule capsule = {PLAYER_RADIUS, PLAYER_HEIGHT};
+        T3DVec3 motion = {{moveX, 0.0f, moveZ}};
+        T3DVec3 contact;
+        if (collision_sweep_capsule(player->collision, &capsule, &player->position, &motion, &contact) &&
+            contact.y < -COLLISION_FLOOR_MIN_NY && player->velocity_y > 0.0f) {
+            player->velocity_y = 0.0f;  // Bumped the ceiling
         }
-        player->rotation_y += input.turn_rate * currentTurnSpeed;
+    } else {
+        player->position.x += moveX;
+        player->position.z += moveZ;
     }
     
-    // Apply movement
-    player->position.x += moveX;
-    player->position.z += moveZ;
+    // A footstep every stride walked on the ground
+    if (player->is_grounded) {
+        float dx = player->position.x - player->prev_position.x;
+        float dz = player->position.z - player->prev_position.z;
+        player->stride += sqrtf(dx * dx + dz * dz);
+        if (player->stride >= PLAYER_STEP_STRIDE) {
+            player->stride -= PLAYER_STEP_STRIDE;
+            player->events |= PLAYER_EVENT_STEP;
+        }
+    }
     
     // Keep rotation in 0-2π range
     if (player->rotation_y < 0) player->rotation_y += 2 * M_PI;
     if (player->rotation_y >= 2 * M_PI) player->rotation_y -= 2 * M_PI;
     
     // Update animation system 
-    animation_system_update(&player->anim_system, &player->skeleton, is_moving, is_jumping, debug_menu_active);
+    uint32_t anim_conditions = 0;
+    if (is_moving) anim_conditions |= ANIM_COND_MOVING;
+    if (is_running) anim_conditions |= ANIM_COND_RUNNING;
+    if (is_jumping) anim_conditions |= ANIM_COND_JUMPING;
+    animation_system_update(&player->anim_system, &player->skeleton, anim_conditions, debug_menu_active, SIM_DT);
+}
+
+// Late-latched turning: the turn the newest input would have added since
+// the last tick, on top of what that tick's input already did. Applied to
+// the rendered rotation and camera only; the next tick simulates it for real.
+float player_late_turn(Player* player, joypad_buttons_t buttons, joypad_inputs_t inputs, float seconds) {
+    PlayerInput late = controls_get_player_input(buttons, inputs);
+    float rate = late.turn_rate * player_turn_speed(player, &late) -
+                 player->input.turn_rate * player_turn_speed(player, &player->input);
+    float limit = player->turn_speed * RUN_TURN_FACTOR * SIM_DT;
+    float yaw = rate * seconds;
+    if (yaw > limit) yaw = limit;
+    if (yaw < -limit) yaw = -limit;
+    player->yaw_correction = yaw;
+    return yaw;
+}
+
+void player_update_render(Player* player, float alpha) {
+    // Blend between the last two simulation ticks
+    T3DVec3 renderPos;
+    t3d_vec3_lerp(&renderPos, &player->prev_position, &player->position, alpha);
+    
+    // Rotation wraps at 2π, so interpolate along the shortest arc
+    float deltaRot = player->rotation_y - player->prev_rotation_y;
+    if (deltaRot > M_PI) deltaRot -= 2 * M_PI;
+    if (deltaRot < -M_PI) deltaRot += 2 * M_PI;
+    float renderRot = player->prev_rotation_y + deltaRot * alpha + player->yaw_correction;
     
     // Update player model matrix
-    float modelOffsetX = sinf(player->rotation_y) * 20.0f;
-    float modelOffsetZ = -cosf(player->rotation_y) * 20.0f;
+    float modelOffsetX = sinf(renderRot) * 20.0f;
+    float modelOffsetZ = -cosf(renderRot) * 20.0f;
     
-    float playerModelX = player->position.x + modelOffsetX;
-    float playerModelY = player->position.y;  // Same level as tunnel floor
-    float playerModelZ = player->position.z + modelOffsetZ;
+    float playerModelX = renderPos.x + modelOffsetX;
+    float playerModelY = renderPos.y;  // Same level as tunnel floor
+    float playerModelZ = renderPos.z + modelOffsetZ;
     
     // Update player model matrix using proper T3D transformation
     float scale[3] = {1.22f, 1.22f, 1.22f}; //1.2 scale 2.75m player for 5m scenes
-    float rotation[3] = {0.0f, player->rotation_y + M_PI, 0.0f};  // Add 180 degrees (π radians) to face correct direction
+    float rotation[3] = {0.0f, renderRot + M_PI, 0.0f};  // Add 180 degrees (π radians) to face correct direction
     float position[3] = {playerModelX, playerModelY, playerModelZ};
     
+    player->modelMat = frame_alloc_mat4fp(1);
     t3d_mat4fp_from_srt_euler(player->modelMat, scale, rotation, position);
+    
+    // Build this frame's bone matrices from the pose animated during the ticks
+    profiler_scope_begin(PROF_SCOPE_SKELETON);
+    animation_system_update_skeleton(&player->anim_system, &player->skeleton);
+    profiler_scope_end(PROF_SCOPE_SKELETON);
+}
+
+void player_update_mesh_lod(Player* player, const T3DViewport* viewport) {
+    T3DVec3 center;
+    player_get_model_position(player, &center.x, &center.y, &center.z);
+    center.y += PLAYER_HEIGHT * 0.5f;
+    float size = mesh_lod_screen_size(viewport, &center, player->mesh_lod.radius);
+    player->mesh_level = mesh_lod_select(&player->mesh_lod, player->mesh_level, size);
+}
+
+// Bounding box around the body against the viewport's frustum. Called
+// before the camera is set, so it tests last frame's view.
+bool player_in_view(Player* player, const T3DViewport* viewport) {
+    T3DVec3 center;
+    player_get_model_position(player, &center.x, &center.y, &center.z);
+    center.y += PLAYER_HEIGHT * 0.5f;
+    float r = player->mesh_lod.radius;
+    T3DVec3 min = {{center.x - r, center.y - r, center.z - r}};
+    T3DVec3 max = {{center.x + r, center.y + r, center.z + r}};
+    return t3d_frustum_vs_aabb(&viewport->viewFrustum, &min, &max);
 }
 
 void player_render(Player* player) {
+    // Culled by animation LOD, no bone matrices this frame
+    if (player->anim_system.lod == ANIM_LOD_CULLED) return;
+    
     // Draw the player using skinned model like animation example
     t3d_matrix_push(player->modelMat);
     rdpq_set_prim_color(RGBA32(255, 255, 255, 255)); // Set prim color like animation example
-    t3d_model_draw_skinned(player->model, &player->skeleton);
+    mesh_lod_draw_skinned(&player->mesh_lod, player->mesh_level, &player->skeleton);
     t3d_matrix_pop(1);
 }
 
 void player_cleanup(Player* player) {
+    mesh_lod_cleanup(&player->mesh_lod);
     if (player->model) {
         t3d_model_free(player->model);
         player->model = NULL;
     }
     
-    // Cleanup skeleton like animation example
+    // Cleanup skeleton like animation example, handing back the matrices t3d owns
+    player->skeleton.boneMatricesFP = player->skeleton_owned_mats;
     t3d_skeleton_destroy(&player->skeleton);
     
     // Cleanup animation system
     animation_system_cleanup(&player->anim_system);
+    player->anim_graph = NULL;      // Scene arena memory
     
     // No need to free texture - T3D handles this internally
     
-    if (player->modelMat) {
-        free_uncached(player->modelMat);
-        player->modelMat = NULL;
-    }
+    // Model matrix belongs to the frame allocator
+    player->modelMat = NULL;
 }
 
 void player_get_model_position(Player* player, float* x, float* y, float* z) {
@@ -188,6 +308,28 @@ T3DVec3 player_get_camera_position(Player* player, float camDistance, float camH
     camPos.y = playerModelY + camHeight;
     camPos.z = playerModelZ + camOffsetZ;
     
+    // Pull the camera in front of any wall between it and the player
+    if (player->collision) {
+        T3DVec3 pivot = {{playerModelX, playerModelY + PLAYER_CAMERA_PIVOT_HEIGHT, playerModelZ}};
+        T3DVec3 dir;
+        t3d_vec3_diff(&dir, &camPos, &pivot);
+        float dist = t3d_vec3_len(&dir);
+        
+        CollisionHit hit;
+        if (dist > 0.0f) {
+            t3d_vec3_scale(&dir, &dir, 1.0f / dist);
+            if (collision_raycast(player->collision, &pivot, &dir, dist + PLAYER_CAMERA_WALL_MARGIN, &hit)) {
+                float safe = hit.distance - PLAYER_CAMERA_WALL_MARGIN;
+                if (safe < 0.0f) safe = 0.0f;
+                if (safe < dist) {
+                    camPos.x = pivot.x + dir.x * safe;
+                    camPos.y = pivot.y + dir.y * safe;
+                    camPos.z = pivot.z + dir.z * safe;
+                }
+            }
+        }
+    }
+    
     return camPos;
 }
 
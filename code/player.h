@@ -8,20 +8,49 @@
 #include <t3d/t3dskeleton.h>
 #include <t3d/t3danim.h>
 #include "animation.h"
+#include "controls.h"
+#include "collision.h"
+#include "mesh_lod.h"
 
-#define PLAYER_SPEED 6.5f
-#define TURN_SPEED 0.08f
-#define JUMP_SPEED 15.0f
-#define GRAVITY 0.8f
+// Movement constants are per second (tuned at 60 ticks per second)
+#define PLAYER_SPEED 390.0f   // units/s
+#define TURN_SPEED 4.8f       // rad/s
+#define RUN_TURN_FACTOR 1.3f  // Turning is faster when running
+#define JUMP_SPEED 900.0f     // units/s
+#define GRAVITY 2880.0f       // units/s^2
+
+// Collision shape
+#define PLAYER_RADIUS 24.0f
+#define PLAYER_HEIGHT 140.0f
+#define PLAYER_STEP_HEIGHT 24.0f          // Ledges up to this high are stepped onto
+#define PLAYER_CAMERA_PIVOT_HEIGHT 100.0f // Camera collision rays start here above the feet
+#define PLAYER_CAMERA_WALL_MARGIN 16.0f   // Camera distance kept from walls
+
+// Mesh detail: player3.t3dm plus the makefile's LOD_RATIOS levels
+#define PLAYER_MESH_LODS 3
+#define PLAYER_MESH_RADIUS 80.0f          // Bounding sphere around the middle of the body
+
+// Gameplay events of the last tick, for sound effects
+#define PLAYER_EVENT_JUMPED (1 << 0)
+#define PLAYER_EVENT_LANDED (1 << 1)
+#define PLAYER_EVENT_STEP (1 << 2)
+#define PLAYER_STEP_STRIDE 90.0f          // Ground distance between footsteps
 
 typedef struct {
     T3DVec3 position;
     float rotation_y;
+    T3DVec3 prev_position;     // State at the previous tick, for render interpolation
+    float prev_rotation_y;
     float move_speed;
     float turn_speed;
-    T3DMat4FP* modelMat;
+    PlayerInput input;         // Input of the last tick
+    float yaw_correction;      // Turn from input newer than the last tick, rendering only
+    T3DMat4FP* modelMat;   // Per-frame copy from the frame allocator
     T3DModel* model;
+    MeshLod mesh_lod;      // Simplified meshes sharing the model's skeleton
+    int mesh_level;        // Level drawn this frame
     T3DSkeleton skeleton;  // Add skeleton for skinned rendering
+    T3DMat4FP* skeleton_owned_mats;  // Bone matrices t3d allocated, restored before destroy
     sprite_t* texture;
     
     // Jump physics
@@ -30,13 +59,24 @@ typedef struct {
     bool is_grounded;
     bool jump_requested;
     
+    uint32_t events;           // PLAYER_EVENT_* raised by the last player_update
+    float stride;              // Ground distance since the last footstep
+    
+    // Level collision, NULL to stand on a flat plane at ground_y
+    CollisionWorld* collision;
+    
     // Animation system
+    AnimGraph* anim_graph;
     AnimationSystem anim_system;
 } Player;
 
 // Player management functions
 void player_init(Player* player);
 void player_update(Player* player, joypad_buttons_t buttons, joypad_inputs_t inputs, bool debug_menu_active);
+float player_late_turn(Player* player, joypad_buttons_t buttons, joypad_inputs_t inputs, float seconds);
+void player_update_render(Player* player, float alpha);
+void player_update_mesh_lod(Player* player, const T3DViewport* viewport);
+bool player_in_view(Player* player, const T3DViewport* viewport);
 void player_render(Player* player);
 void player_cleanup(Player* player);
 
@@ -0,0 +1,280 @@
+#include "profiler.h"
+#include "rdp_stats.h"
+
+#if PROFILER_ENABLED
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+// Overlay layout
+#define OVERLAY_FRAMES 64          // Most recent frames shown as bars
+#define OVERLAY_BAR_WIDTH 3
+#define OVERLAY_US_PER_PIXEL 250   // 33.3ms budget is ~133px tall
+#define OVERLAY_LINE_HEIGHT 10
+#define OVERLAY_COLUMN_WIDTH 136   // One "name value" legend column
+
+static const char* scope_names[PROF_SCOPE_COUNT] = {
+    "update", "skeleton", "tunnel", "player", "audio", "vsync", "stream", "crowd"
+};
+
+static const char* counter_names[PROF_COUNTER_COUNT] = {
+    "chunks", "culled", "segments", "strm kb", "strm pk", "frm pk",
+    "blends",
+    "anim 60", "anim 30", "anim 15", "anim 7.5", "anim off", "anim sav",
+    "crowd", "poses",
+    "tris l0", "tris l1", "tris l2",
+    "l upload", "l skip",
+    "a fill", "a under",
+    "sfx play", "sfx cull",
+    "input us"
+};
+
+static const color_t scope_colors[PROF_SCOPE_COUNT] = {
+    RGBA32(0x39, 0xBF, 0x1F, 0xFF),  // update - green
+    RGBA32(0xFF, 0xC0, 0x20, 0xFF),  // skeleton - orange
+    RGBA32(0x40, 0x80, 0xFF, 0xFF),  // tunnel - blue
+    RGBA32(0xC0, 0x40, 0xFF, 0xFF),  // player - purple
+    RGBA32(0x20, 0xE0, 0xE0, 0xFF),  // audio - cyan
+    RGBA32(0x60, 0x60, 0x60, 0xFF),  // vsync - grey
+    RGBA32(0xFF, 0x60, 0xA0, 0xFF),  // stream - pink
+    RGBA32(0xE0, 0xE0, 0x60, 0xFF),  // crowd - yellow
+};
+
+static ProfilerFrame history[PROFILER_HISTORY];
+static int history_head = 0;   // Next slot to write
+static int history_count = 0;
+
+static ProfilerFrame current;
+static uint32_t frame_start_ticks;
+static uint32_t scope_start_ticks[PROF_SCOPE_COUNT];
+
+// Written from the RDP sync-full interrupt callback
+static volatile uint32_t gpu_start_ticks;
+static volatile uint32_t gpu_last_us;
+
+static bool overlay_visible = false;
+static rdpq_font_t* overlay_font = NULL;
+
+// Scratch space for percentile sorting
+static uint32_t sort_buffer[PROFILER_HISTORY];
+
+void profiler_init(void) {
+    history_head = 0;
+    history_count = 0;
+    gpu_last_us = 0;
+    overlay_visible = false;
+
+    overlay_font = rdpq_font_load_builtin(FONT_BUILTIN_DEBUG_MONO);
+    rdpq_text_register_font(PROFILER_FONT_ID, overlay_font);
+
+    rdp_stats_rsp_sampling(true);
+}
+
+void profiler_frame_begin(void) {
+    memset(&current, 0, sizeof(current));
+    frame_start_ticks = TICKS_READ();
+}
+
+void profiler_frame_end(void) {
+    current.frame_us = TICKS_TO_US(TICKS_DISTANCE(frame_start_ticks, TICKS_READ()));
+
+    current.rdp_us = rdp_stats_last_us();
+    current.rsp_us = rdp_stats_rsp_last_us();
+    current.gpu_us = gpu_last_us;
+
+    history[history_head] = current;
+    history_head = (history_head + 1) % PROFILER_HISTORY;
+    if (history_count < PROFILER_HISTORY) history_count++;
+}
+
+void profiler_scope_begin(ProfilerScope scope) {
+    scope_start_ticks[scope] = TICKS_READ();
+}
+
+void profiler_scope_end(ProfilerScope scope) {
+    // Accumulate so scopes entered several times per frame sum up
+    current.scope_us[scope] += TICKS_TO_US(TICKS_DISTANCE(scope_start_ticks[scope], TICKS_READ()));
+}
+
+void profiler_set_counter(ProfilerCounter counter, uint32_t value) {
+    current.counters[counter] = value;
+}
+
+static void gpu_done_callback(void* arg) {
+    gpu_last_us = TICKS_TO_US(TICKS_DISTANCE(gpu_start_ticks, TICKS_READ()));
+}
+
+void profiler_gpu_begin(void) {
+    gpu_start_ticks = TICKS_READ();
+}
+
+void profiler_gpu_end(void) {
+    // Fires once the RDP has drained everything queued for this frame
+    rdpq_sync_full(gpu_done_callback, NULL);
+}
+
+void profiler_handle_input(joypad_buttons_t pressed, joypad_buttons_t held) {
+    // R toggles the overlay, L+R dumps the statistics to the debug log
+    if (pressed.r && held.l) {
+        profiler_dump_stats();
+    } else if (pressed.r) {
+        overlay_visible = !overlay_visible;
+    }
+}
+
+// Index into the ring by age, 0 being the most recent frame
+static const ProfilerFrame* history_get(int age) {
+    int idx = (history_head - 1 - age + PROFILER_HISTORY) % PROFILER_HISTORY;
+    return &history[idx];
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t va = *(const uint32_t*)a;
+    uint32_t vb = *(const uint32_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+typedef struct {
+    uint32_t min;
+    uint32_t avg;
+    uint32_t p99;
+} ProfilerStat;
+
+// Gathers one value per frame from the ring buffer via byte offset
+static ProfilerStat compute_stat(size_t field_offset) {
+    ProfilerStat stat = {0};
+    if (history_count == 0) return stat;
+
+    uint64_t sum = 0;
+    for (int i = 0; i < history_count; i++) {
+        const uint8_t* frame = (const uint8_t*)history_get(i);
+        sort_buffer[i] = *(const uint32_t*)(frame + field_offset);
+        sum += sort_buffer[i];
+    }
+    qsort(sort_buffer, history_count, sizeof(uint32_t), compare_u32);
+
+    int p99_index = (history_count * 99) / 100;
+    if (p99_index >= history_count) p99_index = history_count - 1;
+
+    stat.min = sort_buffer[0];
+    stat.avg = (uint32_t)(sum / history_count);
+    stat.p99 = sort_buffer[p99_index];
+    return stat;
+}
+
+static uint32_t window_average(size_t field_offset, int frames) {
+    uint64_t sum = 0;
+    for (int i = 0; i < frames; i++) {
+        const uint8_t* frame = (const uint8_t*)history_get(i);
+        sum += *(const uint32_t*)(frame + field_offset);
+    }
+    return frames > 0 ? (uint32_t)(sum / frames) : 0;
+}
+
+static void dump_line(const char* name, size_t field_offset) {
+    ProfilerStat stat = compute_stat(field_offset);
+    debugf("  %-9s min %6lu  avg %6lu  p99 %6lu us\n", name,
+           (unsigned long)stat.min, (unsigned long)stat.avg, (unsigned long)stat.p99);
+}
+
+void profiler_dump_stats(void) {
+    debugf("Profiler: %d frames\n", history_count);
+    for (int i = 0; i < PROF_SCOPE_COUNT; i++) {
+        dump_line(scope_names[i], offsetof(ProfilerFrame, scope_us) + i * sizeof(uint32_t));
+    }
+    dump_line("frame", offsetof(ProfilerFrame, frame_us));
+    dump_line("rdp", offsetof(ProfilerFrame, rdp_us));
+    dump_line("rsp", offsetof(ProfilerFrame, rsp_us));
+    dump_line("gpu", offsetof(ProfilerFrame, gpu_us));
+    for (int i = 0; i < PROF_COUNTER_COUNT; i++) {
+        ProfilerStat stat = compute_stat(offsetof(ProfilerFrame, counters) + i * sizeof(uint32_t));
+        debugf("  %-9s min %6lu  avg %6lu  p99 %6lu\n", counter_names[i],
+               (unsigned long)stat.min, (unsigned long)stat.avg, (unsigned long)stat.p99);
+    }
+}
+
+void profiler_render_overlay(void) {
+    if (!overlay_visible || history_count == 0) return;
+
+    int frames = history_count < OVERLAY_FRAMES ? history_count : OVERLAY_FRAMES;
+    float graphHeight = 33333.0f / OVERLAY_US_PER_PIXEL;
+    float posX = 16;
+    float baseY = display_get_height() - 24;
+    float graphWidth = OVERLAY_FRAMES * OVERLAY_BAR_WIDTH;
+
+    rdpq_sync_pipe();
+
+    // Backdrop
+    rdpq_set_mode_fill(RGBA32(0x00, 0x00, 0x00, 0xFF));
+    rdpq_fill_rectangle(posX - 2, baseY - graphHeight - 2, posX + graphWidth + 2, baseY + 2);
+
+    // Stacked CPU scope bars, newest frame on the right
+    for (int age = 0; age < frames; age++) {
+        const ProfilerFrame* frame = history_get(age);
+        float x = posX + graphWidth - (age + 1) * OVERLAY_BAR_WIDTH;
+        float y = baseY;
+
+        for (int s = 0; s < PROF_SCOPE_COUNT; s++) {
+            float h = (float)frame->scope_us[s] / OVERLAY_US_PER_PIXEL;
+            if (h < 1.0f) continue;
+            if (y - h < baseY - graphHeight) h = y - (baseY - graphHeight);
+            rdpq_set_fill_color(scope_colors[s]);
+            rdpq_fill_rectangle(x, y - h, x + OVERLAY_BAR_WIDTH - 1, y);
+            y -= h;
+        }
+
+        // RDP busy marker
+        float rdpY = baseY - (float)frame->rdp_us / OVERLAY_US_PER_PIXEL;
+        if (rdpY < baseY - graphHeight) rdpY = baseY - graphHeight;
+        rdpq_set_fill_color(RGBA32(0xFF, 0x30, 0x30, 0xFF));
+        rdpq_fill_rectangle(x, rdpY, x + OVERLAY_BAR_WIDTH - 1, rdpY + 1);
+    }
+
+    // 60fps and 30fps budget lines
+    rdpq_set_fill_color(RGBA32(0xFF, 0xFF, 0xFF, 0xFF));
+    float line60 = baseY - 16667.0f / OVERLAY_US_PER_PIXEL;
+    rdpq_fill_rectangle(posX, line60, posX + graphWidth, line60 + 1);
+    rdpq_fill_rectangle(posX, baseY - graphHeight, posX + graphWidth, baseY - graphHeight + 1);
+
+    // Legend with averages over the visible window, timings in the first
+    // column and counters flowing through as many more as they need
+    rdpq_sync_pipe();
+    float top = baseY - graphHeight + 8;
+    float bottom = display_get_height() - OVERLAY_LINE_HEIGHT;
+    float textX = posX + graphWidth + 10;
+    float textY = top;
+    for (int s = 0; s < PROF_SCOPE_COUNT; s++) {
+        uint32_t avg = window_average(offsetof(ProfilerFrame, scope_us) + s * sizeof(uint32_t), frames);
+        rdpq_text_printf(NULL, PROFILER_FONT_ID, textX, textY, "%-8s %5.2fms", scope_names[s], avg / 1000.0f);
+        textY += OVERLAY_LINE_HEIGHT;
+    }
+    rdpq_text_printf(NULL, PROFILER_FONT_ID, textX, textY, "rdp      %5.2fms",
+                     window_average(offsetof(ProfilerFrame, rdp_us), frames) / 1000.0f);
+    textY += OVERLAY_LINE_HEIGHT;
+    rdpq_text_printf(NULL, PROFILER_FONT_ID, textX, textY, "rsp      %5.2fms",
+                     window_average(offsetof(ProfilerFrame, rsp_us), frames) / 1000.0f);
+    textY += OVERLAY_LINE_HEIGHT;
+    rdpq_text_printf(NULL, PROFILER_FONT_ID, textX, textY, "gpu      %5.2fms",
+                     window_average(offsetof(ProfilerFrame, gpu_us), frames) / 1000.0f);
+    textY += OVERLAY_LINE_HEIGHT;
+    rdpq_text_printf(NULL, PROFILER_FONT_ID, textX, textY, "frame    %5.2fms",
+                     window_average(offsetof(ProfilerFrame, frame_us), frames) / 1000.0f);
+
+    // Counters show the latest frame
+    const ProfilerFrame* latest = history_get(0);
+    textX += OVERLAY_COLUMN_WIDTH;
+    textY = top;
+    for (int c = 0; c < PROF_COUNTER_COUNT; c++) {
+        if (textY > bottom) {
+            textX += OVERLAY_COLUMN_WIDTH;
+            textY = top;
+        }
+        if (textX + OVERLAY_COLUMN_WIDTH > display_get_width()) break;
+        rdpq_text_printf(NULL, PROFILER_FONT_ID, textX, textY, "%-8s %5lu", counter_names[c],
+                         (unsigned long)latest->counters[c]);
+        textY += OVERLAY_LINE_HEIGHT;
+    }
+}
+
+#endif // PROFILER_ENABLED
@@ -0,0 +1,100 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <libdragon.h>
+
+// The profiler only exists in DEBUG builds. With DEBUG=0 every entry point
+// below is an empty static inline, so call sites compile away completely.
+#if defined(DEBUG) && DEBUG
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+
+#define PROFILER_HISTORY 256     // Frames kept in the ring buffer
+#define PROFILER_FONT_ID 11      // rdpq font slot used by the overlay
+
+// Named CPU scopes recorded every frame
+typedef enum {
+    PROF_SCOPE_UPDATE = 0,
+    PROF_SCOPE_SKELETON,
+    PROF_SCOPE_TUNNEL_DRAW,
+    PROF_SCOPE_PLAYER_DRAW,
+    PROF_SCOPE_AUDIO,
+    PROF_SCOPE_DISPLAY_WAIT,
+    PROF_SCOPE_STREAMING,
+    PROF_SCOPE_CROWD,
+    PROF_SCOPE_COUNT
+} ProfilerScope;
+
+// Per-frame counters reported next to the timings
+typedef enum {
+    PROF_COUNTER_CHUNKS_VISIBLE = 0,
+    PROF_COUNTER_CHUNKS_CULLED,
+    PROF_COUNTER_SEGMENTS_RESIDENT,
+    PROF_COUNTER_STREAM_KB,
+    PROF_COUNTER_STREAM_PEAK_KB,     // Most segment memory resident at once
+    PROF_COUNTER_FRAME_PEAK_BYTES,   // Most frame allocator memory one frame used
+    PROF_COUNTER_ANIM_BLENDS,
+    PROF_COUNTER_ANIM_LOD_FULL,      // Characters per animation LOD, in AnimLod order
+    PROF_COUNTER_ANIM_LOD_HALF,
+    PROF_COUNTER_ANIM_LOD_QUARTER,
+    PROF_COUNTER_ANIM_LOD_EIGHTH,
+    PROF_COUNTER_ANIM_LOD_CULLED,
+    PROF_COUNTER_ANIM_SAVED_US,      // Estimated CPU time animation LOD saved
+    PROF_COUNTER_CROWD_VISIBLE,
+    PROF_COUNTER_CROWD_POSES,        // Distinct poses the visible crowd shares
+    PROF_COUNTER_MESH_LOD0_TRIS,     // Skinned triangles drawn per mesh LOD level
+    PROF_COUNTER_MESH_LOD1_TRIS,
+    PROF_COUNTER_MESH_LOD2_TRIS,
+    PROF_COUNTER_LIGHT_UPLOADS,      // Point light sets sent to the RSP
+    PROF_COUNTER_LIGHT_SKIPS,        // Lit draws that reused the previous set
+    PROF_COUNTER_AUDIO_FILLS,        // Output buffers mixed this frame
+    PROF_COUNTER_AUDIO_UNDERRUNS,    // Pumps that found the audio drained
+    PROF_COUNTER_SFX_STARTED,        // Sound effects given a mixer channel
+    PROF_COUNTER_SFX_CULLED,         // Sound effects inaudible or outranked
+    PROF_COUNTER_INPUT_LATENCY_US,   // Newest input sample to frame submit
+    PROF_COUNTER_COUNT
+} ProfilerCounter;
+
+// One frame worth of samples, times in microseconds
+typedef struct {
+    uint32_t scope_us[PROF_SCOPE_COUNT];
+    uint32_t counters[PROF_COUNTER_COUNT];
+    uint32_t frame_us;   // CPU wall time from frame begin to frame end
+    uint32_t rdp_us;     // RDP command-buffer busy time (DPC counters)
+    uint32_t rsp_us;     // RSP running time, sampled (rdp_stats.h)
+    uint32_t gpu_us;     // Submit-to-RDP-idle span, covers RSP + RDP work
+} ProfilerFrame;
+
+#if PROFILER_ENABLED
+
+void profiler_init(void);
+void profiler_frame_begin(void);
+void profiler_frame_end(void);
+void profiler_scope_begin(ProfilerScope scope);
+void profiler_scope_end(ProfilerScope scope);
+void profiler_gpu_begin(void);
+void profiler_gpu_end(void);
+void profiler_set_counter(ProfilerCounter counter, uint32_t value);
+void profiler_handle_input(joypad_buttons_t pressed, joypad_buttons_t held);
+void profiler_render_overlay(void);
+void profiler_dump_stats(void);
+
+#else
+
+static inline void profiler_init(void) {}
+static inline void profiler_frame_begin(void) {}
+static inline void profiler_frame_end(void) {}
+static inline void profiler_scope_begin(ProfilerScope scope) { (void)scope; }
+static inline void profiler_scope_end(ProfilerScope scope) { (void)scope; }
+static inline void profiler_gpu_begin(void) {}
+static inline void profiler_gpu_end(void) {}
+static inline void profiler_set_counter(ProfilerCounter counter, uint32_t value) { (void)counter; (void)value; }
+static inline void profiler_handle_input(joypad_buttons_t pressed, joypad_buttons_t held) { (void)pressed; (void)held; }
+static inline void profiler_render_overlay(void) {}
+static inline void profiler_dump_stats(void) {}
+
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,64 @@
+#include "rdp_stats.h"
+
+// RDP command-engine registers. The busy counter is 24 bits wide and counts
+// RCP cycles (62.5 MHz), so reading and clearing it once per frame is safe.
+#define DPC_STATUS_REG   ((volatile uint32_t*)0xA410000C)
+#define DPC_BUFBUSY_REG  ((volatile uint32_t*)0xA4100014)
+#define DPC_CLR_COUNTERS (0x0040 | 0x0080 | 0x0100 | 0x0200)  // tmem, pipe, cmd, clock
+#define RCP_CYCLES_TO_US(c) ((uint32_t)(c) * 2 / 125)
+
+// RSP status. rspq halts the RSP whenever its queue runs dry, so a running
+// RSP is a busy one.
+#define SP_STATUS_REG    ((volatile uint32_t*)0xA4040010)
+#define SP_STATUS_HALTED 0x0001
+
+static uint32_t last_busy_us = 0;
+static uint32_t last_rsp_us = 0;
+static timer_link_t* rsp_timer = NULL;
+static volatile uint32_t rsp_busy_samples = 0;
+
+static void rsp_sample_callback(int ovfl) {
+    if (!(*SP_STATUS_REG & SP_STATUS_HALTED)) rsp_busy_samples++;
+}
+
+void rdp_stats_init(void) {
+    last_busy_us = 0;
+    last_rsp_us = 0;
+    *DPC_STATUS_REG = DPC_CLR_COUNTERS;
+}
+
+void rdp_stats_rsp_sampling(bool enable) {
+    if (enable && !rsp_timer) {
+        rsp_busy_samples = 0;
+        rsp_timer = new_timer(TIMER_TICKS(RDP_STATS_RSP_SAMPLE_US), TF_CONTINUOUS, rsp_sample_callback);
+    } else if (!enable && rsp_timer) {
+        delete_timer(rsp_timer);
+        rsp_timer = NULL;
+        last_rsp_us = 0;
+    }
+}
+
+void rdp_stats_sample(void) {
+    // RDP work for a frame overlaps the next CPU frame, so the counter delta
+    // between two frame ends is the steady-state per-frame RDP cost.
+    last_busy_us = RCP_CYCLES_TO_US(*DPC_BUFBUSY_REG & 0xFFFFFF);
+    *DPC_STATUS_REG = DPC_CLR_COUNTERS;
+
+    // Same frame-end to frame-end window, one sample period per busy sample
+    if (rsp_timer) {
+        disable_interrupts();
+        uint32_t busy = rsp_busy_samples;
+        rsp_busy_samples = 0;
+        enable_interrupts();
+        last_rsp_us = busy * RDP_STATS_RSP_SAMPLE_US;
+    }
+}
+
+uint32_t rdp_stats_last_us(void) {
+    return last_busy_us;
+}
+
+// 0 while RSP sampling is off
+uint32_t rdp_stats_rsp_last_us(void) {
+    return last_rsp_us;
+}
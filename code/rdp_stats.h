@@ -0,0 +1,20 @@
+#ifndef RDP_STATS_H
+#define RDP_STATS_H
+
+#include <libdragon.h>
+
+// Samples the RDP hardware busy counter once per frame. Shared by the
+// profiler and dynamic resolution, which both need per-frame RDP load.
+//
+// The RSP has no busy counter. With RSP sampling on, a timer interrupt
+// checks every RDP_STATS_RSP_SAMPLE_US whether it is running, which costs
+// CPU time, so only the profiler turns it on.
+#define RDP_STATS_RSP_SAMPLE_US 200
+
+void rdp_stats_init(void);
+void rdp_stats_rsp_sampling(bool enable);
+void rdp_stats_sample(void);
+uint32_t rdp_stats_last_us(void);
+uint32_t rdp_stats_rsp_last_us(void);
+
+#endif // RDP_STATS_H
@@ -0,0 +1,252 @@
+#include "replay.h"
+#include "timestep.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+#define REPLAY_DUMP_LINE 32          // Bytes per hex line in the debug log dump
+
+// Single replay per run, driven from the main loop
+static InputReplay replay;
+
+static ReplayHeader* replay_header(void) {
+    return (ReplayHeader*)replay.data;
+}
+
+static bool replay_load_rom(void) {
+    FILE* f = fopen(REPLAY_ROM_PATH, "rb");
+    if (f == NULL) return false;
+    fclose(f);
+
+    int size = 0;
+    replay.data = asset_load(REPLAY_ROM_PATH, &size);
+    replay.capacity = size;
+    return true;
+}
+
+static bool replay_load_eeprom(void) {
+    if (eeprom_present() == EEPROM_NONE) return false;
+
+    ReplayHeader header;
+    eeprom_read_bytes((uint8_t*)&header, 0, sizeof(header));
+    if (memcmp(header.magic, REPLAY_MAGIC, 4) != 0) return false;
+
+    uint32_t size = sizeof(header) + header.data_size;
+    if (size > eeprom_total_blocks() * 8) return false;
+
+    replay.data = malloc(size);
+    replay.capacity = size;
+    eeprom_read_bytes(replay.data, 0, size);
+    return true;
+}
+
+void replay_init(void) {
+    memset(&replay, 0, sizeof(replay));
+    replay.mode = REPLAY_MODE;
+
+    if (replay.mode == REPLAY_RECORD) {
+        replay.data = malloc(REPLAY_MAX_BYTES);
+        replay.capacity = REPLAY_MAX_BYTES;
+        replay.offset = sizeof(ReplayHeader);
+
+        ReplayHeader* header = replay_header();
+        memcpy(header->magic, REPLAY_MAGIC, 4);
+        header->version = REPLAY_VERSION;
+        header->tick_hz = SIM_TICK_HZ;
+        header->seed = TICKS_READ();
+        srand(header->seed);
+        replay.active = true;
+        debugf("Replay: recording, hold L and press START to stop\n");
+    } else if (replay.mode == REPLAY_PLAYBACK) {
+        if (!replay_load_rom() && !replay_load_eeprom()) {
+            debugf("Replay: nothing to play back in %s or EEPROM\n", REPLAY_ROM_PATH);
+            replay.mode = REPLAY_OFF;
+            return;
+        }
+
+        ReplayHeader* header = replay_header();
+        assertf(memcmp(header->magic, REPLAY_MAGIC, 4) == 0 && header->version == REPLAY_VERSION,
+                "Bad replay stream");
+        assertf(header->tick_hz == SIM_TICK_HZ, "Replay recorded at %d Hz, build runs at %d Hz",
+                header->tick_hz, SIM_TICK_HZ);
+
+        srand(header->seed);
+        replay.offset = sizeof(ReplayHeader);
+        replay.frame_us = malloc(REPLAY_MAX_FRAMES * sizeof(uint32_t));
+        replay.rdp_us = malloc(REPLAY_MAX_FRAMES * sizeof(uint32_t));
+        replay.active = true;
+        debugf("Replay: playing %lu ticks\n", (unsigned long)header->tick_count);
+    }
+}
+
+bool replay_is_playing(void) {
+    return replay.mode == REPLAY_PLAYBACK && replay.active;
+}
+
+static void replay_flush_repeat(InputReplay* r) {
+    if (r->pending_repeat > 0) {
+        r->data[r->offset++] = REPLAY_REPEAT_FLAG | r->pending_repeat;
+        r->pending_repeat = 0;
+    }
+}
+
+// Appends one tick's input. Returns false, writing nothing, once the
+// buffer can't take a worst-case tick.
+bool replay_encode(InputReplay* r, joypad_inputs_t live) {
+    uint8_t mask = 0;
+    if (live.btn.raw != r->last.btn.raw) mask |= REPLAY_CHANGED_BUTTONS;
+    if (live.stick_x != r->last.stick_x) mask |= REPLAY_CHANGED_STICK_X;
+    if (live.stick_y != r->last.stick_y) mask |= REPLAY_CHANGED_STICK_Y;
+    if (live.cstick_x != r->last.cstick_x) mask |= REPLAY_CHANGED_CSTICK_X;
+    if (live.cstick_y != r->last.cstick_y) mask |= REPLAY_CHANGED_CSTICK_Y;
+    if (live.analog_l != r->last.analog_l) mask |= REPLAY_CHANGED_ANALOG_L;
+    if (live.analog_r != r->last.analog_r) mask |= REPLAY_CHANGED_ANALOG_R;
+
+    // Worst case: a repeat byte, the mask and every field
+    if (r->offset + 1 + 1 + 8 > r->capacity) return false;
+
+    if (mask == 0) {
+        if (++r->pending_repeat == 0x7F) replay_flush_repeat(r);
+    } else {
+        replay_flush_repeat(r);
+        uint8_t* out = r->data + r->offset;
+        *out++ = mask;
+        if (mask & REPLAY_CHANGED_BUTTONS) {
+            *out++ = live.btn.raw >> 8;
+            *out++ = live.btn.raw & 0xFF;
+        }
+        if (mask & REPLAY_CHANGED_STICK_X) *out++ = live.stick_x;
+        if (mask & REPLAY_CHANGED_STICK_Y) *out++ = live.stick_y;
+        if (mask & REPLAY_CHANGED_CSTICK_X) *out++ = live.cstick_x;
+        if (mask & REPLAY_CHANGED_CSTICK_Y) *out++ = live.cstick_y;
+        if (mask & REPLAY_CHANGED_ANALOG_L) *out++ = live.analog_l;
+        if (mask & REPLAY_CHANGED_ANALOG_R) *out++ = live.analog_r;
+        r->offset = out - r->data;
+        r->last = live;
+    }
+    r->ticks++;
+    return true;
+}
+
+// Writes out a repeat still being counted, before the stream is saved
+void replay_encode_end(InputReplay* r) {
+    replay_flush_repeat(r);
+}
+
+// Reads the next tick's input
+joypad_inputs_t replay_decode(InputReplay* r) {
+    if (r->pending_repeat > 0) {
+        r->pending_repeat--;
+        r->ticks++;
+        return r->last;
+    }
+
+    const uint8_t* in = r->data + r->offset;
+    uint8_t code = *in++;
+    if (code & REPLAY_REPEAT_FLAG) {
+        r->pending_repeat = (code & 0x7F) - 1;
+    } else {
+        if (code & REPLAY_CHANGED_BUTTONS) {
+            r->last.btn.raw = (in[0] << 8) | in[1];
+            in += 2;
+        }
+        if (code & REPLAY_CHANGED_STICK_X) r->last.stick_x = *in++;
+        if (code & REPLAY_CHANGED_STICK_Y) r->last.stick_y = *in++;
+        if (code & REPLAY_CHANGED_CSTICK_X) r->last.cstick_x = *in++;
+        if (code & REPLAY_CHANGED_CSTICK_Y) r->last.cstick_y = *in++;
+        if (code & REPLAY_CHANGED_ANALOG_L) r->last.analog_l = *in++;
+        if (code & REPLAY_CHANGED_ANALOG_R) r->last.analog_r = *in++;
+    }
+    r->offset = in - r->data;
+    r->ticks++;
+    return r->last;
+}
+
+joypad_inputs_t replay_tick(joypad_inputs_t live) {
+    if (!replay.active) return live;
+
+    if (replay.mode == REPLAY_RECORD) {
+        if (!replay_encode(&replay, live)) {
+            debugf("Replay: buffer full after %lu ticks\n", (unsigned long)replay.ticks);
+            replay_finish();
+        }
+        return live;
+    }
+
+    if (replay.ticks >= replay_header()->tick_count) {
+        replay_finish();
+        return live;
+    }
+    return replay_decode(&replay);
+}
+
+void replay_handle_input(joypad_buttons_t pressed, joypad_buttons_t held) {
+    // L + START ends a recording
+    if (replay.mode == REPLAY_RECORD && replay.active && pressed.start && held.l) {
+        replay_finish();
+    }
+}
+
+void replay_frame_end(uint32_t frame_us, uint32_t rdp_us) {
+    if (!replay_is_playing() || replay.frame_count >= REPLAY_MAX_FRAMES) return;
+    replay.frame_us[replay.frame_count] = frame_us;
+    replay.rdp_us[replay.frame_count] = rdp_us;
+    replay.frame_count++;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t va = *(const uint32_t*)a;
+    uint32_t vb = *(const uint32_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+static void replay_summary_line(const char* name, uint32_t* values, uint32_t count) {
+    if (count == 0) return;
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) sum += values[i];
+    qsort(values, count, sizeof(uint32_t), compare_u32);
+    debugf("  %-5s min %6lu  avg %6lu  p50 %6lu  p95 %6lu  p99 %6lu  max %6lu us\n", name,
+           (unsigned long)values[0], (unsigned long)(sum / count),
+           (unsigned long)values[count / 2], (unsigned long)values[count * 95 / 100],
+           (unsigned long)values[count * 99 / 100], (unsigned long)values[count - 1]);
+}
+
+static void replay_save(void) {
+    replay_encode_end(&replay);
+    ReplayHeader* header = replay_header();
+    header->tick_count = replay.ticks;
+    header->data_size = replay.offset - sizeof(ReplayHeader);
+
+    if (eeprom_present() != EEPROM_NONE && replay.offset <= eeprom_total_blocks() * 8) {
+        eeprom_write_bytes(replay.data, 0, replay.offset);
+        debugf("Replay: %lu ticks, %lu bytes saved to EEPROM\n",
+               (unsigned long)replay.ticks, (unsigned long)replay.offset);
+    } else {
+        debugf("Replay: %lu ticks, %lu bytes, too large for EEPROM\n",
+               (unsigned long)replay.ticks, (unsigned long)replay.offset);
+    }
+
+    // The log dump turns into assets/replay.rpl with tools/replay_extract.py
+    for (uint32_t i = 0; i < replay.offset; i += REPLAY_DUMP_LINE) {
+        char line[REPLAY_DUMP_LINE * 2 + 1];
+        uint32_t count = replay.offset - i < REPLAY_DUMP_LINE ? replay.offset - i : REPLAY_DUMP_LINE;
+        for (uint32_t j = 0; j < count; j++) sprintf(line + j * 2, "%02x", replay.data[i + j]);
+        debugf("REPLAY %s\n", line);
+    }
+    debugf("REPLAY END\n");
+}
+
+void replay_finish(void) {
+    if (!replay.active) return;
+    replay.active = false;
+
+    if (replay.mode == REPLAY_RECORD) {
+        replay_save();
+    } else if (replay.mode == REPLAY_PLAYBACK) {
+        debugf("Replay summary: %lu ticks, %lu frames\n",
+               (unsigned long)replay.ticks, (unsigned long)replay.frame_count);
+        replay_summary_line("cpu", replay.frame_us, replay.frame_count);
+        replay_summary_line("rdp", replay.rdp_us, replay.frame_count);
+        debugf("REPLAY DONE\n");
+    }
+}
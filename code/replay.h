@@ -0,0 +1,74 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <libdragon.h>
+
+// Replay mode, selectable at build time (REPLAY in the makefile)
+#define REPLAY_OFF 0
+#define REPLAY_RECORD 1
+#define REPLAY_PLAYBACK 2
+
+#ifndef REPLAY_MODE
+#define REPLAY_MODE REPLAY_OFF
+#endif
+
+#define REPLAY_ROM_PATH "rom:/replay.rpl"   // Played back in preference to the EEPROM
+#define REPLAY_MAX_BYTES (16 * 1024)        // Recording buffer
+#define REPLAY_MAX_FRAMES (60 * 60 * 10)    // Frame times kept for the summary
+
+// Stream layout (big-endian):
+//   char magic[4] "RPLY", u16 version, u16 tick_hz, u32 seed, u32 tick_count, u32 data_size
+//   data: per tick either 0x80|n (previous input repeats n ticks, n = 1..127)
+//         or a change mask (REPLAY_CHANGED_*) followed by the changed fields
+#define REPLAY_MAGIC "RPLY"
+#define REPLAY_VERSION 1
+
+#define REPLAY_CHANGED_BUTTONS  (1 << 0)    // u16
+#define REPLAY_CHANGED_STICK_X  (1 << 1)    // s8
+#define REPLAY_CHANGED_STICK_Y  (1 << 2)
+#define REPLAY_CHANGED_CSTICK_X (1 << 3)
+#define REPLAY_CHANGED_CSTICK_Y (1 << 4)
+#define REPLAY_CHANGED_ANALOG_L (1 << 5)    // u8
+#define REPLAY_CHANGED_ANALOG_R (1 << 6)
+#define REPLAY_REPEAT_FLAG 0x80
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t tick_hz;
+    uint32_t seed;
+    uint32_t tick_count;
+    uint32_t data_size;
+} ReplayHeader;
+
+typedef struct {
+    int mode;
+    bool active;                 // Recording, or playback not finished yet
+    uint8_t* data;               // Header followed by the encoded stream
+    uint32_t capacity;
+    uint32_t offset;             // Read/write position in the stream
+    uint32_t ticks;              // Ticks recorded or played so far
+    joypad_inputs_t last;        // Previous tick's input, the delta base
+    uint8_t pending_repeat;      // Unchanged ticks not yet written / still to replay
+
+    // Frame times collected during playback
+    uint32_t* frame_us;
+    uint32_t* rdp_us;
+    uint32_t frame_count;
+} InputReplay;
+
+// Replay functions
+void replay_init(void);
+bool replay_is_playing(void);
+joypad_inputs_t replay_tick(joypad_inputs_t live);
+void replay_handle_input(joypad_buttons_t pressed, joypad_buttons_t held);
+void replay_frame_end(uint32_t frame_us, uint32_t rdp_us);
+void replay_finish(void);
+
+// Stream coding on any InputReplay with data and capacity set, offset
+// past the header
+bool replay_encode(InputReplay* r, joypad_inputs_t live);
+void replay_encode_end(InputReplay* r);
+joypad_inputs_t replay_decode(InputReplay* r);
+
+#endif // REPLAY_H
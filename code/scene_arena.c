@@ -0,0 +1,122 @@
+#include "scene_arena.h"
+#include <malloc.h>
+#include <stdio.h>
+
+// One arena, reused by every scene in turn
+static SceneArena scene_arena;
+
+// Heap bytes in use: newlib's count on the N64 (the only big-endian build),
+// the host stubs' own count of the game's allocations elsewhere
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static uint32_t scene_arena_heap_used(void) { return mallinfo().uordblks; }
+#else
+static uint32_t scene_arena_heap_used(void) { return host_heap_used(); }
+#endif
+
+static void scene_arena_region_reset(SceneArenaRegion* region) {
+    region->offset = 0;
+    region->peak = 0;
+    region->padding = 0;
+}
+
+void scene_arena_init(uint32_t cached_size, uint32_t uncached_size) {
+    SceneArena* arena = &scene_arena;
+
+    arena->cached.size = (cached_size + SCENE_ARENA_ALIGN - 1) & ~(SCENE_ARENA_ALIGN - 1);
+    arena->cached.buffer = memalign(SCENE_ARENA_ALIGN, arena->cached.size);
+    arena->uncached.size = (uncached_size + SCENE_ARENA_ALIGN - 1) & ~(SCENE_ARENA_ALIGN - 1);
+    arena->uncached.buffer = malloc_uncached_aligned(SCENE_ARENA_ALIGN, arena->uncached.size);
+    scene_arena_region_reset(&arena->cached);
+    scene_arena_region_reset(&arena->uncached);
+    arena->scene = NULL;
+    arena->allocations = 0;
+    arena->heap_leaked = 0;
+
+    // The C library sets up its stdio state on the first fopen and keeps
+    // it; do that now so the first scene to load a file isn't blamed
+    FILE* f = fopen("rom:/", "rb");
+    if (f) fclose(f);
+}
+
+void scene_arena_begin(const char* scene) {
+    SceneArena* arena = &scene_arena;
+    assertf(arena->scene == NULL, "Scene %s started before %s ended", scene, arena->scene);
+
+    arena->scene = scene;
+    arena->allocations = 0;
+    arena->heap_start = scene_arena_heap_used();
+}
+
+static void* scene_arena_region_alloc(SceneArenaRegion* region, uint32_t size, const char* kind) {
+    SceneArena* arena = &scene_arena;
+    assertf(arena->scene != NULL, "Scene allocation outside a scene");
+
+    // Sizes are kept as asked, only the start is aligned; the gap counts as padding
+    uint32_t start = (region->offset + SCENE_ARENA_ALIGN - 1) & ~(SCENE_ARENA_ALIGN - 1);
+    assertf(start + size <= region->size,
+            "Scene arena overflow (%s, %s): %lu + %lu > %lu bytes", arena->scene, kind,
+            (unsigned long)start, (unsigned long)size, (unsigned long)region->size);
+
+    region->padding += start - region->offset;
+    region->offset = start + size;
+    if (region->offset > region->peak) {
+        region->peak = region->offset;
+    }
+    arena->allocations++;
+    return region->buffer + start;
+}
+
+void* scene_alloc(uint32_t size) {
+    return scene_arena_region_alloc(&scene_arena.cached, size, "cached");
+}
+
+void* scene_alloc_uncached(uint32_t size) {
+    return scene_arena_region_alloc(&scene_arena.uncached, size, "uncached");
+}
+
+// Reads a whole file into the arena, like asset_load() without the malloc
+void* scene_alloc_file(const char* path, int* size) {
+    int file_size = 0;
+    FILE* f = asset_fopen(path, &file_size);
+    void* data = scene_alloc(file_size);
+    assertf(fread(data, 1, file_size, f) == (size_t)file_size, "Short read on %s", path);
+    fclose(f);
+
+    if (size) *size = file_size;
+    return data;
+}
+
+// Call after the scene's cleanup functions: everything still on the heap
+// beyond what was there when the scene began is reported as leaked
+void scene_arena_end(void) {
+    SceneArena* arena = &scene_arena;
+    assertf(arena->scene != NULL, "Scene arena ended outside a scene");
+
+    uint32_t heap_now = scene_arena_heap_used();
+    arena->heap_leaked = heap_now > arena->heap_start ? heap_now - arena->heap_start : 0;
+    debugf("Scene %s: %lu allocations, peak %lu/%lu cached (%lu padding), %lu/%lu uncached (%lu padding), %lu heap bytes leaked\n",
+           arena->scene, (unsigned long)arena->allocations,
+           (unsigned long)arena->cached.peak, (unsigned long)arena->cached.size, (unsigned long)arena->cached.padding,
+           (unsigned long)arena->uncached.peak, (unsigned long)arena->uncached.size, (unsigned long)arena->uncached.padding,
+           (unsigned long)arena->heap_leaked);
+
+    // The RSP may still read uncached scene data
+    rspq_wait();
+    scene_arena_region_reset(&arena->cached);
+    scene_arena_region_reset(&arena->uncached);
+    arena->scene = NULL;
+}
+
+const SceneArena* scene_arena_get(void) {
+    return &scene_arena;
+}
+
+void scene_arena_cleanup(void) {
+    SceneArena* arena = &scene_arena;
+
+    rspq_wait();
+    free(arena->cached.buffer);
+    arena->cached.buffer = NULL;
+    free_uncached(arena->uncached.buffer);
+    arena->uncached.buffer = NULL;
+}
@@ -0,0 +1,44 @@
+#ifndef SCENE_ARENA_H
+#define SCENE_ARENA_H
+
+#include <libdragon.h>
+
+// Bump allocator for everything that lives as long as a scene: level data,
+// animation graphs, lookup tables. Allocations are never freed one by one;
+// scene_arena_end() drops them all at once when the scene exits, so scene
+// loads don't fragment the heap and nothing can leak into the next scene.
+// Models, sprites and other library-owned resources stay on the heap and
+// keep their cleanup functions; the heap is checked for leftovers instead.
+
+#define SCENE_ARENA_SIZE (192 * 1024)          // Cached bytes per scene
+#define SCENE_ARENA_UNCACHED_SIZE (16 * 1024)  // Uncached bytes per scene, for data the RSP reads
+#define SCENE_ARENA_ALIGN 16
+
+typedef struct {
+    uint8_t* buffer;
+    uint32_t size;
+    uint32_t offset;                 // Bump offset, bytes in use
+    uint32_t peak;                   // Largest offset this scene
+    uint32_t padding;                // Bytes lost to alignment this scene
+} SceneArenaRegion;
+
+typedef struct {
+    SceneArenaRegion cached;
+    SceneArenaRegion uncached;
+    const char* scene;               // Scene being run, NULL between scenes
+    uint32_t allocations;
+    uint32_t heap_start;             // Heap bytes in use when the scene began
+    uint32_t heap_leaked;            // Heap bytes the last scene left behind
+} SceneArena;
+
+// Scene arena functions
+void scene_arena_init(uint32_t cached_size, uint32_t uncached_size);
+void scene_arena_begin(const char* scene);
+void* scene_alloc(uint32_t size);
+void* scene_alloc_uncached(uint32_t size);
+void* scene_alloc_file(const char* path, int* size);
+void scene_arena_end(void);
+const SceneArena* scene_arena_get(void);
+void scene_arena_cleanup(void);
+
+#endif // SCENE_ARENA_H
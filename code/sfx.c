@@ -0,0 +1,191 @@
+#include "sfx.h"
+#include <math.h>
+#include <string.h>
+
+static float sfx_rank(float gain, uint8_t priority) {
+    // Priority first, then loudness
+    return priority + gain * 0.99f;
+}
+
+static void sfx_voice_stop(SfxEngine* sfx, int voice) {
+    SfxVoice* v = &sfx->voices[voice];
+    if (v->sample < 0) return;
+    mixer_ch_stop(SOUND_CHANNEL_SFX_FIRST + voice);
+    if (v->emitter >= 0) sfx->emitters[v->emitter].voice = -1;
+    v->sample = -1;
+    v->emitter = -1;
+}
+
+static void sfx_voice_mix(SfxEngine* sfx, int voice) {
+    SfxVoice* v = &sfx->voices[voice];
+    T3DVec3 dir;
+    t3d_vec3_diff(&dir, &v->position, &sfx->listener);
+    float dist = t3d_vec3_len(&dir);
+    float side = dist > 0.001f ? t3d_vec3_dot(&dir, &sfx->listener_right) / dist : 0.0f;
+    mixer_ch_set_vol_pan(SOUND_CHANNEL_SFX_FIRST + voice, v->gain, 0.5f + 0.5f * SFX_PAN_WIDTH * side);
+}
+
+void sfx_init(SfxEngine* sfx) {
+    memset(sfx, 0, sizeof(SfxEngine));
+    for (int i = 0; i < SFX_VOICES; i++) {
+        sfx->voices[i].sample = -1;
+        sfx->voices[i].emitter = -1;
+    }
+    sfx->listener_right = (T3DVec3){{1.0f, 0.0f, 0.0f}};
+}
+
+// Loads rom:/<name>.wav64 once; later loads of the same name share it
+int sfx_sample_load(SfxEngine* sfx, const char* name, bool loop) {
+    for (int i = 0; i < sfx->sample_count; i++) {
+        if (strncmp(sfx->samples[i].name, name, SFX_NAME_LEN) == 0) return i;
+    }
+    assertf(sfx->sample_count < SFX_SAMPLES_MAX, "Too many sound effect samples");
+
+    SfxSample* sample = &sfx->samples[sfx->sample_count];
+    char path[SOUND_PATH_LEN];
+    snprintf(path, sizeof(path), "rom:/%s.wav64", name);
+    wav64_open(&sample->wave, path);
+    wav64_set_loop(&sample->wave, loop);
+    strncpy(sample->name, name, SFX_NAME_LEN - 1);
+    sample->name[SFX_NAME_LEN - 1] = '\0';
+    sample->loop = loop;
+    return sfx->sample_count++;
+}
+
+// Audibility at the listener: full volume up close, falling off
+// quadratically to nothing at the edge of the sound's reach
+float sfx_gain(const SfxEngine* sfx, const T3DVec3* position, float volume, float radius, SfxPriority priority) {
+    float dist = t3d_vec3_distance(position, &sfx->listener);
+    float full = radius * SFX_FULL_VOLUME_RADIUS;
+    float falloff = 1.0f;
+    if (dist >= radius) {
+        falloff = 0.0f;
+    } else if (dist > full) {
+        float t = 1.0f - (dist - full) / (radius - full);
+        falloff = t * t;
+    }
+    float gain = volume * falloff;
+    if (priority >= SFX_PRIORITY_CRITICAL && gain < SFX_MIN_AUDIBLE) gain = SFX_MIN_AUDIBLE;
+    return gain;
+}
+
+// Finds a channel for a sound: a free one, or the lowest ranked if the
+// sound outranks it. Returns the voice, or -1 when the sound is culled.
+static int sfx_voice_start(SfxEngine* sfx, int sample, int emitter, const T3DVec3* position,
+                           float volume, float radius, SfxPriority priority) {
+    float gain = sfx_gain(sfx, position, volume, radius, priority);
+    if (gain < SFX_MIN_AUDIBLE) {
+        sfx->culled++;
+        return -1;
+    }
+
+    int voice = -1;
+    float weakest = sfx_rank(gain, priority);
+    for (int i = 0; i < SFX_VOICES; i++) {
+        SfxVoice* v = &sfx->voices[i];
+        if (v->sample < 0) {
+            voice = i;
+            break;
+        }
+        float rank = sfx_rank(v->gain, v->priority);
+        if (rank < weakest) {
+            weakest = rank;
+            voice = i;
+        }
+    }
+    if (voice < 0) {
+        sfx->culled++;
+        return -1;
+    }
+    if (sfx->voices[voice].sample >= 0) {
+        sfx_voice_stop(sfx, voice);
+        sfx->stolen++;
+    }
+
+    SfxVoice* v = &sfx->voices[voice];
+    v->sample = sample;
+    v->emitter = emitter;
+    v->position = *position;
+    v->volume = volume;
+    v->radius = radius;
+    v->priority = priority;
+    v->gain = gain;
+    if (emitter >= 0) sfx->emitters[emitter].voice = voice;
+
+    wav64_play(&sfx->samples[sample].wave, SOUND_CHANNEL_SFX_FIRST + voice);
+    sfx_voice_mix(sfx, voice);
+    sfx->started++;
+    return voice;
+}
+
+int sfx_play(SfxEngine* sfx, int sample, const T3DVec3* position, float volume, SfxPriority priority) {
+    if (sample < 0) return -1;
+    return sfx_voice_start(sfx, sample, -1, position, volume, SFX_RADIUS, priority);
+}
+
+// Emitters are looping sounds placed in the level. They play only while
+// they are within reach and win a channel.
+int sfx_emitter_add(SfxEngine* sfx, int sample, const T3DVec3* position, float volume, float radius, SfxPriority priority) {
+    assertf(sfx->emitter_count < SFX_EMITTERS_MAX, "Too many sound emitters");
+    SfxEmitter* e = &sfx->emitters[sfx->emitter_count];
+    e->position = *position;
+    e->sample = sample;
+    e->volume = volume;
+    e->radius = radius;
+    e->priority = priority;
+    e->active = sample >= 0;
+    e->voice = -1;
+    return sfx->emitter_count++;
+}
+
+void sfx_emitter_remove(SfxEngine* sfx, int emitter) {
+    SfxEmitter* e = &sfx->emitters[emitter];
+    if (e->voice >= 0) sfx_voice_stop(sfx, e->voice);
+    e->active = false;
+}
+
+void sfx_begin_frame(SfxEngine* sfx, const T3DVec3* listener, const T3DVec3* target) {
+    sfx->started = 0;
+    sfx->culled = 0;
+    sfx->stolen = 0;
+
+    // Pan along the camera's horizontal right axis
+    sfx->listener = *listener;
+    float fx = target->x - listener->x;
+    float fz = target->z - listener->z;
+    float len = sqrtf(fx * fx + fz * fz);
+    if (len > 0.001f) {
+        sfx->listener_right = (T3DVec3){{-fz / len, 0.0f, fx / len}};
+    }
+
+    // Playing sounds: drop the finished and those now out of reach
+    for (int i = 0; i < SFX_VOICES; i++) {
+        SfxVoice* v = &sfx->voices[i];
+        if (v->sample < 0) continue;
+        if (!mixer_ch_playing(SOUND_CHANNEL_SFX_FIRST + i)) {
+            sfx_voice_stop(sfx, i);
+            continue;
+        }
+        v->gain = sfx_gain(sfx, &v->position, v->volume, v->radius, v->priority);
+        if (v->gain < SFX_MIN_AUDIBLE) {
+            sfx_voice_stop(sfx, i);
+            continue;
+        }
+        sfx_voice_mix(sfx, i);
+    }
+
+    // Emitters coming into reach compete for the channels
+    for (int i = 0; i < sfx->emitter_count; i++) {
+        SfxEmitter* e = &sfx->emitters[i];
+        if (!e->active || e->voice >= 0) continue;
+        if (sfx_gain(sfx, &e->position, e->volume, e->radius, e->priority) < SFX_MIN_AUDIBLE) continue;
+        sfx_voice_start(sfx, e->sample, i, &e->position, e->volume, e->radius, e->priority);
+    }
+}
+
+void sfx_cleanup(SfxEngine* sfx) {
+    for (int i = 0; i < SFX_VOICES; i++) sfx_voice_stop(sfx, i);
+    for (int i = 0; i < sfx->sample_count; i++) wav64_close(&sfx->samples[i].wave);
+    sfx->sample_count = 0;
+    sfx->emitter_count = 0;
+}
@@ -0,0 +1,86 @@
+#ifndef SFX_H
+#define SFX_H
+
+#include <libdragon.h>
+#include <t3d/t3dmath.h>
+#include "sound.h"
+
+// Positional sound effects on the mixer's SFX channels. Samples are loaded
+// once and shared by every sound playing them. Each sound is attenuated by
+// its distance to the listener and panned by its side of the camera; a
+// sound only gets a channel if it is audible and outranks what is playing,
+// so however many emitters the level has, at most SFX_VOICES are mixed.
+
+#define SFX_VOICES SOUND_SFX_CHANNELS
+#define SFX_SAMPLES_MAX 16
+#define SFX_EMITTERS_MAX 64
+#define SFX_NAME_LEN 16
+#define SFX_RADIUS 1200.0f           // Default reach, world units
+#define SFX_FULL_VOLUME_RADIUS 0.1f  // Fraction of the reach heard at full volume
+#define SFX_MIN_AUDIBLE 0.02f        // Quieter sounds are culled
+#define SFX_PAN_WIDTH 0.8f           // 0 mono, 1 hard left and right
+
+typedef enum {
+    SFX_PRIORITY_AMBIENT = 0,        // Loops placed in the level
+    SFX_PRIORITY_FOOTSTEP,
+    SFX_PRIORITY_ACTION,             // Jumps, landings, hits
+    SFX_PRIORITY_CRITICAL            // Never culled for distance
+} SfxPriority;
+
+typedef struct {
+    wav64_t wave;
+    char name[SFX_NAME_LEN];
+    bool loop;
+} SfxSample;
+
+typedef struct {
+    T3DVec3 position;
+    int sample;
+    float volume;
+    float radius;
+    uint8_t priority;
+    bool active;
+    int8_t voice;                    // Playing on, -1 when not
+} SfxEmitter;
+
+typedef struct {
+    int sample;                      // -1 when the channel is free
+    int emitter;                     // Owning emitter, -1 for one-shots
+    T3DVec3 position;
+    float volume;
+    float radius;
+    uint8_t priority;
+    float gain;                      // Audibility at the listener, last update
+} SfxVoice;
+
+typedef struct {
+    SfxSample samples[SFX_SAMPLES_MAX];
+    int sample_count;
+    SfxEmitter emitters[SFX_EMITTERS_MAX];
+    int emitter_count;
+    SfxVoice voices[SFX_VOICES];
+
+    // Listener: the camera
+    T3DVec3 listener;
+    T3DVec3 listener_right;
+
+    // Per frame
+    uint32_t started;                // Sounds given a channel
+    uint32_t culled;                 // Inaudible or outranked, never mixed
+    uint32_t stolen;                 // Voices cut for a higher ranked sound
+} SfxEngine;
+
+// Sound effect functions
+void sfx_init(SfxEngine* sfx);
+int sfx_sample_load(SfxEngine* sfx, const char* name, bool loop);
+int sfx_play(SfxEngine* sfx, int sample, const T3DVec3* position, float volume, SfxPriority priority);
+int sfx_emitter_add(SfxEngine* sfx, int sample, const T3DVec3* position, float volume, float radius, SfxPriority priority);
+void sfx_emitter_remove(SfxEngine* sfx, int emitter);
+float sfx_gain(const SfxEngine* sfx, const T3DVec3* position, float volume, float radius, SfxPriority priority);
+
+// Once per frame: moves the listener, drops finished sounds, gives free
+// channels to emitters in reach and updates volume and pan
+void sfx_begin_frame(SfxEngine* sfx, const T3DVec3* listener, const T3DVec3* target);
+void sfx_cleanup(SfxEngine* sfx);
+
+#endif // SFX_H
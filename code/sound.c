@@ -0,0 +1,159 @@
+#include "sound.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+static MusicTrack music;
+static SoundStats stats;
+static bool pumping;
+
+static uint32_t sound_file_size(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) return 0;
+    fseek(f, 0, SEEK_END);
+    uint32_t size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+void sound_init(void) {
+    audio_init(SOUND_FREQUENCY, SOUND_BUFFERS);
+    mixer_init(SOUND_MIXER_CHANNELS);
+#if MUSIC_COMPRESS == 3
+    wav64_init_compression(3);
+#endif
+
+    // Bounds the music channel's sample buffer: it is refilled from ROM as
+    // it drains instead of growing to fit whole tracks
+    mixer_ch_set_limits(SOUND_CHANNEL_MUSIC, 16, SOUND_MUSIC_MAX_FREQUENCY, SOUND_MUSIC_BUFFER_BYTES);
+    memset(&music, 0, sizeof(music));
+    memset(&stats, 0, sizeof(stats));
+}
+
+// Mixes into every free output buffer. Cheap when nothing is free, so it
+// can be called wherever a frame may spend a while. Decoding happens in
+// here too, pulled by the mixer, so its time is the music's cost.
+void sound_pump(void) {
+    if (pumping) return;
+    pumping = true;
+    stats.pumps++;
+
+    uint32_t free_buffers = 0;
+    uint32_t start = TICKS_READ();
+    while (audio_can_write()) {
+        uint32_t buffer_start = TICKS_READ();
+        short* buf = audio_write_begin();
+        mixer_poll(buf, audio_get_buffer_length());
+        audio_write_end();
+
+        uint32_t us = TICKS_TO_US(TICKS_DISTANCE(buffer_start, TICKS_READ()));
+        if (us > stats.mix_max_us) stats.mix_max_us = us;
+        free_buffers++;
+    }
+    mixer_try_play();
+
+    uint32_t us = TICKS_TO_US(TICKS_DISTANCE(start, TICKS_READ()));
+    stats.fills += free_buffers;
+    stats.mix_us += us;
+    if (free_buffers > stats.most_free) stats.most_free = free_buffers;
+    // Every buffer free means the one playing ran out before this call
+    if (free_buffers == SOUND_BUFFERS) {
+        stats.underruns++;
+        //debugf("Sound: underrun after %lu pumps\n", (unsigned long)stats.pumps);
+    }
+
+    if (music.open && free_buffers > 0) {
+        music.decode_us += us;
+        if (us > music.decode_max_us) music.decode_max_us = us;
+    }
+    pumping = false;
+}
+
+// Once per frame: pumps and tracks the music
+void sound_update(void) {
+    sound_pump();
+    if (!music.open) return;
+    if (!mixer_ch_playing(SOUND_CHANNEL_MUSIC)) {
+        // A track without loop ran out
+        sound_music_stop();
+        return;
+    }
+    music.frames++;
+}
+
+const SoundStats* sound_stats(void) {
+    return &stats;
+}
+
+// Stress mode: stalls the frame, then logs how the mixer kept up
+void sound_stress_frame_end(void) {
+    if (!SOUND_STRESS) return;
+
+    static uint32_t frame;
+    static uint32_t report_start;
+    static SoundStats report_base;
+    if (frame == 0) {
+        report_start = TICKS_READ();
+        report_base = stats;
+    }
+    wait_ms((frame++ % 4) * SOUND_STRESS_STEP_MS);
+
+    if (TICKS_DISTANCE(report_start, TICKS_READ()) >= TICKS_FROM_MS(SOUND_STRESS_SECONDS * 1000)) {
+        uint32_t fills = stats.fills - report_base.fills;
+        debugf("SOUND %lu buffers, %lu underruns, most free %lu/%d, mix avg %lu max %lu us per buffer\n",
+               (unsigned long)fills, (unsigned long)(stats.underruns - report_base.underruns),
+               (unsigned long)stats.most_free, SOUND_BUFFERS,
+               (unsigned long)(fills ? (stats.mix_us - report_base.mix_us) / fills : 0),
+               (unsigned long)stats.mix_max_us);
+        report_start = TICKS_READ();
+        report_base = stats;
+        stats.most_free = 0;
+        stats.mix_max_us = 0;
+    }
+}
+
+static void sound_music_report(void) {
+    uint32_t avg = music.frames ? (uint32_t)(music.decode_us / music.frames) : 0;
+    debugf("Music %s: %lu bytes ROM, %lu kbit/s, %lu bytes resident, decode avg %lu max %lu us over %lu frames\n",
+           music.path, (unsigned long)music.rom_bytes, (unsigned long)(music.bitrate / 1000),
+           (unsigned long)music.resident_bytes, (unsigned long)avg, (unsigned long)music.decode_max_us,
+           (unsigned long)music.frames);
+}
+
+void sound_music_play(const char* path, bool loop) {
+    if (music.open) sound_music_stop();
+
+    // Opening reads the header only; samples stream in as the mixer needs them
+    uint32_t heap_before = mallinfo().uordblks;
+    wav64_open(&music.wave, path);
+    uint32_t heap_after = mallinfo().uordblks;
+
+    strncpy(music.path, path, SOUND_PATH_LEN - 1);
+    music.path[SOUND_PATH_LEN - 1] = '\0';
+    music.open = true;
+    music.rom_bytes = sound_file_size(path);
+    music.resident_bytes = (heap_after > heap_before ? heap_after - heap_before : 0) + SOUND_MUSIC_BUFFER_BYTES;
+    music.bitrate = wav64_get_bitrate(&music.wave);
+    music.frames = 0;
+    music.decode_us = 0;
+    music.decode_max_us = 0;
+
+    wav64_set_loop(&music.wave, loop);
+    wav64_play(&music.wave, SOUND_CHANNEL_MUSIC);
+}
+
+void sound_music_stop(void) {
+    if (!music.open) return;
+    sound_music_report();
+    mixer_ch_stop(SOUND_CHANNEL_MUSIC);
+    wav64_close(&music.wave);
+    music.open = false;
+}
+
+bool sound_music_playing(void) {
+    return music.open && mixer_ch_playing(SOUND_CHANNEL_MUSIC);
+}
+
+const MusicTrack* sound_music_track(void) {
+    return &music;
+}
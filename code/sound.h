@@ -0,0 +1,80 @@
+#ifndef SOUND_H
+#define SOUND_H
+
+#include <libdragon.h>
+
+// Mixer setup and music streaming. Music stays compressed in ROM
+// (MUSIC_COMPRESS in the makefile) and is decoded while it plays: the
+// mixer pulls each track from the cartridge a little ahead of playback
+// into a small per-channel ring buffer, so a track costs its compressed
+// ROM size and a few KB of RAM instead of a fully converted wave.
+//
+// Mixing isn't tied to rendered frames: sound_pump() fills every free
+// output buffer and is called at several points of a frame, so playback
+// has SOUND_BUFFERS buffers of lead over whatever the frame is doing.
+// It isn't run from the AI interrupt because streamed tracks read the
+// cartridge, which would race with the main thread's DFS loads.
+
+#define SOUND_FREQUENCY 48000
+#ifndef SOUND_BUFFERS
+#define SOUND_BUFFERS 6                   // Output buffers, ~40ms each: the lead over a slow frame
+#endif
+
+#define SOUND_CHANNEL_MUSIC 0
+#define SOUND_CHANNEL_SFX_FIRST 1
+#define SOUND_SFX_CHANNELS 3
+#define SOUND_MIXER_CHANNELS (SOUND_CHANNEL_SFX_FIRST + SOUND_SFX_CHANNELS)
+
+#define SOUND_MUSIC_MAX_FREQUENCY 32000   // Tracks are resampled to this (MUSIC_RATE)
+#define SOUND_MUSIC_BUFFER_BYTES (16 * 1024)  // Decoded samples kept ahead, ~128ms stereo
+#define SOUND_PATH_LEN 48
+
+// 1 VADPCM, 3 Opus; must match the makefile's MUSIC_COMPRESS
+#ifndef MUSIC_COMPRESS
+#define MUSIC_COMPRESS 1
+#endif
+
+// Slow-frame stress mode, selectable at build time (SOUND_STRESS in the
+// makefile). Frames stall for 0 to 3 steps in turn and the mixer
+// statistics are logged every SOUND_STRESS_SECONDS.
+#ifndef SOUND_STRESS
+#define SOUND_STRESS 0
+#endif
+#define SOUND_STRESS_STEP_MS 33
+#define SOUND_STRESS_SECONDS 5
+
+typedef struct {
+    uint32_t pumps;               // sound_pump calls
+    uint32_t fills;               // Output buffers mixed
+    uint32_t underruns;           // Pumps that found every buffer drained
+    uint64_t mix_us;              // Time in the mixer
+    uint32_t mix_max_us;          // Longest single buffer
+    uint32_t most_free;           // Most buffers found free at once
+} SoundStats;
+
+typedef struct {
+    wav64_t wave;
+    char path[SOUND_PATH_LEN];
+    bool open;
+
+    // Per-track report, printed when the track stops
+    uint32_t rom_bytes;           // Compressed size in ROM
+    uint32_t resident_bytes;      // Heap taken by opening the track, plus the ring buffer
+    uint32_t bitrate;             // Bits per second of ROM read while playing
+    uint32_t frames;              // Mixer updates while playing
+    uint64_t decode_us;           // Time in the mixer over those updates
+    uint32_t decode_max_us;
+} MusicTrack;
+
+// Sound functions
+void sound_init(void);
+void sound_pump(void);
+void sound_update(void);
+const SoundStats* sound_stats(void);
+void sound_stress_frame_end(void);
+void sound_music_play(const char* path, bool loop);
+void sound_music_stop(void);
+bool sound_music_playing(void);
+const MusicTrack* sound_music_track(void);
+
+#endif // SOUND_H
@@ -1,5 +1,8 @@
 #include <libdragon.h>
 #include "startup.h"
+#include "sound.h"
+#include <stdio.h>
+#include <string.h>
 
 #define SCREEN_TIME_TICKS (2 * TICKS_PER_SECOND)
 
@@ -18,6 +21,16 @@ struct main_menu menu = {
 
 // Audio playback flags to prevent repeated playback
 static bool gamestart_played = false;
+static bool gamestart_present = false;
+
+// Screen images, in the order the screens show
+static StartupImage startup_images[STARTUP_IMAGE_COUNT] = {
+    {.path = "rom:/libdragon.sprite"},
+    {.path = "rom:/tiny3d.sprite"},
+    {.path = "rom:/startscreen.sprite"},
+};
+static startup_state_t startup_current = STARTUP_LIBDRAGON_LOGO;
+static StartupTiming startup_timing;
 
 // Font variables
 rdpq_font_t *menu_font = NULL;
@@ -42,83 +55,213 @@ void startup_init_fonts() {
     }
 }
 
-bool handle_startup_sequence(surface_t* disp, joypad_buttons_t button, startup_state_t* state, u_uint32_t* last_time) {
+static bool startup_file_present(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) return false;
+    fclose(f);
+    return true;
+}
+
+// Image shown by a screen, -1 for none
+static int startup_image_index(startup_state_t state) {
+    switch (state) {
+        case STARTUP_LIBDRAGON_LOGO: return 0;
+        case STARTUP_TINY3D_LOGO: return 1;
+        case STARTUP_TITLE_SCREEN:
+        case STARTUP_MAIN_MENU: return 2;
+        default: return -1;
+    }
+}
+
+// Runs once the RDP has finished every blit queued before the release
+static void startup_image_rdp_done(void* arg) {
+    ((StartupImage*)arg)->rdp_done = true;
+}
+
+static void startup_image_release(StartupImage* image) {
+    if (image->file) {
+        // Never drawn, nothing to wait for
+        fclose(image->file);
+        image->file = NULL;
+        free(image->buffer);
+        image->buffer = NULL;
+        image->loaded = 0;
+        return;
+    }
+    if (image->buffer == NULL || image->releasing) return;
+    image->rdp_done = false;
+    image->releasing = true;
+    rdpq_call_deferred(startup_image_rdp_done, image);
+}
+
+// Reads the next chunk of an image, returns true once it is complete
+static bool startup_image_step(StartupImage* image) {
+    if (image->buffer == NULL) {
+        image->file = asset_fopen(image->path, &image->size);
+        image->buffer = malloc(image->size);
+        image->loaded = 0;
+    }
+    int chunk = image->size - image->loaded;
+    if (chunk > STARTUP_READ_CHUNK) chunk = STARTUP_READ_CHUNK;
+    int read = fread(image->buffer + image->loaded, 1, chunk, image->file);
+    assertf(read == chunk, "Short read on %s", image->path);
+    image->loaded += read;
+    if (image->loaded < image->size) return false;
+
+    fclose(image->file);
+    image->file = NULL;
+    image->sprite = sprite_load_buf(image->buffer, image->size);
+    return true;
+}
+
+static void startup_set_state(startup_state_t* state, startup_state_t next) {
+    // Images no later screen shows go once the RDP is done with them
+    int keep = startup_image_index(next);
+    for (int i = 0; i < STARTUP_IMAGE_COUNT; i++) {
+        if (keep < 0 || i < keep) startup_image_release(&startup_images[i]);
+    }
+    *state = next;
+    startup_current = next;
+}
+
+void startup_begin(void) {
+    for (int i = 0; i < STARTUP_IMAGE_COUNT; i++) {
+        StartupImage* image = &startup_images[i];
+        image->present = startup_file_present(image->path);
+        if (!image->present) debugf("Startup: %s missing, screen skipped\n", image->path);
+    }
+    gamestart_present = startup_file_present("rom:/gamestart.wav64");
+    startup_current = STARTUP_LIBDRAGON_LOGO;
+}
+
+// Streams the images of the current and next screens, and frees the ones
+// released once the RDP is past them. Call every frame, also after the
+// startup screens are gone, until everything is freed.
+void startup_stream(uint32_t budget_us) {
+    for (int i = 0; i < STARTUP_IMAGE_COUNT; i++) {
+        StartupImage* image = &startup_images[i];
+        if (image->releasing && image->rdp_done) {
+            free(image->buffer);
+            image->buffer = NULL;
+            image->sprite = NULL;
+            image->loaded = 0;
+            image->releasing = false;
+        }
+    }
+
+    int first = startup_image_index(startup_current);
+    if (first < 0) return;
+    uint32_t start = TICKS_READ();
+    for (int i = first; i < STARTUP_IMAGE_COUNT && i <= first + 1; i++) {
+        StartupImage* image = &startup_images[i];
+        if (!image->present || image->sprite) continue;
+        while (!startup_image_step(image)) {
+            if (TICKS_TO_US(TICKS_DISTANCE(start, TICKS_READ())) >= budget_us) return;
+        }
+    }
+}
+
+// Clears the screen and blits the image, if it has finished streaming
+static void startup_draw_image(surface_t* disp, startup_state_t state) {
+    rdpq_attach_clear(disp, NULL);
+    int index = startup_image_index(state);
+    if (index >= 0 && startup_images[index].sprite) {
+        rdpq_set_mode_copy(true);
+        rdpq_sprite_blit(startup_images[index].sprite, 0, 0, NULL);
+    }
+}
+
+static void startup_draw_copyright(void) {
+    rdpq_textparms_t copyright_params = {
+        .align = ALIGN_CENTER,
+        .width = 640,
+        .height = 480,
+    };
+    // Draw copyright at bottom edge of screen using smaller version of the same font
+    rdpq_text_print(&copyright_params, FONT_COPYRIGHT, 0, 460, "2020 2025 NERIX LTD.,ALL RIGHTS RESERVED");
+}
+
+// ready: the scene has finished loading, so starting won't stall
+bool handle_startup_sequence(surface_t* disp, joypad_buttons_t button, startup_state_t* state, u_uint32_t* last_time, bool ready) {
     uint32_t current_time = timer_ticks();
     
+    // Screens whose image isn't in the ROM
+    while (*state < STARTUP_MAIN_MENU && !startup_images[startup_image_index(*state)].present) {
+        startup_set_state(state, *state + 1);
+    }
+    
+    // A screen's time only runs once its image is up
+    int index = startup_image_index(*state);
+    if (index >= 0 && startup_images[index].present && !startup_images[index].sprite) {
+        *last_time = current_time;
+    }
+    
     // Auto-advance timer
-    if (current_time - *last_time > SCREEN_TIME_TICKS) {
+    if (current_time - *last_time > SCREEN_TIME_TICKS && *state < STARTUP_MAIN_MENU) {
         *last_time = current_time;
-        (*state)++;
-        if (*state > STARTUP_MAIN_MENU) {
-            *state = STARTUP_MAIN_MENU;
-        }
+        startup_set_state(state, *state + 1);
     }
     
     switch (*state) {
         case STARTUP_LIBDRAGON_LOGO:
-            if (!gamestart_played) {
-                wav64_play(&gamestart, 0);
+            if (!gamestart_played && gamestart_present) {
+                sound_music_play("rom:/gamestart.wav64", false);
                 gamestart_played = true;
             }
-            graphics_draw_sprite_trans(disp, 0, 0, libdr_title);
+            startup_draw_image(disp, *state);
+            rdpq_detach_show();
             if (button.a || button.start) {
-                sprite_free(libdr_title);
-                rdpq_sync_pipe();
-                rdpq_sync_load();
-                *state = STARTUP_TINY3D_LOGO;
+                startup_set_state(state, STARTUP_TINY3D_LOGO);
                 *last_time = timer_ticks();
             }
             break;
             
         case STARTUP_TINY3D_LOGO:
-            graphics_draw_sprite_trans(disp, 0, 0, tiny3D_title);
+            startup_draw_image(disp, *state);
+            rdpq_detach_show();
             if (button.a || button.start) {
-                sprite_free(tiny3D_title);
-                rdpq_sync_pipe();
-                rdpq_sync_load();
-                *state = STARTUP_TITLE_SCREEN;
+                startup_set_state(state, STARTUP_TITLE_SCREEN);
                 *last_time = timer_ticks();
             }
             break;
             
         case STARTUP_TITLE_SCREEN:
-            //wav64_play(&titlesong, 1);
-            graphics_draw_sprite_trans(disp, 0, 0, startscreen);
-            
-            // Add copyright text overlay on the startscreen
-            rdpq_attach(disp, NULL);
-            rdpq_textparms_t copyright_params = {
-                .align = ALIGN_CENTER,
-                .width = 640,
-                .height = 480,
-            };
-            // Draw copyright at bottom edge of screen using smaller version of the same font
-            rdpq_text_print(&copyright_params, FONT_COPYRIGHT, 0, 460, "2020 2025 NERIX LTD.,ALL RIGHTS RESERVED");
-            rdpq_detach();
+            //sound_music_play("rom:/pianoanime.wav64", true);
+            // Copyright text overlay on the startscreen
+            startup_draw_image(disp, *state);
+            startup_draw_copyright();
+            rdpq_detach_show();
             
             if (button.a || button.start) {
-                *state = STARTUP_MAIN_MENU;
+                startup_set_state(state, STARTUP_MAIN_MENU);
                 *last_time = timer_ticks();
             }
             break;
             
         case STARTUP_MAIN_MENU:
-            return handle_main_menu(disp, button);
+            if (handle_main_menu(disp, button, ready)) {
+                startup_set_state(state, STARTUP_COMPLETE);
+                return true;
+            }
+            break;
             
         default:
+            // Nothing left to draw, still hand the frame back
+            startup_draw_image(disp, *state);
+            rdpq_detach_show();
             break;
     }
     
     return false; // Still in startup sequence
 }
 
-bool handle_main_menu(surface_t* disp, joypad_buttons_t button) {
+bool handle_main_menu(surface_t* disp, joypad_buttons_t button, bool ready) {
     // Calculate screen dimensions (assuming 640x480 resolution)
     int screen_width = 640;
     int screen_height = 480;
     
-    // Use RDPQ text system for better rendering
-    rdpq_attach(disp, NULL);
+    // Title image behind the menu, text through the RDPQ text system
+    startup_draw_image(disp, STARTUP_MAIN_MENU);
     
     // Set text parameters for main menu text (moved lower on screen)
     rdpq_textparms_t text_params = {
@@ -130,23 +273,57 @@ bool handle_main_menu(surface_t* disp, joypad_buttons_t button) {
     // If we have a custom font, use it, otherwise use default font
     int font_id = (menu_font != NULL) ? FONT_MENU : FONT_BUILTIN_DEBUG_MONO;
     
-    // Draw the main menu text (positioned lower on screen)
-    rdpq_text_print(&text_params, font_id, 0, 320, menu.items[0]);
+    // Draw the main menu text (positioned lower on screen), until the
+    // scene is loaded a loading note instead
+    rdpq_text_print(&text_params, font_id, 0, 320, ready ? menu.items[0] : "LOADING");
     
     // Draw the subtext at bottom edge of screen
-    rdpq_textparms_t subtext_params = {
-        .align = ALIGN_CENTER,
-        .width = screen_width,
-        .height = screen_height,
-    };
-    rdpq_text_print(&subtext_params, FONT_COPYRIGHT, 0, 460, "2020 2025 NERIX LTD.,ALL RIGHTS RESERVED");
+    startup_draw_copyright();
     
-    rdpq_detach();
+    rdpq_detach_show();
 
     // Handle menu navigation - for single item menu, any button starts the game
-    if (button.a || button.start) {
+    if (ready && (button.a || button.start)) {
+        startup_timing_start_pressed();
         return true;
     }
     
     return false;
 }
+
+static uint32_t startup_timing_now_us(void) {
+    return TICKS_TO_US(TICKS_DISTANCE(startup_timing.main_ticks, TICKS_READ()));
+}
+
+// First thing in main(): the CPU counter runs from reset, so its value
+// here is the time spent before the game's code (IPL3, crt0)
+void startup_timing_begin(void) {
+    memset(&startup_timing, 0, sizeof(startup_timing));
+    startup_timing.main_ticks = TICKS_READ();
+}
+
+void startup_timing_frame_shown(void) {
+    if (startup_timing.first_frame_us == 0) startup_timing.first_frame_us = startup_timing_now_us();
+}
+
+void startup_timing_scene_ready(uint32_t load_us, uint32_t load_max_step_us) {
+    startup_timing.scene_ready_us = startup_timing_now_us();
+    startup_timing.load_us = load_us;
+    startup_timing.load_max_step_us = load_max_step_us;
+}
+
+void startup_timing_start_pressed(void) {
+    startup_timing.start_pressed_us = startup_timing_now_us();
+}
+
+// First gameplay frame shown: reports the whole boot once
+void startup_timing_interactive(void) {
+    if (startup_timing.interactive_us != 0) return;
+    startup_timing.interactive_us = startup_timing_now_us();
+    uint32_t stall = startup_timing.start_pressed_us ? startup_timing.interactive_us - startup_timing.start_pressed_us : 0;
+    debugf("Boot: %lu us before main, first frame %lu us, scene ready %lu us (%lu us loading, longest step %lu us), interactive %lu us, %lu us after start\n",
+           (unsigned long)TICKS_TO_US(startup_timing.main_ticks), (unsigned long)startup_timing.first_frame_us,
+           (unsigned long)startup_timing.scene_ready_us, (unsigned long)startup_timing.load_us,
+           (unsigned long)startup_timing.load_max_step_us, (unsigned long)startup_timing.interactive_us,
+           (unsigned long)stall);
+}
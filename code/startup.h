@@ -3,6 +3,16 @@
 
 #include <libdragon.h>
 
+// Logo and title screens, selectable at build time (STARTUP_SCREENS in the
+// makefile); 0 boots straight into the scene
+#ifndef STARTUP_SCREENS
+#define STARTUP_SCREENS 1
+#endif
+
+#define STARTUP_IMAGE_COUNT 3
+#define STARTUP_READ_CHUNK (16 * 1024)       // Bytes read per step while streaming an image
+#define STARTUP_STREAM_BUDGET_US 4000        // Image streaming per frame
+
 typedef enum {
     STARTUP_LIBDRAGON_LOGO = 0,
     STARTUP_TINY3D_LOGO = 1,
@@ -11,11 +21,30 @@ typedef enum {
     STARTUP_COMPLETE = 4
 } startup_state_t;
 
-extern sprite_t *libdr_title;
-extern sprite_t *tiny3D_title;
-extern sprite_t *startscreen;
-extern wav64_t gamestart;
-extern wav64_t titlesong;
+// A full-screen image, read from ROM a chunk at a time while the screen
+// before it shows, and freed once the RDP is done drawing it
+typedef struct {
+    const char* path;
+    bool present;                // Screens without their image are skipped
+    FILE* file;
+    uint8_t* buffer;             // Whole file, the sprite is used in place
+    int size;
+    int loaded;                  // Bytes read so far
+    sprite_t* sprite;            // Set once fully read
+    bool releasing;
+    volatile bool rdp_done;      // Set once the RDP has finished the blits before the release
+} StartupImage;
+
+// Boot-to-interactive milestones, microseconds since main() began
+typedef struct {
+    uint32_t main_ticks;
+    uint32_t first_frame_us;
+    uint32_t scene_ready_us;
+    uint32_t load_us;            // CPU time spent loading the scene
+    uint32_t load_max_step_us;   // Longest single load call
+    uint32_t start_pressed_us;
+    uint32_t interactive_us;     // First gameplay frame shown
+} StartupTiming;
 
 struct main_menu {
     int pos;
@@ -27,7 +56,16 @@ extern struct main_menu menu;
 
 // Function declarations
 void startup_init_fonts(void);
-bool handle_startup_sequence(surface_t* disp, joypad_buttons_t button, startup_state_t* state, u_uint32_t* last_time);
-bool handle_main_menu(surface_t* disp, joypad_buttons_t button);
+void startup_begin(void);
+void startup_stream(uint32_t budget_us);
+bool handle_startup_sequence(surface_t* disp, joypad_buttons_t button, startup_state_t* state, u_uint32_t* last_time, bool ready);
+bool handle_main_menu(surface_t* disp, joypad_buttons_t button, bool ready);
+
+// Boot timing
+void startup_timing_begin(void);
+void startup_timing_frame_shown(void);
+void startup_timing_scene_ready(uint32_t load_us, uint32_t load_max_step_us);
+void startup_timing_start_pressed(void);
+void startup_timing_interactive(void);
 
 #endif
@@ -0,0 +1,33 @@
+#include "timestep.h"
+
+void timestep_init(FixedTimestep* ts) {
+    ts->last_ticks = get_ticks();
+    ts->accumulator = 0;
+    ts->tick_length = TICKS_PER_SECOND / SIM_TICK_HZ;
+    ts->tick_count = 0;
+    ts->dropped_ticks = 0;
+}
+
+int timestep_begin_frame(FixedTimestep* ts) {
+    // Accumulate in integer timer ticks so the tick schedule never drifts
+    uint64_t now = get_ticks();
+    ts->accumulator += now - ts->last_ticks;
+    ts->last_ticks = now;
+
+    int ticks = ts->accumulator / ts->tick_length;
+    if (ticks > SIM_MAX_TICKS_PER_FRAME) {
+        ts->dropped_ticks += ticks - SIM_MAX_TICKS_PER_FRAME;
+        ticks = SIM_MAX_TICKS_PER_FRAME;
+        // Keep only the fractional part of a tick so interpolation stays valid
+        ts->accumulator = ts->accumulator % ts->tick_length + ticks * ts->tick_length;
+    }
+
+    ts->accumulator -= ticks * ts->tick_length;
+    ts->tick_count += ticks;
+    return ticks;
+}
+
+float timestep_alpha(const FixedTimestep* ts) {
+    // Fraction of the next tick already elapsed, used to blend prev -> current state
+    return (float)ts->accumulator / (float)ts->tick_length;
+}
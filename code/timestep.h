@@ -0,0 +1,30 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+#include <libdragon.h>
+
+// Simulation tick rate, selectable at build time (SIM_HZ in the makefile)
+#ifndef SIM_TICK_HZ
+#define SIM_TICK_HZ 60
+#endif
+
+#define SIM_DT (1.0f / SIM_TICK_HZ)
+
+// Upper bound on catch-up ticks per rendered frame. Time beyond this is
+// dropped so one slow frame can't snowball into ever longer frames.
+#define SIM_MAX_TICKS_PER_FRAME 4
+
+typedef struct {
+    uint64_t last_ticks;        // Timer value at the previous frame
+    uint64_t accumulator;       // Unsimulated time, in timer ticks
+    uint64_t tick_length;       // One simulation tick, in timer ticks
+    uint32_t tick_count;        // Total ticks simulated so far
+    uint32_t dropped_ticks;     // Ticks discarded by the catch-up cap
+} FixedTimestep;
+
+// Fixed timestep functions
+void timestep_init(FixedTimestep* ts);
+int timestep_begin_frame(FixedTimestep* ts);
+float timestep_alpha(const FixedTimestep* ts);
+
+#endif // TIMESTEP_H
@@ -0,0 +1,125 @@
+// Queries per second of the collision world against the baked tunnel.
+// Query points are sampled on the tunnel floor so they match gameplay.
+//
+// Usage: bench_collision [file.col]
+
+#include <libdragon.h>
+#include <time.h>
+#include "collision.h"
+#include "scene_arena.h"
+
+#define BENCH_QUERIES 200000
+#define BENCH_SAMPLES 4096          // Pre-generated query inputs, reused round-robin
+
+// Same shape and camera setup as code/player.h
+#define BENCH_RADIUS 24.0f
+#define BENCH_HEIGHT 140.0f
+#define BENCH_CAMERA_DISTANCE 280.0f
+#define BENCH_MOVE_PER_TICK 13.0f   // PLAYER_SPEED * 2 (running) / 60
+
+typedef struct {
+    T3DVec3 position;
+    T3DVec3 dir;
+} BenchSample;
+
+static BenchSample samples[BENCH_SAMPLES];
+static uint32_t rng_state = 0x12345678;
+
+static float rand01(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state & 0xFFFFFF) / (float)0x1000000;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void make_samples(const CollisionWorld* world) {
+    int floors = 0;
+    for (uint32_t i = 0; i < world->header->tri_count; i++) {
+        if (world->tris[i].normal.y >= COLLISION_FLOOR_MIN_NY) floors++;
+    }
+    assertf(floors > 0, "no floor triangles");
+
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        // Random floor triangle, uniform point inside it
+        const CollisionTri* tri;
+        do {
+            tri = &world->tris[(uint32_t)(rand01() * world->header->tri_count)];
+        } while (tri->normal.y < COLLISION_FLOOR_MIN_NY);
+
+        float u = rand01(), v = rand01();
+        if (u + v > 1.0f) { u = 1.0f - u; v = 1.0f - v; }
+        T3DVec3 e1, e2;
+        t3d_vec3_diff(&e1, &tri->v[1], &tri->v[0]);
+        t3d_vec3_diff(&e2, &tri->v[2], &tri->v[0]);
+        samples[s].position = (T3DVec3){{tri->v[0].x + e1.x * u + e2.x * v,
+                                         tri->v[0].y + e1.y * u + e2.y * v,
+                                         tri->v[0].z + e1.z * u + e2.z * v}};
+
+        // Camera-like direction: backwards and up
+        float angle = rand01() * 6.2831853f;
+        samples[s].dir = (T3DVec3){{cosf(angle), 0.7f, sinf(angle)}};
+        t3d_vec3_norm(&samples[s].dir);
+    }
+}
+
+static void report(const char* name, double seconds, int hits) {
+    double qps = BENCH_QUERIES / seconds;
+    printf("  %-14s %10.0f queries/s  %7.1f ns/query  %5.1f%% hits\n",
+           name, qps, seconds * 1e9 / BENCH_QUERIES, hits * 100.0 / BENCH_QUERIES);
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "rom:/tunnel2.col";
+
+    scene_arena_init(SCENE_ARENA_SIZE, SCENE_ARENA_UNCACHED_SIZE);
+    scene_arena_begin("bench");
+    CollisionWorld world;
+    collision_init(&world, path);
+    printf("%s: %u triangles, %ux%u cells of %.0f, %u refs\n", path,
+           world.header->tri_count, world.header->grid_w, world.header->grid_h,
+           world.header->cell_size, world.header->index_count);
+
+    make_samples(&world);
+
+    int hits = 0;
+    double start = now_s();
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        const BenchSample* s = &samples[i % BENCH_SAMPLES];
+        float y;
+        hits += collision_ground_height(&world, s->position.x, s->position.z, s->position.y + 24.0f, &y);
+    }
+    report("ground_height", now_s() - start, hits);
+
+    hits = 0;
+    start = now_s();
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        const BenchSample* s = &samples[i % BENCH_SAMPLES];
+        T3DVec3 origin = s->position;
+        origin.y += 100.0f;
+        CollisionHit hit;
+        hits += collision_raycast(&world, &origin, &s->dir, BENCH_CAMERA_DISTANCE, &hit);
+    }
+    report("raycast", now_s() - start, hits);
+
+    hits = 0;
+    start = now_s();
+    CollisionCapsule capsule = {BENCH_RADIUS, BENCH_HEIGHT};
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        const BenchSample* s = &samples[i % BENCH_SAMPLES];
+        T3DVec3 position = s->position;
+        T3DVec3 motion = {{s->dir.x * BENCH_MOVE_PER_TICK, 0.0f, s->dir.z * BENCH_MOVE_PER_TICK}};
+        hits += collision_sweep_capsule(&world, &capsule, &position, &motion, NULL);
+    }
+    report("sweep_capsule", now_s() - start, hits);
+
+    collision_cleanup(&world);
+    scene_arena_end();
+    scene_arena_cleanup();
+    return 0;
+}
@@ -0,0 +1,92 @@
+// ns/call of the per-tick gameplay entry points. Host numbers don't
+// translate to the VR4300 directly; compare them run to run to catch
+// regressions.
+
+#include <libdragon.h>
+#include <time.h>
+#include "controls.h"
+#include "player.h"
+#include "timestep.h"
+#include "scene_arena.h"
+
+#define BENCH_CALLS 1000000
+#define BENCH_INPUT_PATTERN 64     // Ticks before the scripted input repeats
+
+static joypad_buttons_t pattern_buttons[BENCH_INPUT_PATTERN];
+static joypad_inputs_t pattern_inputs[BENCH_INPUT_PATTERN];
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Walks, turns, runs and jumps so every state machine branch is exercised
+static void make_pattern(void) {
+    for (int i = 0; i < BENCH_INPUT_PATTERN; i++) {
+        joypad_buttons_t buttons = {0};
+        joypad_inputs_t inputs = {0};
+        inputs.stick_y = (i / 16) % 2 ? 127 : 0;
+        inputs.stick_x = (i % 24) < 8 ? 90 : 0;
+        buttons.z = (i / 32) % 2;
+        buttons.a = (i % 40) == 0;
+        pattern_buttons[i] = buttons;
+        pattern_inputs[i] = inputs;
+    }
+}
+
+static void report(const char* name, double seconds) {
+    printf("  %-28s %8.1f ns/call\n", name, seconds * 1e9 / BENCH_CALLS);
+}
+
+static void bench_animation(Player* player, const char* name) {
+    double start = now_s();
+    for (int i = 0; i < BENCH_CALLS; i++) {
+        animation_begin_frame();
+        uint32_t conditions = 0;
+        if ((i / 16) % 2) conditions |= ANIM_COND_MOVING;
+        if ((i / 32) % 2) conditions |= ANIM_COND_RUNNING;
+        if ((i % 40) < 10) conditions |= ANIM_COND_JUMPING;
+        animation_system_update(&player->anim_system, &player->skeleton, conditions, false, SIM_DT);
+    }
+    report(name, now_s() - start);
+}
+
+int main(void) {
+    make_pattern();
+
+    // Accumulate results so the compiler can't drop the calls
+    volatile float sink = 0.0f;
+    double start = now_s();
+    for (int i = 0; i < BENCH_CALLS; i++) {
+        int p = i % BENCH_INPUT_PATTERN;
+        PlayerInput input = controls_get_player_input(pattern_buttons[p], pattern_inputs[p]);
+        sink += input.move_forward;
+    }
+    report("controls_get_player_input", now_s() - start);
+
+    scene_arena_init(SCENE_ARENA_SIZE, SCENE_ARENA_UNCACHED_SIZE);
+    scene_arena_begin("bench");
+    Player player;
+    player_init(&player);
+    start = now_s();
+    for (int i = 0; i < BENCH_CALLS; i++) {
+        int p = i % BENCH_INPUT_PATTERN;
+        player_update(&player, pattern_buttons[p], pattern_inputs[p], false);
+    }
+    report("player_update", now_s() - start);
+
+    // Cross-fades included, one tick per frame
+    animation_blend_pool_init(&player.skeleton, ANIM_BLEND_POOL_SIZE);
+    bench_animation(&player, "animation_system_update");
+
+    // Same at the farthest animation LOD
+    animation_system_set_lod(&player.anim_system, ANIM_LOD_DIST_QUARTER, true);
+    bench_animation(&player, "animation_system_update 7.5Hz");
+
+    player_cleanup(&player);
+    animation_blend_pool_cleanup();
+    scene_arena_end();
+    scene_arena_cleanup();
+    return sink == 12345.0f;
+}
@@ -0,0 +1,128 @@
+#ifndef HOST_LIBDRAGON_H
+#define HOST_LIBDRAGON_H
+
+// Host stand-in for the parts of libdragon that gameplay modules use, so
+// they can be unit tested and measured on a PC. Nothing here talks to
+// hardware: the timer is a fake clock driven by the test, the RSP queue
+// completes instantly and drawing calls do nothing.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define debugf(...) fprintf(stderr, __VA_ARGS__)
+
+#define assertf(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: assertion failed: %s: ", __FILE__, __LINE__, #cond); \
+        fprintf(stderr, __VA_ARGS__); \
+        fputc('\n', stderr); \
+        abort(); \
+    } \
+} while (0)
+
+// Timer: same rate as the N64 CPU counter, advanced with host_advance_ticks()
+#define TICKS_PER_SECOND (93750000 / 2)
+#define TICKS_READ() ((uint32_t)get_ticks())
+#define TICKS_DISTANCE(from, to) ((int32_t)((uint32_t)(to) - (uint32_t)(from)))
+#define TICKS_TO_US(t) ((uint64_t)(t) * 8 / 375)
+#define TICKS_FROM_US(us) ((uint64_t)(us) * 375 / 8)
+#define TICKS_FROM_MS(ms) ((uint64_t)(ms) * 46875)
+
+uint64_t get_ticks(void);
+void host_set_ticks(uint64_t ticks);
+void host_advance_ticks(uint64_t ticks);
+
+// Memory
+void *malloc_uncached_aligned(int align, size_t size);
+void *malloc_uncached(size_t size);
+void free_uncached(void *buf);
+static inline int is_memory_expanded(void) { return 1; }
+size_t host_heap_used(void);     // Heap bytes the game's code holds
+
+// Loads a whole file; "rom:/" maps to $HOST_ROM_DIR (default "filesystem")
+void *asset_load(const char *fn, int *sz);
+FILE *asset_fopen(const char *fn, int *sz);
+
+// Joypad
+typedef union {
+    uint16_t raw;
+    struct {
+        unsigned a : 1;
+        unsigned b : 1;
+        unsigned z : 1;
+        unsigned start : 1;
+        unsigned d_up : 1;
+        unsigned d_down : 1;
+        unsigned d_left : 1;
+        unsigned d_right : 1;
+        unsigned y : 1;
+        unsigned x : 1;
+        unsigned l : 1;
+        unsigned r : 1;
+        unsigned c_up : 1;
+        unsigned c_down : 1;
+        unsigned c_left : 1;
+        unsigned c_right : 1;
+    };
+} joypad_buttons_t;
+
+typedef struct {
+    joypad_buttons_t btn;
+    int8_t stick_x;
+    int8_t stick_y;
+    int8_t cstick_x;
+    int8_t cstick_y;
+    uint8_t analog_l;
+    uint8_t analog_r;
+} joypad_inputs_t;
+
+// EEPROM: none on the host
+typedef enum { EEPROM_NONE = 0, EEPROM_4K, EEPROM_16K } eeprom_type_t;
+static inline eeprom_type_t eeprom_present(void) { return EEPROM_NONE; }
+static inline size_t eeprom_total_blocks(void) { return 0; }
+static inline void eeprom_read_bytes(uint8_t *dest, size_t start, size_t len) { (void)dest; (void)start; (void)len; }
+static inline void eeprom_write_bytes(const uint8_t *src, size_t start, size_t len) { (void)src; (void)start; (void)len; }
+
+// Audio mixer: channels only remember what was started on them and at
+// what volume; a test ends a sound with host_mixer_ch_finish()
+#define HOST_MIXER_CHANNELS 32
+
+typedef struct {
+    char path[64];
+    bool loop;
+} wav64_t;
+
+void wav64_open(wav64_t *wav, const char *path);
+void wav64_set_loop(wav64_t *wav, bool loop);
+void wav64_play(wav64_t *wav, int ch);
+void wav64_close(wav64_t *wav);
+bool mixer_ch_playing(int ch);
+void mixer_ch_stop(int ch);
+void mixer_ch_set_vol_pan(int ch, float vol, float pan);
+const wav64_t *host_mixer_ch_wave(int ch);
+float host_mixer_ch_vol(int ch);
+float host_mixer_ch_pan(int ch);
+void host_mixer_ch_finish(int ch);
+
+// Graphics types; drawing is a no-op
+typedef struct { uint8_t r, g, b, a; } color_t;
+#define RGBA32(rx, gx, bx, ax) ((color_t){rx, gx, bx, ax})
+
+typedef struct sprite_s sprite_t;
+
+static inline void rdpq_set_prim_color(color_t color) { (void)color; }
+
+// RSP queue: every command completes immediately
+typedef int rspq_syncpoint_t;
+typedef struct rspq_block_s rspq_block_t;
+
+rspq_syncpoint_t rspq_syncpoint_new(void);
+static inline bool rspq_syncpoint_check(rspq_syncpoint_t sync) { (void)sync; return true; }
+static inline void rspq_syncpoint_wait(rspq_syncpoint_t sync) { (void)sync; }
+static inline void rspq_wait(void) {}
+
+#endif // HOST_LIBDRAGON_H
@@ -0,0 +1,36 @@
+#ifndef HOST_T3D_H
+#define HOST_T3D_H
+
+// Host stand-in for tiny3d's core API; matrix stack calls do nothing
+
+#include <libdragon.h>
+#include <t3d/t3dmath.h>
+
+#define T3D_DEG_TO_RAD(deg) ((deg) * 0.01745329252f)
+
+// Planes as normal (xyz) and distance (w), inside where dot + w >= 0
+typedef struct {
+    T3DVec4 planes[6];
+} T3DFrustum;
+
+// Only the matrices and frustum gameplay code reads back
+typedef struct {
+    int offset[2];
+    int size[2];
+    T3DMat4 matProj;
+    T3DMat4 matCamera;
+    T3DFrustum viewFrustum;
+} T3DViewport;
+
+bool t3d_frustum_vs_aabb(const T3DFrustum *frustum, const T3DVec3 *min, const T3DVec3 *max);
+
+static inline void t3d_matrix_push(const T3DMat4FP *mat) { (void)mat; }
+static inline void t3d_matrix_pop(int count) { (void)count; }
+
+// Lights go nowhere, callers count their own uploads
+static inline void t3d_light_set_point(int index, const uint8_t *color, const T3DVec3 *pos, float size, bool ignoreNormals) {
+    (void)index; (void)color; (void)pos; (void)size; (void)ignoreNormals;
+}
+static inline void t3d_light_set_count(int count) { (void)count; }
+
+#endif // HOST_T3D_H
@@ -0,0 +1,26 @@
+#ifndef HOST_T3DANIM_H
+#define HOST_T3DANIM_H
+
+// Host animations only track playback time, they don't pose bones
+
+#include <t3d/t3dskeleton.h>
+
+typedef struct {
+    const T3DChunkAnim *animRef;
+    const T3DSkeleton *skeleton;
+    float speed;
+    float time;
+    bool isPlaying;
+    bool isLooping;
+} T3DAnim;
+
+T3DAnim t3d_anim_create(const T3DModel *model, const char *name);
+void t3d_anim_destroy(T3DAnim *anim);
+void t3d_anim_attach(T3DAnim *anim, const T3DSkeleton *skeleton);
+void t3d_anim_update(T3DAnim *anim, float deltaTime);
+void t3d_anim_set_playing(T3DAnim *anim, bool isPlaying);
+void t3d_anim_set_looping(T3DAnim *anim, bool loop);
+void t3d_anim_set_time(T3DAnim *anim, float time);
+void t3d_anim_set_speed(T3DAnim *anim, float speed);
+
+#endif // HOST_T3DANIM_H
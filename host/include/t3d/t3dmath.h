@@ -0,0 +1,80 @@
+#ifndef HOST_T3DMATH_H
+#define HOST_T3DMATH_H
+
+// Host copy of the tiny3d math types and the helpers gameplay modules use
+
+#include <stdint.h>
+#include <math.h>
+
+typedef union {
+    struct { float x, y, z; };
+    float v[3];
+} T3DVec3;
+
+typedef union {
+    struct { float x, y, z, w; };
+    float v[4];
+} T3DVec4;
+
+typedef T3DVec4 T3DQuat;
+
+typedef struct {
+    float m[4][4];
+} T3DMat4;
+
+typedef struct {
+    struct {
+        int16_t i[4];
+        uint16_t f[4];
+    } m[4];
+} T3DMat4FP;
+
+static inline void t3d_vec3_add(T3DVec3 *res, const T3DVec3 *a, const T3DVec3 *b) {
+    res->x = a->x + b->x; res->y = a->y + b->y; res->z = a->z + b->z;
+}
+
+static inline void t3d_vec3_diff(T3DVec3 *res, const T3DVec3 *a, const T3DVec3 *b) {
+    res->x = a->x - b->x; res->y = a->y - b->y; res->z = a->z - b->z;
+}
+
+static inline void t3d_vec3_scale(T3DVec3 *res, const T3DVec3 *a, float s) {
+    res->x = a->x * s; res->y = a->y * s; res->z = a->z * s;
+}
+
+static inline float t3d_vec3_dot(const T3DVec3 *a, const T3DVec3 *b) {
+    return a->x * b->x + a->y * b->y + a->z * b->z;
+}
+
+static inline void t3d_vec3_cross(T3DVec3 *res, const T3DVec3 *a, const T3DVec3 *b) {
+    T3DVec3 r = {{a->y * b->z - a->z * b->y, a->z * b->x - a->x * b->z, a->x * b->y - a->y * b->x}};
+    *res = r;
+}
+
+static inline float t3d_vec3_len2(const T3DVec3 *a) { return t3d_vec3_dot(a, a); }
+static inline float t3d_vec3_len(const T3DVec3 *a) { return sqrtf(t3d_vec3_len2(a)); }
+
+static inline float t3d_vec3_distance2(const T3DVec3 *a, const T3DVec3 *b) {
+    T3DVec3 d;
+    t3d_vec3_diff(&d, a, b);
+    return t3d_vec3_len2(&d);
+}
+
+static inline float t3d_vec3_distance(const T3DVec3 *a, const T3DVec3 *b) {
+    return sqrtf(t3d_vec3_distance2(a, b));
+}
+
+static inline void t3d_vec3_norm(T3DVec3 *res) {
+    float len = t3d_vec3_len(res);
+    if (len > 0.0f) t3d_vec3_scale(res, res, 1.0f / len);
+}
+
+static inline void t3d_vec3_lerp(T3DVec3 *res, const T3DVec3 *a, const T3DVec3 *b, float t) {
+    res->x = a->x + (b->x - a->x) * t;
+    res->y = a->y + (b->y - a->y) * t;
+    res->z = a->z + (b->z - a->z) * t;
+}
+
+void t3d_mat4fp_identity(T3DMat4FP *mat);
+void t3d_mat4fp_from_srt_euler(T3DMat4FP *mat, const float scale[3], const float rot[3], const float translate[3]);
+
+#endif // HOST_T3DMATH_H
@@ -0,0 +1,56 @@
+#ifndef HOST_T3DMODEL_H
+#define HOST_T3DMODEL_H
+
+// Host models are synthetic: t3d_model_load() returns a skeleton and the
+// animation set of the player model (see host/t3d_host.c), no geometry.
+
+#include <t3d/t3d.h>
+
+typedef struct {
+    char *name;
+    float duration;
+    uint32_t keyframeCount;
+} T3DChunkAnim;
+
+typedef struct {
+    uint16_t boneCount;
+} T3DChunkSkeleton;
+
+typedef struct {
+    char *name;
+    uint32_t triCount;
+    int16_t aabbMin[3];
+    int16_t aabbMax[3];
+} T3DObject;
+
+typedef enum {
+    T3D_CHUNK_TYPE_OBJECT = 'O',
+} T3DModelChunkType;
+
+typedef struct {
+    const struct T3DModel_s *_model;
+    uint32_t _idx;
+    T3DObject *object;
+} T3DModelIter;
+
+typedef struct T3DModel_s {
+    T3DChunkSkeleton skeleton;
+    uint32_t animCount;
+    T3DChunkAnim *anims;
+} T3DModel;
+
+T3DModel *t3d_model_load(const char *path);
+void t3d_model_free(T3DModel *model);
+
+uint32_t t3d_model_get_animation_count(const T3DModel *model);
+void t3d_model_get_animations(const T3DModel *model, T3DChunkAnim **anims);
+T3DChunkAnim *t3d_model_get_animation(const T3DModel *model, const char *name);
+const T3DChunkSkeleton *t3d_model_get_skeleton(const T3DModel *model);
+
+static inline void t3d_model_draw(const T3DModel *model) { (void)model; }
+
+// No geometry on the host, iterators end right away
+T3DModelIter t3d_model_iter_create(const T3DModel *model, T3DModelChunkType type);
+bool t3d_model_iter_next(T3DModelIter *iter);
+
+#endif // HOST_T3DMODEL_H
@@ -0,0 +1,28 @@
+#ifndef HOST_T3DSKELETON_H
+#define HOST_T3DSKELETON_H
+
+#include <t3d/t3dmodel.h>
+
+typedef struct {
+    T3DQuat rotation;
+    T3DVec3 position;
+    T3DVec3 scale;
+    T3DMat4 matrix;
+    int hasChanged;
+} T3DBone;
+
+typedef struct {
+    const T3DChunkSkeleton *skeletonRef;
+    T3DBone *bones;
+    T3DMat4FP *boneMatricesFP;
+} T3DSkeleton;
+
+T3DSkeleton t3d_skeleton_create(const T3DModel *model);
+T3DSkeleton t3d_skeleton_clone(const T3DSkeleton *skel, bool useMatrices);
+void t3d_skeleton_update(T3DSkeleton *skel);
+void t3d_skeleton_blend(const T3DSkeleton *skelRes, const T3DSkeleton *skelA, const T3DSkeleton *skelB, float factor);
+void t3d_skeleton_destroy(T3DSkeleton *skel);
+
+static inline void t3d_model_draw_skinned(const T3DModel *model, const T3DSkeleton *skel) { (void)model; (void)skel; }
+
+#endif // HOST_T3DSKELETON_H
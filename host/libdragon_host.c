@@ -0,0 +1,158 @@
+#include <libdragon.h>
+#include <malloc.h>
+
+static uint64_t host_ticks = 0;
+static rspq_syncpoint_t host_syncpoint = 0;
+
+static struct {
+    const wav64_t* wave;
+    float vol;
+    float pan;
+} host_mixer[HOST_MIXER_CHANNELS];
+
+uint64_t get_ticks(void) {
+    return host_ticks;
+}
+
+void host_set_ticks(uint64_t ticks) {
+    host_ticks = ticks;
+}
+
+void host_advance_ticks(uint64_t ticks) {
+    host_ticks += ticks;
+}
+
+// Heap bytes held by the game's code, for the scene arena's leak check. The
+// makefile links with --wrap for these, so allocations the C library makes
+// for itself (stdio buffers and the like) aren't counted.
+static size_t host_heap_bytes = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_memalign(size_t align, size_t size);
+void *__real_aligned_alloc(size_t align, size_t size);
+void __real_free(void *ptr);
+
+static void *host_heap_track(void *ptr) {
+    if (ptr) host_heap_bytes += malloc_usable_size(ptr);
+    return ptr;
+}
+
+void *__wrap_malloc(size_t size) { return host_heap_track(__real_malloc(size)); }
+void *__wrap_calloc(size_t count, size_t size) { return host_heap_track(__real_calloc(count, size)); }
+void *__wrap_memalign(size_t align, size_t size) { return host_heap_track(__real_memalign(align, size)); }
+void *__wrap_aligned_alloc(size_t align, size_t size) { return host_heap_track(__real_aligned_alloc(align, size)); }
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    size_t old = ptr ? malloc_usable_size(ptr) : 0;
+    void *moved = __real_realloc(ptr, size);
+    if (moved || size == 0) host_heap_bytes -= old;
+    return host_heap_track(moved);
+}
+
+void __wrap_free(void *ptr) {
+    if (ptr) host_heap_bytes -= malloc_usable_size(ptr);
+    __real_free(ptr);
+}
+
+size_t host_heap_used(void) {
+    return host_heap_bytes;
+}
+
+void *malloc_uncached_aligned(int align, size_t size) {
+    size = (size + align - 1) / align * align;
+    return aligned_alloc(align, size);
+}
+
+void *malloc_uncached(size_t size) {
+    return malloc_uncached_aligned(16, size);
+}
+
+void free_uncached(void *buf) {
+    free(buf);
+}
+
+rspq_syncpoint_t rspq_syncpoint_new(void) {
+    return ++host_syncpoint;
+}
+
+FILE *asset_fopen(const char *fn, int *sz) {
+    char path[512];
+    if (strncmp(fn, "rom:/", 5) == 0) {
+        const char* root = getenv("HOST_ROM_DIR");
+        snprintf(path, sizeof(path), "%s/%s", root ? root : "filesystem", fn + 5);
+    } else {
+        snprintf(path, sizeof(path), "%s", fn);
+    }
+
+    FILE* f = fopen(path, "rb");
+    assertf(f != NULL, "asset_fopen: can't open %s", path);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (sz) *sz = (int)size;
+    return f;
+}
+
+void *asset_load(const char *fn, int *sz) {
+    int size = 0;
+    FILE* f = asset_fopen(fn, &size);
+    void* data = malloc(size);
+    assertf(fread(data, 1, size, f) == (size_t)size, "asset_load: short read on %s", fn);
+    fclose(f);
+
+    if (sz) *sz = size;
+    return data;
+}
+
+void wav64_open(wav64_t *wav, const char *path) {
+    snprintf(wav->path, sizeof(wav->path), "%s", path);
+    wav->loop = false;
+}
+
+void wav64_set_loop(wav64_t *wav, bool loop) {
+    wav->loop = loop;
+}
+
+void wav64_play(wav64_t *wav, int ch) {
+    host_mixer[ch].wave = wav;
+    host_mixer[ch].vol = 1.0f;
+    host_mixer[ch].pan = 0.5f;
+}
+
+void wav64_close(wav64_t *wav) {
+    for (int i = 0; i < HOST_MIXER_CHANNELS; i++) {
+        assertf(host_mixer[i].wave != wav, "wav64_close: %s still playing on channel %d", wav->path, i);
+    }
+}
+
+bool mixer_ch_playing(int ch) {
+    return host_mixer[ch].wave != NULL;
+}
+
+void mixer_ch_stop(int ch) {
+    host_mixer[ch].wave = NULL;
+}
+
+void mixer_ch_set_vol_pan(int ch, float vol, float pan) {
+    host_mixer[ch].vol = vol;
+    host_mixer[ch].pan = pan;
+}
+
+const wav64_t *host_mixer_ch_wave(int ch) {
+    return host_mixer[ch].wave;
+}
+
+float host_mixer_ch_vol(int ch) {
+    return host_mixer[ch].vol;
+}
+
+float host_mixer_ch_pan(int ch) {
+    return host_mixer[ch].pan;
+}
+
+void host_mixer_ch_finish(int ch) {
+    host_mixer[ch].wave = NULL;
+}
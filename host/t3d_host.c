@@ -0,0 +1,211 @@
+#include <t3d/t3d.h>
+#include <t3d/t3dmodel.h>
+#include <t3d/t3dskeleton.h>
+#include <t3d/t3danim.h>
+
+// Bone count and gameplay animations of assets/player3.glb
+#define HOST_BONE_COUNT 39
+
+static T3DChunkAnim host_player_anims[] = {
+    {"Idle", 0.6667f, 20},
+    {"Jump", 0.6667f, 20},
+    {"Run", 0.8333f, 25},
+    {"Walk", 1.3333f, 40},
+};
+
+T3DModel *t3d_model_load(const char *path) {
+    (void)path;
+    T3DModel* model = malloc(sizeof(T3DModel));
+    model->skeleton.boneCount = HOST_BONE_COUNT;
+    model->animCount = sizeof(host_player_anims) / sizeof(host_player_anims[0]);
+    model->anims = host_player_anims;
+    return model;
+}
+
+void t3d_model_free(T3DModel *model) {
+    free(model);
+}
+
+uint32_t t3d_model_get_animation_count(const T3DModel *model) {
+    return model->animCount;
+}
+
+void t3d_model_get_animations(const T3DModel *model, T3DChunkAnim **anims) {
+    for (uint32_t i = 0; i < model->animCount; i++) anims[i] = &model->anims[i];
+}
+
+T3DChunkAnim *t3d_model_get_animation(const T3DModel *model, const char *name) {
+    for (uint32_t i = 0; i < model->animCount; i++) {
+        if (strcmp(model->anims[i].name, name) == 0) return &model->anims[i];
+    }
+    return NULL;
+}
+
+const T3DChunkSkeleton *t3d_model_get_skeleton(const T3DModel *model) {
+    return &model->skeleton;
+}
+
+T3DModelIter t3d_model_iter_create(const T3DModel *model, T3DModelChunkType type) {
+    (void)type;
+    return (T3DModelIter){._model = model};
+}
+
+bool t3d_model_iter_next(T3DModelIter *iter) {
+    iter->object = NULL;
+    return false;
+}
+
+// Skeleton
+
+T3DSkeleton t3d_skeleton_create(const T3DModel *model) {
+    T3DSkeleton skel;
+    skel.skeletonRef = &model->skeleton;
+    skel.bones = calloc(model->skeleton.boneCount, sizeof(T3DBone));
+    skel.boneMatricesFP = malloc_uncached(model->skeleton.boneCount * sizeof(T3DMat4FP));
+    for (int i = 0; i < model->skeleton.boneCount; i++) {
+        skel.bones[i].rotation = (T3DQuat){{0.0f, 0.0f, 0.0f, 1.0f}};
+        skel.bones[i].scale = (T3DVec3){{1.0f, 1.0f, 1.0f}};
+        skel.bones[i].hasChanged = true;
+    }
+    return skel;
+}
+
+T3DSkeleton t3d_skeleton_clone(const T3DSkeleton *skel, bool useMatrices) {
+    int count = skel->skeletonRef->boneCount;
+    T3DSkeleton clone;
+    clone.skeletonRef = skel->skeletonRef;
+    clone.bones = malloc(count * sizeof(T3DBone));
+    memcpy(clone.bones, skel->bones, count * sizeof(T3DBone));
+    clone.boneMatricesFP = useMatrices ? malloc_uncached(count * sizeof(T3DMat4FP)) : NULL;
+    return clone;
+}
+
+void t3d_skeleton_blend(const T3DSkeleton *skelRes, const T3DSkeleton *skelA, const T3DSkeleton *skelB, float factor) {
+    // Lerp position/scale, nlerp rotation along the shorter arc, like tiny3d
+    for (int i = 0; i < skelRes->skeletonRef->boneCount; i++) {
+        const T3DBone* a = &skelA->bones[i];
+        const T3DBone* b = &skelB->bones[i];
+        T3DBone* res = &skelRes->bones[i];
+        float sign = a->rotation.x * b->rotation.x + a->rotation.y * b->rotation.y +
+                     a->rotation.z * b->rotation.z + a->rotation.w * b->rotation.w < 0.0f ? -1.0f : 1.0f;
+        float len = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            res->rotation.v[c] = a->rotation.v[c] + (b->rotation.v[c] * sign - a->rotation.v[c]) * factor;
+            len += res->rotation.v[c] * res->rotation.v[c];
+        }
+        len = sqrtf(len);
+        for (int c = 0; c < 4; c++) res->rotation.v[c] /= len;
+        for (int c = 0; c < 3; c++) {
+            res->position.v[c] = a->position.v[c] + (b->position.v[c] - a->position.v[c]) * factor;
+            res->scale.v[c] = a->scale.v[c] + (b->scale.v[c] - a->scale.v[c]) * factor;
+        }
+        res->hasChanged = true;
+    }
+}
+
+void t3d_skeleton_update(T3DSkeleton *skel) {
+    // Same data flow as tiny3d: only dirty bones are rewritten
+    for (int i = 0; i < skel->skeletonRef->boneCount; i++) {
+        T3DBone* bone = &skel->bones[i];
+        if (!bone->hasChanged) continue;
+        float rot[3] = {bone->rotation.x, bone->rotation.y, bone->rotation.z};
+        t3d_mat4fp_from_srt_euler(&skel->boneMatricesFP[i], bone->scale.v, rot, bone->position.v);
+        bone->hasChanged = false;
+    }
+}
+
+void t3d_skeleton_destroy(T3DSkeleton *skel) {
+    free(skel->bones);
+    skel->bones = NULL;
+    if (skel->boneMatricesFP) free_uncached(skel->boneMatricesFP);
+    skel->boneMatricesFP = NULL;
+}
+
+// Animation
+
+T3DAnim t3d_anim_create(const T3DModel *model, const char *name) {
+    T3DAnim anim = {0};
+    anim.animRef = t3d_model_get_animation(model, name);
+    anim.speed = 1.0f;
+    anim.isPlaying = true;
+    anim.isLooping = true;
+    return anim;
+}
+
+void t3d_anim_destroy(T3DAnim *anim) {
+    anim->animRef = NULL;
+}
+
+void t3d_anim_attach(T3DAnim *anim, const T3DSkeleton *skeleton) {
+    anim->skeleton = skeleton;
+    anim->time = 0.0f;
+}
+
+void t3d_anim_update(T3DAnim *anim, float deltaTime) {
+    if (!anim->isPlaying || !anim->animRef) return;
+    anim->time += deltaTime * anim->speed;
+    if (anim->time >= anim->animRef->duration) {
+        if (anim->isLooping) {
+            anim->time = fmodf(anim->time, anim->animRef->duration);
+        } else {
+            anim->time = anim->animRef->duration;
+            anim->isPlaying = false;
+        }
+    }
+}
+
+void t3d_anim_set_playing(T3DAnim *anim, bool isPlaying) {
+    anim->isPlaying = isPlaying;
+}
+
+void t3d_anim_set_looping(T3DAnim *anim, bool loop) {
+    anim->isLooping = loop;
+}
+
+void t3d_anim_set_time(T3DAnim *anim, float time) {
+    anim->time = time;
+}
+
+void t3d_anim_set_speed(T3DAnim *anim, float speed) {
+    anim->speed = speed;
+}
+
+// Math
+
+bool t3d_frustum_vs_aabb(const T3DFrustum *frustum, const T3DVec3 *min, const T3DVec3 *max) {
+    // Outside once the box corner furthest along a plane's normal is behind it
+    for (int i = 0; i < 6; i++) {
+        const T3DVec4* plane = &frustum->planes[i];
+        float x = plane->x >= 0.0f ? max->x : min->x;
+        float y = plane->y >= 0.0f ? max->y : min->y;
+        float z = plane->z >= 0.0f ? max->z : min->z;
+        if (plane->x * x + plane->y * y + plane->z * z + plane->w < 0.0f) return false;
+    }
+    return true;
+}
+
+void t3d_mat4fp_identity(T3DMat4FP *mat) {
+    memset(mat, 0, sizeof(T3DMat4FP));
+    for (int i = 0; i < 4; i++) mat->m[i].i[i] = 1;
+}
+
+void t3d_mat4fp_from_srt_euler(T3DMat4FP *mat, const float scale[3], const float rot[3], const float translate[3]) {
+    float cx = cosf(rot[0]), sx = sinf(rot[0]);
+    float cy = cosf(rot[1]), sy = sinf(rot[1]);
+    float cz = cosf(rot[2]), sz = sinf(rot[2]);
+    float m[4][4] = {
+        {scale[0] * (cy * cz), scale[0] * (cy * sz), scale[0] * -sy, 0.0f},
+        {scale[1] * (sx * sy * cz - cx * sz), scale[1] * (sx * sy * sz + cx * cz), scale[1] * (sx * cy), 0.0f},
+        {scale[2] * (cx * sy * cz + sx * sz), scale[2] * (cx * sy * sz - sx * cz), scale[2] * (cx * cy), 0.0f},
+        {translate[0], translate[1], translate[2], 1.0f},
+    };
+
+    // 16.16 fixed point split into integer and fraction halves like tiny3d
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            int32_t fixed = (int32_t)(m[c][r] * 65536.0f);
+            mat->m[c].i[r] = (int16_t)(fixed >> 16);
+            mat->m[c].f[r] = (uint16_t)(fixed & 0xFFFF);
+        }
+    }
+}
@@ -0,0 +1,801 @@
+// Unit tests for controls, player movement/jump and the animation state
+// machine, run against the host stub layer.
+
+#include <libdragon.h>
+#include <math.h>
+#include "controls.h"
+#include "player.h"
+#include "timestep.h"
+#include "frame_alloc.h"
+#include "crowd.h"
+#include "lights.h"
+#include "sfx.h"
+#include "level.h"
+#include "scene_arena.h"
+#include "replay.h"
+
+static int checks_run = 0;
+static int checks_failed = 0;
+
+#define CHECK(cond) do { \
+    checks_run++; \
+    if (!(cond)) { \
+        checks_failed++; \
+        fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_NEAR(a, b, eps) do { \
+    checks_run++; \
+    double va_ = (a), vb_ = (b); \
+    if (fabs(va_ - vb_) > (eps)) { \
+        checks_failed++; \
+        fprintf(stderr, "  FAIL %s:%d: %s = %f, expected %f\n", __FILE__, __LINE__, #a, va_, vb_); \
+    } \
+} while (0)
+
+// Every test runs as its own scene
+#define RUN_TEST(fn) do { printf("%s\n", #fn); scene_arena_begin(#fn); fn(); scene_arena_end(); } while (0)
+
+static const joypad_buttons_t NO_BUTTONS = {0};
+
+static joypad_inputs_t stick(int x, int y) {
+    joypad_inputs_t inputs = {0};
+    inputs.stick_x = x;
+    inputs.stick_y = y;
+    return inputs;
+}
+
+static void run_ticks(Player* player, joypad_buttons_t buttons, joypad_inputs_t inputs, int ticks) {
+    for (int i = 0; i < ticks; i++) {
+        player_update(player, buttons, inputs, false);
+    }
+}
+
+static const char* current_anim_name(const Player* player) {
+    const AnimationSystem* anim = &player->anim_system;
+    if (anim->current_state < 0) return "";
+    return anim->graph->states[anim->current_state].clip;
+}
+
+static const T3DAnim* current_clip(const Player* player) {
+    return &player->anim_system.clips[player->anim_system.current_state];
+}
+
+// Controls
+
+static void test_controls_stick(void) {
+    PlayerInput input = controls_get_player_input(NO_BUTTONS, stick(-64, 127));
+    CHECK_NEAR(input.move_forward, 1.0f, 1e-6);
+    CHECK_NEAR(input.turn_rate, -64 / 127.0f, 1e-6);
+    CHECK_NEAR(input.move_right, 0.0f, 1e-6);
+
+    input = controls_get_player_input(NO_BUTTONS, stick(0, -128));
+    CHECK_NEAR(input.move_forward, -1.0f, 1e-6);  // Clamped
+}
+
+static void test_controls_dpad_fallback(void) {
+    joypad_buttons_t buttons = {0};
+    buttons.d_up = 1;
+    buttons.d_right = 1;
+    PlayerInput input = controls_get_player_input(buttons, stick(0, 0));
+    CHECK_NEAR(input.move_forward, 1.0f, 1e-6);
+    CHECK_NEAR(input.turn_rate, 1.0f, 1e-6);
+
+    // The stick wins while it is being used
+    input = controls_get_player_input(buttons, stick(0, -64));
+    CHECK_NEAR(input.move_forward, -64 / 127.0f, 1e-6);
+}
+
+static void test_controls_buttons(void) {
+    joypad_buttons_t buttons = {0};
+    buttons.a = 1;
+    buttons.z = 1;
+    buttons.l = 1;
+    PlayerInput input = controls_get_player_input(buttons, stick(0, 0));
+    CHECK(input.jump);
+    CHECK(input.run);
+    CHECK(input.camera_reset);
+    CHECK(!input.action);
+}
+
+// Movement
+
+static void test_player_walks_forward(void) {
+    Player player;
+    player_init(&player);
+    float rot = player.rotation_y;
+
+    run_ticks(&player, NO_BUTTONS, stick(0, 127), SIM_TICK_HZ);
+
+    // One second of full stick covers PLAYER_SPEED units along the facing
+    CHECK_NEAR(player.position.x, sinf(rot) * PLAYER_SPEED, 0.5);
+    CHECK_NEAR(player.position.z, -cosf(rot) * PLAYER_SPEED, 0.5);
+    CHECK_NEAR(player.position.y, 0.0f, 1e-4);
+    CHECK(player.is_grounded);
+    player_cleanup(&player);
+}
+
+static void test_player_runs_faster(void) {
+    Player player;
+    player_init(&player);
+    joypad_buttons_t buttons = {0};
+    buttons.z = 1;
+
+    run_ticks(&player, buttons, stick(0, 127), SIM_TICK_HZ);
+
+    float dist = sqrtf(player.position.x * player.position.x + player.position.z * player.position.z);
+    CHECK_NEAR(dist, PLAYER_SPEED * 2.0f, 1.0);
+    player_cleanup(&player);
+}
+
+static void test_player_turns(void) {
+    Player player;
+    player_init(&player);
+    float start = player.rotation_y;
+
+    run_ticks(&player, NO_BUTTONS, stick(127, 0), SIM_TICK_HZ / 2);
+
+    float turned = fmodf(player.rotation_y - start + 4.0f * M_PI, 2.0f * M_PI);
+    CHECK_NEAR(turned, TURN_SPEED * 0.5f, 1e-3);
+    CHECK(player.rotation_y >= 0.0f && player.rotation_y < 2.0f * M_PI);
+    CHECK_NEAR(player.position.x, 0.0f, 1e-4);
+    player_cleanup(&player);
+}
+
+static void test_player_late_turn(void) {
+    Player player;
+    player_init(&player);
+
+    // One tick turning at full stick: how far a tick turns
+    float start = player.rotation_y;
+    player_update(&player, NO_BUTTONS, stick(127, 0), false);
+    float tick_turn = player.rotation_y - start;
+    CHECK(tick_turn != 0.0f);
+
+    // Same input as the tick: nothing to correct
+    CHECK(player_late_turn(&player, NO_BUTTONS, stick(127, 0), SIM_DT * 0.5f) == 0.0f);
+
+    // Stick released since the tick: half a tick later, half a tick back
+    CHECK_NEAR(player_late_turn(&player, NO_BUTTONS, stick(0, 0), SIM_DT * 0.5f), -tick_turn * 0.5f, 1e-5);
+
+    // Starting to turn from rest, the same way the next tick will
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    CHECK_NEAR(player_late_turn(&player, NO_BUTTONS, stick(127, 0), SIM_DT), tick_turn, 1e-5);
+    CHECK_NEAR(player.yaw_correction, tick_turn, 1e-5);
+
+    // Never more than a running tick's turn, however late
+    CHECK(fabsf(player_late_turn(&player, NO_BUTTONS, stick(127, 0), 1.0f)) <= fabsf(tick_turn) * RUN_TURN_FACTOR + 1e-5f);
+    CHECK(player.rotation_y == start + tick_turn);
+    player_cleanup(&player);
+}
+
+// Jump
+
+static void test_jump_arc(void) {
+    Player player;
+    player_init(&player);
+    joypad_buttons_t jump = {0};
+    jump.a = 1;
+
+    player_update(&player, jump, stick(0, 0), false);
+    CHECK(!player.is_grounded);
+
+    float apex = player.position.y;
+    int airborne_ticks = 1;
+    while (!player.is_grounded && airborne_ticks < 10 * SIM_TICK_HZ) {
+        player_update(&player, NO_BUTTONS, stick(0, 0), false);
+        if (player.position.y > apex) apex = player.position.y;
+        airborne_ticks++;
+    }
+
+    // Exact integration: apex v^2/2g, flight time 2v/g, independent of tick rate
+    float expected_ticks = 2.0f * JUMP_SPEED / GRAVITY * SIM_TICK_HZ;
+    CHECK_NEAR(apex, JUMP_SPEED * JUMP_SPEED / (2.0f * GRAVITY), 1.5);
+    CHECK(fabsf(airborne_ticks - expected_ticks) <= 1.0f);
+    CHECK(player.is_grounded);
+    CHECK_NEAR(player.position.y, 0.0f, 1e-4);
+    player_cleanup(&player);
+}
+
+static void test_jump_needs_release(void) {
+    Player player;
+    player_init(&player);
+    joypad_buttons_t jump = {0};
+    jump.a = 1;
+
+    // Holding A through a whole jump must not bounce straight into another
+    run_ticks(&player, jump, stick(0, 0), SIM_TICK_HZ * 2);
+    CHECK(player.is_grounded);
+
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    player_update(&player, jump, stick(0, 0), false);
+    CHECK(!player.is_grounded);
+    player_cleanup(&player);
+}
+
+// Animation state machine
+
+static void test_anim_idle_walk_idle(void) {
+    Player player;
+    player_init(&player);
+
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    CHECK(strcmp(current_anim_name(&player), "Idle") == 0);
+
+    player_update(&player, NO_BUTTONS, stick(0, 127), false);
+    CHECK(strcmp(current_anim_name(&player), "Walk") == 0);
+    CHECK((*current_clip(&player)).isLooping);
+
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    CHECK(strcmp(current_anim_name(&player), "Idle") == 0);
+    player_cleanup(&player);
+}
+
+static void test_anim_run(void) {
+    Player player;
+    player_init(&player);
+    joypad_buttons_t buttons = {0};
+    buttons.z = 1;
+
+    run_ticks(&player, buttons, stick(0, 127), SIM_TICK_HZ * 2);
+    CHECK(strcmp(current_anim_name(&player), "Run") == 0);
+    CHECK((*current_clip(&player)).isPlaying);
+    player_cleanup(&player);
+}
+
+static void test_anim_jump_returns_to_idle(void) {
+    Player player;
+    player_init(&player);
+    joypad_buttons_t jump = {0};
+    jump.a = 1;
+
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    player_update(&player, jump, stick(0, 0), false);
+    CHECK(strcmp(current_anim_name(&player), "Jump") == 0);
+    CHECK(!(*current_clip(&player)).isLooping);
+
+    // Land and let the one-shot jump animation run out
+    run_ticks(&player, NO_BUTTONS, stick(0, 0), SIM_TICK_HZ * 2);
+    CHECK(player.is_grounded);
+    CHECK(strcmp(current_anim_name(&player), "Idle") == 0);
+    player_cleanup(&player);
+}
+
+static void test_anim_graph_shared(void) {
+    Player player;
+    player_init(&player);
+    const AnimGraph* graph = player.anim_graph;
+    CHECK(graph->state_count == 4);
+    CHECK(animation_graph_find_state(graph, "jump") >= 0);
+
+    // "any" rules are merged into every other state's list
+    int jump = animation_graph_find_state(graph, "jump");
+    for (int s = 0; s < graph->state_count; s++) {
+        const AnimGraphState* state = &graph->states[s];
+        bool has_jump = false;
+        for (int t = 0; t < state->transition_count; t++) {
+            has_jump |= graph->transitions[state->first_transition + t].target == jump;
+        }
+        CHECK(has_jump == (s != jump));
+    }
+
+    // A second character on the same graph animates independently
+    AnimationSystem npc;
+    animation_system_init(&npc, graph, player.model);
+    animation_system_update(&npc, &player.skeleton, ANIM_COND_MOVING | ANIM_COND_RUNNING, false, SIM_DT);
+    animation_system_update(&player.anim_system, &player.skeleton, 0, false, SIM_DT);
+    CHECK(strcmp(animation_system_state_name(&npc), "run") == 0);
+    CHECK(strcmp(animation_system_state_name(&player.anim_system), "idle") == 0);
+
+    animation_system_cleanup(&npc);
+    player_cleanup(&player);
+}
+
+static void test_anim_cross_fade_budget(void) {
+    Player player;
+    player_init(&player);
+    animation_blend_pool_init(&player.skeleton, 2);
+    animation_begin_frame();
+
+    // The player fades from idle into walk, then the fade runs out
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    player_update(&player, NO_BUTTONS, stick(0, 127), false);
+    CHECK(strcmp(current_anim_name(&player), "Walk") == 0);
+    CHECK(player.anim_system.blend_slot >= 0);
+    CHECK(animation_frame_stats()->blends == 1);
+    for (int i = 0; i < SIM_TICK_HZ; i++) {
+        animation_begin_frame();
+        player_update(&player, NO_BUTTONS, stick(0, 127), false);
+    }
+    CHECK(player.anim_system.blend_slot < 0);
+
+    // Low priority characters leave the reserved slot to the player
+    T3DSkeleton npc_skeleton[2];
+    AnimationSystem npc[2];
+    for (int i = 0; i < 2; i++) {
+        npc_skeleton[i] = t3d_skeleton_create(player.model);
+        animation_system_init(&npc[i], player.anim_graph, player.model);
+        animation_system_update(&npc[i], &npc_skeleton[i], 0, false, SIM_DT);
+        animation_system_update(&npc[i], &npc_skeleton[i], ANIM_COND_MOVING, false, SIM_DT);
+    }
+    CHECK(npc[0].blend_slot >= 0);
+    CHECK(npc[1].blend_slot < 0);
+    CHECK(strcmp(animation_system_state_name(&npc[1]), "walk") == 0);
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    CHECK(player.anim_system.blend_slot >= 0);
+
+    // Without a new frame the per-frame cap cuts the remaining fades short
+    for (int i = 0; i < SIM_TICK_HZ / 10; i++) {
+        player_update(&player, NO_BUTTONS, stick(0, 0), false);
+        animation_system_update(&npc[0], &npc_skeleton[0], ANIM_COND_MOVING, false, SIM_DT);
+    }
+    CHECK(animation_frame_stats()->blends <= ANIM_BLEND_MAX_PER_FRAME);
+    CHECK(npc[0].blend_slot < 0);
+
+    for (int i = 0; i < 2; i++) {
+        animation_system_cleanup(&npc[i]);
+        t3d_skeleton_destroy(&npc_skeleton[i]);
+    }
+    player_cleanup(&player);
+    animation_blend_pool_cleanup();
+}
+
+static void test_anim_lod(void) {
+    frame_alloc_init(FRAME_ALLOC_SIZE);
+    Player player;
+    player_init(&player);
+    AnimationSystem* anim = &player.anim_system;
+
+    // Far away, the clip only advances every eighth tick, by all the time skipped
+    anim->lod_phase = 0;
+    player_update(&player, NO_BUTTONS, stick(0, 0), false);
+    animation_system_set_lod(anim, ANIM_LOD_DIST_QUARTER + 1.0f, true);
+    CHECK(anim->lod == ANIM_LOD_EIGHTH);
+    animation_begin_frame();
+    int advanced = 0;
+    float last_time = current_clip(&player)->time;
+    for (int i = 0; i < 16; i++) {
+        player_update(&player, NO_BUTTONS, stick(0, 0), false);
+        const T3DAnim* clip = current_clip(&player);
+        if (clip->time != last_time) advanced++;
+        last_time = clip->time;
+    }
+    CHECK(advanced == 2);
+    CHECK(animation_frame_stats()->ticks_skipped == 14);
+    CHECK_NEAR(anim->pending_time, 0.0f, 1e-6);
+
+    // A held pose reuses last frame's matrices, a culled one builds none
+    frame_alloc_begin_frame();
+    CHECK(animation_system_update_skeleton(anim, &player.skeleton));
+    frame_alloc_end_frame();
+    frame_alloc_begin_frame();
+    CHECK(animation_system_update_skeleton(anim, &player.skeleton));
+    CHECK(animation_frame_stats()->skeletons_skipped == 1);
+    frame_alloc_end_frame();
+
+    animation_system_set_lod(anim, 0.0f, false);
+    CHECK(!animation_system_update_skeleton(anim, &player.skeleton));
+    CHECK(animation_frame_stats()->lod_count[ANIM_LOD_CULLED] == 1);
+
+    animation_system_set_lod(anim, 0.0f, true);
+    CHECK(anim->lod == ANIM_LOD_FULL);
+
+    // Visibility comes from the view's frustum, here a plane facing away
+    // from the player
+    T3DViewport viewport = {0};
+    CHECK(player_in_view(&player, &viewport));
+    viewport.viewFrustum.planes[0] = (T3DVec4){{0.0f, 0.0f, -1.0f, -1000.0f}};
+    CHECK(!player_in_view(&player, &viewport));
+    player.position.z = -2000.0f;
+    CHECK(player_in_view(&player, &viewport));
+    player_cleanup(&player);
+    frame_alloc_cleanup();
+}
+
+// Mesh LOD
+
+static void test_mesh_lod_select(void) {
+    MeshLod lod = {.count = 3, .radius = 50.0f};
+
+    // Camera at the origin looking down -z, 90 degree vertical FOV
+    T3DViewport viewport = {0};
+    for (int i = 0; i < 4; i++) {
+        viewport.matCamera.m[i][i] = 1.0f;
+        viewport.matProj.m[i][i] = 1.0f;
+    }
+    T3DVec3 center = {{0.0f, 0.0f, -100.0f}};
+    CHECK_NEAR(mesh_lod_screen_size(&viewport, &center, 50.0f), 0.5f, 1e-5);
+    center.z = -10.0f;
+    CHECK_NEAR(mesh_lod_screen_size(&viewport, &center, 50.0f), 1.0f, 1e-5);
+
+    // Shrinking steps down only past each switch point's margin
+    CHECK(mesh_lod_select(&lod, 0, 1.0f) == 0);
+    CHECK(mesh_lod_select(&lod, 0, MESH_LOD_SIZE_1 * 0.95f) == 0);
+    CHECK(mesh_lod_select(&lod, 0, MESH_LOD_SIZE_1 * 0.8f) == 1);
+    CHECK(mesh_lod_select(&lod, 0, MESH_LOD_SIZE_2 * 0.5f) == 2);
+
+    // Growing back stays coarse inside the margin
+    CHECK(mesh_lod_select(&lod, 1, MESH_LOD_SIZE_1 * 1.05f) == 1);
+    CHECK(mesh_lod_select(&lod, 1, MESH_LOD_SIZE_1 * 1.2f) == 0);
+    CHECK(mesh_lod_select(&lod, 2, MESH_LOD_SIZE_2 * 1.05f) == 2);
+    CHECK(mesh_lod_select(&lod, 2, 1.0f) == 0);
+
+    // Never beyond the levels the model has
+    lod.count = 2;
+    CHECK(mesh_lod_select(&lod, 2, 0.01f) == 1);
+
+    // Skinned and unskinned draws both count towards the level's triangles
+    lod.tris[0] = 1000;
+    lod.tris[1] = 400;
+    mesh_lod_begin_frame();
+    mesh_lod_draw(&lod, 1);
+    mesh_lod_draw(&lod, 1);
+    mesh_lod_draw_skinned(&lod, 0, NULL);
+    CHECK(mesh_lod_frame_stats()->tris[0] == 1000 && mesh_lod_frame_stats()->draws[0] == 1);
+    CHECK(mesh_lod_frame_stats()->tris[1] == 800 && mesh_lod_frame_stats()->draws[1] == 2);
+}
+
+// Crowd
+
+// Every instance on a different clip frame, more than there are pose slots
+static void crowd_spawn_distinct(Crowd* crowd) {
+    static const char* const clips[] = {"Idle", "Walk", "Run", "Jump"};
+    for (int i = 0; i < CROWD_MAX_INSTANCES; i++) {
+        T3DVec3 position = {{i * 10.0f, 0.0f, -500.0f}};
+        crowd_spawn_at(crowd, NULL, &position, 0.0f, clips[i % 4]);
+        CrowdInstance* inst = &crowd->instances[i];
+        int frames = (int)(crowd->clips[inst->clip].animRef->duration * CROWD_POSE_FPS);
+        inst->time = ((i / 4) % frames + 0.5f) / CROWD_POSE_FPS;
+    }
+}
+
+static void test_crowd_pose_budget(void) {
+    static const char* const clip_names[] = {"Idle", "Walk", "Run", "Jump"};
+    T3DViewport viewport = {0};  // No frustum planes, everything is visible
+    Player player;
+    Crowd crowd;
+
+    // Full frame slot: the player and every instance fit, poses stop at what is left
+    frame_alloc_init(FRAME_ALLOC_SIZE);
+    player_init(&player);
+    crowd_init(&crowd, &player.mesh_lod, &player.skeleton, clip_names, 4);
+    crowd_spawn_distinct(&crowd);
+    CHECK(crowd.active == CROWD_MAX_INSTANCES);
+    crowd.instances[0].prev_position.x -= 20.0f;
+
+    frame_alloc_begin_frame();
+    player_update_render(&player, 0.5f);
+    crowd_prepare(&crowd, &viewport, 0.5f);
+    CHECK(crowd.pose_count > 4 && crowd.pose_count <= CROWD_MAX_POSES);
+    CHECK(crowd.visible_count == CROWD_MAX_INSTANCES);
+    CHECK(crowd.pose_skipped == 0);
+    CHECK_NEAR(crowd.instances[0].render_position.x, -10.0f, 1e-5);
+
+    // Instances draw grouped by pose, each with a pose of its own clip
+    int wrong_clip = 0, unsorted = 0;
+    for (int slot = 0; slot < crowd.visible_count; slot++) {
+        const CrowdInstance* inst = &crowd.instances[crowd.draw_order[slot]];
+        if ((int)(crowd.pose_keys[inst->pose] >> 16) != inst->clip) wrong_clip++;
+        if (slot > 0 && inst->pose < crowd.instances[crowd.draw_order[slot - 1]].pose) unsorted++;
+    }
+    CHECK(wrong_clip == 0);
+    CHECK(unsorted == 0);
+    crowd_draw(&crowd, NULL);
+    frame_alloc_end_frame();
+    frame_alloc_cleanup();
+
+    // Room for a single pose: the other clips skip the frame instead of
+    // borrowing it
+    int bone_count = player.skeleton.skeletonRef->boneCount;
+    uint32_t player_bytes = (bone_count + 1) * sizeof(T3DMat4FP);
+    uint32_t pose_bytes = bone_count * sizeof(T3DMat4FP);
+    frame_alloc_init(player_bytes + pose_bytes + CROWD_MAX_INSTANCES * sizeof(T3DMat4FP));
+    frame_alloc_begin_frame();
+    player_update_render(&player, 0.5f);
+    crowd_prepare(&crowd, &viewport, 0.5f);
+    CHECK(crowd.pose_count == 1);
+    CHECK(crowd.visible_count == CROWD_MAX_INSTANCES / 4);
+    CHECK(crowd.pose_skipped == CROWD_MAX_INSTANCES - CROWD_MAX_INSTANCES / 4);
+    for (int slot = 0; slot < crowd.visible_count; slot++) {
+        CHECK(crowd.instances[crowd.draw_order[slot]].clip == crowd.instances[0].clip);
+    }
+    frame_alloc_end_frame();
+
+    crowd_cleanup(&crowd);
+    player_cleanup(&player);
+    frame_alloc_cleanup();
+}
+
+// Lights
+
+static void test_lights_select(void) {
+    LightManager mgr;
+    lights_init(&mgr, 500.0f);
+    uint8_t torch[4] = {255, 120, 40, 255};
+    uint8_t lamp[4] = {255, 255, 255, 255};
+    for (int i = 0; i < 6; i++) {
+        lights_add(&mgr, &(T3DVec3){{i * 100.0f, 0.0f, 0.0f}}, torch, 300.0f);
+    }
+    int far = lights_add(&mgr, &(T3DVec3){{5000.0f, 0.0f, 0.0f}}, lamp, 300.0f);
+
+    // The four closest of the six in reach, in index order
+    int out[LIGHTS_PER_DRAW];
+    T3DVec3 center = {{0.0f, 0.0f, 0.0f}};
+    CHECK(lights_select(&mgr, &center, 10.0f, out) == LIGHTS_PER_DRAW);
+    for (int i = 0; i < LIGHTS_PER_DRAW; i++) CHECK(out[i] == i);
+
+    // Brighter and wider wins over closer
+    int bright = lights_add(&mgr, &(T3DVec3){{400.0f, 0.0f, 0.0f}}, lamp, 800.0f);
+    CHECK(lights_select(&mgr, &center, 10.0f, out) == LIGHTS_PER_DRAW);
+    CHECK(out[LIGHTS_PER_DRAW - 1] == bright);
+
+    // Out of reach in another grid cell, alone there
+    center.x = 5100.0f;
+    CHECK(lights_select(&mgr, &center, 10.0f, out) == 1);
+    CHECK(out[0] == far);
+    center.x = 2500.0f;
+    CHECK(lights_select(&mgr, &center, 10.0f, out) == 0);
+
+    // Draws that want the same set reuse it until a light changes
+    center.x = 0.0f;
+    lights_begin_frame(&mgr);
+    lights_apply(&mgr, &center, 10.0f);
+    lights_apply(&mgr, &(T3DVec3){{5.0f, 0.0f, 0.0f}}, 10.0f);
+    CHECK(mgr.uploads == 1 && mgr.skipped == 1);
+    lights_set_intensity(&mgr, 0, 0.5f);
+    lights_apply(&mgr, &center, 10.0f);
+    CHECK(mgr.uploads == 2);
+    lights_remove(&mgr, bright);
+    lights_apply(&mgr, &center, 10.0f);
+    CHECK(mgr.uploads == 3 && mgr.bound_count == LIGHTS_PER_DRAW);
+}
+
+// Sound effects
+
+static void test_sfx_voice_budget(void) {
+    SfxEngine sfx;
+    sfx_init(&sfx);
+    int step = sfx_sample_load(&sfx, "step", false);
+    int drip = sfx_sample_load(&sfx, "drip", true);
+    CHECK(sfx_sample_load(&sfx, "step", false) == step && sfx.sample_count == 2);
+    CHECK(sfx.samples[drip].wave.loop && strcmp(sfx.samples[drip].wave.path, "rom:/drip.wav64") == 0);
+
+    // Listener at the origin looking down -Z, so +X is to the right
+    T3DVec3 origin = {{0.0f, 0.0f, 0.0f}};
+    sfx_begin_frame(&sfx, &origin, &(T3DVec3){{0.0f, 0.0f, -100.0f}});
+    CHECK_NEAR(sfx_gain(&sfx, &(T3DVec3){{50.0f, 0.0f, 0.0f}}, 1.0f, 1000.0f, SFX_PRIORITY_ACTION), 1.0f, 1e-6);
+    CHECK_NEAR(sfx_gain(&sfx, &(T3DVec3){{550.0f, 0.0f, 0.0f}}, 1.0f, 1000.0f, SFX_PRIORITY_ACTION), 0.25f, 1e-6);
+    CHECK(sfx_gain(&sfx, &(T3DVec3){{2000.0f, 0.0f, 0.0f}}, 1.0f, 1000.0f, SFX_PRIORITY_ACTION) == 0.0f);
+
+    // Out of reach never reaches the mixer
+    CHECK(sfx_play(&sfx, step, &(T3DVec3){{5000.0f, 0.0f, 0.0f}}, 1.0f, SFX_PRIORITY_ACTION) == -1);
+    CHECK(sfx.culled == 1 && sfx.started == 0);
+
+    // Panned by side, sample shared by every voice playing it
+    int right = sfx_play(&sfx, step, &(T3DVec3){{400.0f, 0.0f, 0.0f}}, 1.0f, SFX_PRIORITY_FOOTSTEP);
+    int left = sfx_play(&sfx, step, &(T3DVec3){{-200.0f, 0.0f, 0.0f}}, 1.0f, SFX_PRIORITY_FOOTSTEP);
+    CHECK(right >= 0 && left >= 0 && right != left);
+    CHECK(host_mixer_ch_pan(SOUND_CHANNEL_SFX_FIRST + right) > 0.5f);
+    CHECK(host_mixer_ch_pan(SOUND_CHANNEL_SFX_FIRST + left) < 0.5f);
+    CHECK(host_mixer_ch_vol(SOUND_CHANNEL_SFX_FIRST + left) > host_mixer_ch_vol(SOUND_CHANNEL_SFX_FIRST + right));
+    CHECK(host_mixer_ch_wave(SOUND_CHANNEL_SFX_FIRST + left) == host_mixer_ch_wave(SOUND_CHANNEL_SFX_FIRST + right));
+
+    // Many emitters, never more voices than channels. Those out of reach
+    // don't compete at all, the rest are culled for want of a channel.
+    for (int i = 0; i < 20; i++) {
+        sfx_emitter_add(&sfx, drip, &(T3DVec3){{0.0f, 0.0f, i * -100.0f}}, 0.5f, 800.0f, SFX_PRIORITY_AMBIENT);
+    }
+    sfx_begin_frame(&sfx, &origin, &(T3DVec3){{0.0f, 0.0f, -100.0f}});
+    int playing = 0;
+    for (int i = 0; i < SFX_VOICES; i++) playing += sfx.voices[i].sample >= 0;
+    CHECK(playing == SFX_VOICES);
+    CHECK(sfx.voices[right].sample == step && sfx.voices[left].sample == step);
+    CHECK(sfx.started == SFX_VOICES - 2 && sfx.culled == 7 - (SFX_VOICES - 2));
+
+    // A higher priority sound takes the lowest ranked channel, the ambient
+    // loop; a lower one is culled
+    int ambient = sfx.emitters[0].voice;
+    int jump = sfx_play(&sfx, step, &(T3DVec3){{0.0f, 0.0f, 10.0f}}, 1.0f, SFX_PRIORITY_ACTION);
+    CHECK(ambient >= 0 && jump == ambient && sfx.stolen == 1 && sfx.emitters[0].voice < 0);
+    CHECK(sfx_play(&sfx, drip, &(T3DVec3){{0.0f, 0.0f, 10.0f}}, 1.0f, SFX_PRIORITY_AMBIENT) == -1);
+
+    // Finished one-shots free their channel for the nearest emitter
+    host_mixer_ch_finish(SOUND_CHANNEL_SFX_FIRST + jump);
+    host_mixer_ch_finish(SOUND_CHANNEL_SFX_FIRST + left);
+    host_mixer_ch_finish(SOUND_CHANNEL_SFX_FIRST + right);
+    sfx_begin_frame(&sfx, &origin, &(T3DVec3){{0.0f, 0.0f, -100.0f}});
+    for (int i = 0; i < SFX_VOICES; i++) CHECK(sfx.voices[i].sample == drip);
+    CHECK(sfx.emitters[0].voice >= 0 && sfx.emitters[1].voice >= 0 && sfx.emitters[19].voice < 0);
+
+    // Walking away stops emitters out of reach
+    sfx_begin_frame(&sfx, &(T3DVec3){{0.0f, 0.0f, 5000.0f}}, &origin);
+    for (int i = 0; i < SFX_VOICES; i++) CHECK(sfx.voices[i].sample < 0);
+    sfx_cleanup(&sfx);
+}
+
+// Level loading
+
+static void test_level_load_in_place(void) {
+    Level level;
+    level_load(&level, "rom:/tunnel2.level");
+    CHECK(level.header->camera_distance == 200.0f && level.header->camera_height == 200.0f);
+    CHECK(level.header->ambient[0] == 40 && level.header->ambient[1] == 35 && level.header->ambient[2] == 25);
+    CHECK_NEAR(level.header->directional[0].direction.y, -0.8f / sqrtf(0.98f), 1e-5);
+
+    const LevelEntity* spawn = level_find_entity(&level, LEVEL_ENTITY_SPAWN);
+    CHECK(spawn != NULL);
+    CHECK_NEAR(spawn->yaw, M_PI * 1.5f, 1e-5);
+    const LevelEntity* npc = level_find_entity(&level, LEVEL_ENTITY_NPC);
+    CHECK(npc != NULL && npc->position.x == -160.0f && npc->name[0] != '\0');
+
+    CHECK(level.light_count == 32);
+    CHECK(level.lights[0].position.x == 300.0f && level.lights[0].radius == 520.0f);
+    CHECK(level.lights[0].color[0] == 255 && level.lights[0].color[3] == 0xFF);
+    CHECK(level.segments == NULL);
+
+    // The embedded grid answers like the standalone file
+    CollisionWorld embedded, standalone;
+    collision_init_in_place(&embedded, level.collision);
+    collision_init(&standalone, "rom:/tunnel2.col");
+    float y0 = 0.0f, y1 = 0.0f;
+    CHECK(collision_ground_height(&embedded, 0.0f, 0.0f, 100.0f, &y0));
+    CHECK(collision_ground_height(&standalone, 0.0f, 0.0f, 100.0f, &y1));
+    CHECK(y0 == y1);
+    collision_cleanup(&standalone);
+    collision_cleanup(&embedded);
+    level_cleanup(&level);
+}
+
+// Scene arena
+
+static void test_scene_arena(void) {
+    const SceneArena* arena = scene_arena_get();
+    uint32_t start = arena->cached.offset;
+
+    // Starts aligned, the gap before the next one counts as padding
+    uint8_t* a = scene_alloc(10);
+    uint8_t* b = scene_alloc(32);
+    CHECK(((uintptr_t)a % SCENE_ARENA_ALIGN) == 0 && ((uintptr_t)b % SCENE_ARENA_ALIGN) == 0);
+    CHECK(b == a + SCENE_ARENA_ALIGN);
+    CHECK(arena->cached.padding >= SCENE_ARENA_ALIGN - 10);
+    CHECK(arena->cached.peak >= start + SCENE_ARENA_ALIGN + 32);
+
+    uint8_t* u = scene_alloc_uncached(64);
+    CHECK(u != NULL && arena->uncached.offset == 64);
+
+    // The next scene gets the same memory back, all of it at once
+    scene_arena_end();
+    CHECK(arena->cached.offset == 0 && arena->uncached.offset == 0 && arena->scene == NULL);
+    scene_arena_begin("next");
+    CHECK(scene_alloc(16) == a - start);
+
+    // A scene that loads files and frees them all again leaks nothing
+    scene_arena_end();
+    scene_arena_begin("clean");
+    Player player;
+    player_init(&player);
+    player_cleanup(&player);
+    scene_arena_end();
+    CHECK(arena->heap_leaked == 0);
+
+    // Heap memory a scene doesn't free is reported at its end
+    scene_arena_begin("leaky");
+    void* volatile leak = malloc(4096);
+    scene_arena_end();
+    CHECK(arena->heap_leaked >= 4096);
+    free(leak);
+    scene_arena_begin("after");
+}
+
+// Replay
+
+static void test_replay_round_trip(void) {
+    // Idle, a long hold past the 127 tick repeat limit, a tap, everything
+    // changing at once, then exactly one full repeat
+    joypad_inputs_t ticks[700];
+    int count = 0;
+    for (int i = 0; i < 5; i++) ticks[count++] = stick(0, 0);
+    for (int i = 0; i < 300; i++) ticks[count++] = stick(40, 0);
+    joypad_inputs_t tap = stick(40, 0);
+    tap.btn.a = 1;
+    ticks[count++] = tap;
+    joypad_inputs_t all = {.btn.raw = 0xA55A, .stick_x = -128, .stick_y = 127, .cstick_x = -3,
+                           .cstick_y = 5, .analog_l = 200, .analog_r = 255};
+    for (int i = 0; i < 128; i++) ticks[count++] = all;
+    for (int i = 0; i < 250; i++) ticks[count++] = stick(-7, 9);
+
+    static uint8_t buffer[512];
+    InputReplay rec = {.data = buffer, .capacity = sizeof(buffer), .offset = sizeof(ReplayHeader)};
+    int refused = 0;
+    for (int i = 0; i < count; i++) {
+        if (!replay_encode(&rec, ticks[i])) refused++;
+    }
+    replay_encode_end(&rec);
+    CHECK(refused == 0);
+    CHECK(rec.ticks == (uint32_t)count);
+    CHECK(rec.offset - sizeof(ReplayHeader) < 32);
+
+    InputReplay play = {.data = buffer, .capacity = rec.offset, .offset = sizeof(ReplayHeader)};
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        joypad_inputs_t in = replay_decode(&play);
+        if (memcmp(&in, &ticks[i], sizeof(in)) != 0) mismatches++;
+    }
+    CHECK(mismatches == 0);
+    CHECK(play.offset == rec.offset && play.pending_repeat == 0);
+
+    // A full buffer refuses the tick instead of writing past the end
+    InputReplay full = {.data = buffer, .capacity = sizeof(ReplayHeader) + 9, .offset = sizeof(ReplayHeader)};
+    CHECK(!replay_encode(&full, all));
+    CHECK(full.offset == sizeof(ReplayHeader) && full.ticks == 0);
+}
+
+// Timestep and per-frame data
+
+static void test_timestep_catch_up_cap(void) {
+    FixedTimestep ts;
+    host_set_ticks(1000);
+    timestep_init(&ts);
+
+    host_advance_ticks(ts.tick_length * 2 + ts.tick_length / 4);
+    CHECK(timestep_begin_frame(&ts) == 2);
+    CHECK_NEAR(timestep_alpha(&ts), 0.25f, 1e-3);
+
+    host_advance_ticks(ts.tick_length * 10);
+    CHECK(timestep_begin_frame(&ts) == SIM_MAX_TICKS_PER_FRAME);
+    CHECK(ts.dropped_ticks == 10 - SIM_MAX_TICKS_PER_FRAME);
+    CHECK(timestep_alpha(&ts) >= 0.0f && timestep_alpha(&ts) < 1.0f);
+}
+
+static void test_render_uses_frame_memory(void) {
+    frame_alloc_init(FRAME_ALLOC_SIZE);
+    Player player;
+    player_init(&player);
+
+    T3DMat4FP* previous = NULL;
+    for (int frame = 0; frame < DISPLAY_BUFFER_COUNT + 1; frame++) {
+        frame_alloc_begin_frame();
+        player_update(&player, NO_BUTTONS, stick(0, 127), false);
+        player_update_render(&player, 0.5f);
+        CHECK(player.skeleton.boneMatricesFP != previous);
+        CHECK(player.skeleton.boneMatricesFP != player.skeleton_owned_mats);
+        previous = player.skeleton.boneMatricesFP;
+        frame_alloc_end_frame();
+    }
+
+    // Cleanup must hand t3d back its own matrices, not the frame memory
+    player_cleanup(&player);
+    frame_alloc_cleanup();
+}
+
+int main(void) {
+    scene_arena_init(SCENE_ARENA_SIZE, SCENE_ARENA_UNCACHED_SIZE);
+    RUN_TEST(test_controls_stick);
+    RUN_TEST(test_controls_dpad_fallback);
+    RUN_TEST(test_controls_buttons);
+    RUN_TEST(test_player_walks_forward);
+    RUN_TEST(test_player_runs_faster);
+    RUN_TEST(test_player_turns);
+    RUN_TEST(test_player_late_turn);
+    RUN_TEST(test_jump_arc);
+    RUN_TEST(test_jump_needs_release);
+    RUN_TEST(test_anim_idle_walk_idle);
+    RUN_TEST(test_anim_run);
+    RUN_TEST(test_anim_jump_returns_to_idle);
+    RUN_TEST(test_anim_graph_shared);
+    RUN_TEST(test_anim_cross_fade_budget);
+    RUN_TEST(test_anim_lod);
+    RUN_TEST(test_mesh_lod_select);
+    RUN_TEST(test_crowd_pose_budget);
+    RUN_TEST(test_lights_select);
+    RUN_TEST(test_sfx_voice_budget);
+    RUN_TEST(test_level_load_in_place);
+    RUN_TEST(test_scene_arena);
+    RUN_TEST(test_replay_round_trip);
+    RUN_TEST(test_timestep_catch_up_cap);
+    RUN_TEST(test_render_uses_frame_memory);
+
+    printf("%d checks, %d failed\n", checks_run, checks_failed);
+    return checks_failed ? 1 : 0;
+}
@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+"""Reduces and quantizes skeletal animation clips before gltf_to_t3d.
+
+Per channel (one bone's translation, rotation or scale in one clip):
+  - values are quantized: rotations to normalized 16-bit components (stored
+    as normalized shorts, core glTF), translations and scales snapped to a
+    fixed step
+  - keyframes whose value linear interpolation (slerp for rotations)
+    reproduces within the bone's tolerance are removed
+  - a track that holds one value for the whole clip keeps a single key
+  - a track that never leaves the bone's rest pose in *any* clip is dropped.
+    Tracks are only dropped model-wide: the runtime leaves bones a clip
+    doesn't animate where the previous clip put them, so a bone that moves
+    in one clip has to be keyed in all of them.
+
+Tolerances are given for the whole skeleton and can be scaled per bone with
+--bone NAME=FACTOR (below 1 for bones whose error shows more, e.g. hands).
+Keys are removed by comparing the quantized, reduced track with the source
+keys, so quantization error counts towards the tolerance. The same error is
+reported after reduction. A per-clip report of keys, tracks, bytes and maximum error is
+printed and optionally written to --report.
+
+CUBICSPLINE samplers are copied unchanged.
+
+Usage: gltf_anim_compress.py [--rot-tolerance DEG] [--pos-tolerance U]
+                             [--scale-tolerance S] [--bone NAME=FACTOR]...
+                             [--report FILE] input.glb output.glb
+"""
+
+import argparse
+import math
+import sys
+
+from gltfio import COMPONENT_TYPES, FLOAT, TYPE_SIZES, Gltf
+
+SHORT = 5122
+
+ROT_STEP = 1.0 / 32767.0    # Normalized short
+
+
+# ------------------------------------------------------------------ math
+
+def quat_dot(a, b):
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]
+
+
+def quat_normalize(q):
+    length = math.sqrt(quat_dot(q, q))
+    if length < 1e-12:
+        return (0.0, 0.0, 0.0, 1.0)
+    return tuple(c / length for c in q)
+
+
+def quat_slerp(a, b, f):
+    dot = quat_dot(a, b)
+    if dot < 0.0:
+        b = tuple(-c for c in b)
+        dot = -dot
+    if dot > 0.9995:
+        return quat_normalize(tuple(a[i] + (b[i] - a[i]) * f for i in range(4)))
+    theta = math.acos(min(dot, 1.0))
+    sin_theta = math.sin(theta)
+    wa = math.sin((1.0 - f) * theta) / sin_theta
+    wb = math.sin(f * theta) / sin_theta
+    return tuple(a[i] * wa + b[i] * wb for i in range(4))
+
+
+def quat_angle(a, b):
+    """Rotation between two quaternions, in degrees."""
+    # atan2 of the half-chord stays accurate for tiny angles, where acos of
+    # a dot product near 1 does not; quantized keys are not quite unit length
+    a, b = quat_normalize(a), quat_normalize(b)
+    if quat_dot(a, b) < 0.0:
+        b = tuple(-c for c in b)
+    diff = math.sqrt(sum((a[i] - b[i]) ** 2 for i in range(4)))
+    total = math.sqrt(sum((a[i] + b[i]) ** 2 for i in range(4)))
+    return math.degrees(4.0 * math.atan2(diff, total))
+
+
+def vec_lerp(a, b, f):
+    return tuple(a[i] + (b[i] - a[i]) * f for i in range(len(a)))
+
+
+def vec_dist(a, b):
+    return math.sqrt(sum((a[i] - b[i]) ** 2 for i in range(len(a))))
+
+
+# --------------------------------------------------------------- tracks
+
+class Track:
+    """One animation channel's keys, with the metric its path uses."""
+
+    def __init__(self, path, times, values, tolerance):
+        self.path = path
+        self.times = times
+        self.values = values
+        self.tolerance = tolerance
+
+    def interpolate(self, a, b, f):
+        if self.path == "rotation":
+            return quat_slerp(a, b, f)
+        return vec_lerp(a, b, f)
+
+    def error(self, a, b):
+        if self.path == "rotation":
+            return quat_angle(a, b)
+        return vec_dist(a, b)
+
+    def sample(self, keys, t):
+        """Value of the reduced track made of key indices `keys` at time t."""
+        if t <= self.times[keys[0]]:
+            return self.values[keys[0]]
+        for k in range(1, len(keys)):
+            t1 = self.times[keys[k]]
+            if t <= t1:
+                t0 = self.times[keys[k - 1]]
+                f = (t - t0) / (t1 - t0) if t1 > t0 else 0.0
+                return self.interpolate(self.values[keys[k - 1]], self.values[keys[k]], f)
+        return self.values[keys[-1]]
+
+
+def quantize(track, pos_step, scale_step):
+    if track.path == "rotation":
+        out, prev = [], None
+        for q in track.values:
+            q = quat_normalize(q)
+            # Keep neighbours in the same hemisphere so interpolation takes the short arc
+            if prev is not None and quat_dot(prev, q) < 0.0:
+                q = tuple(-c for c in q)
+            q = tuple(round(c / ROT_STEP) * ROT_STEP for c in q)
+            out.append(q)
+            prev = q
+        track.values = out
+    else:
+        step = pos_step if track.path == "translation" else scale_step
+        track.values = [tuple(round(c / step) * step for c in v) for v in track.values]
+
+
+def reduce_keys(track, source):
+    """Returns the indices of the keys to keep, first and last always kept.
+
+    Interpolated quantized keys are compared with the source values, not
+    the quantized ones, so the quantization error is part of the budget.
+    """
+    count = len(track.values)
+    if count <= 2:
+        return list(range(count))
+
+    keep = [False] * count
+    keep[0] = keep[-1] = True
+    stack = [(0, count - 1)]
+    while stack:
+        i0, i1 = stack.pop()
+        if i1 - i0 < 2:
+            continue
+        t0, t1 = track.times[i0], track.times[i1]
+        worst, worst_index = -1.0, -1
+        for i in range(i0 + 1, i1):
+            f = (track.times[i] - t0) / (t1 - t0) if t1 > t0 else 0.0
+            err = track.error(track.interpolate(track.values[i0], track.values[i1], f), source.values[i])
+            if err > worst:
+                worst, worst_index = err, i
+        if worst > track.tolerance:
+            keep[worst_index] = True
+            stack.append((i0, worst_index))
+            stack.append((worst_index, i1))
+    return [i for i in range(count) if keep[i]]
+
+
+def reduce_step_keys(track, source):
+    # STEP tracks only change at keys, so repeated values add nothing
+    keys = [0]
+    for i in range(1, len(track.values)):
+        if track.error(track.values[keys[-1]], source.values[i]) > track.tolerance:
+            keys.append(i)
+    return keys
+
+
+def is_constant(track, value):
+    return all(track.error(v, value) <= track.tolerance for v in track.values)
+
+
+# ------------------------------------------------------------------ main
+
+def accessor_bytes(gltf, index):
+    acc = gltf.doc["accessors"][index]
+    return acc["count"] * TYPE_SIZES[acc["type"]] * COMPONENT_TYPES[acc["componentType"]][1]
+
+
+def rest_value(node, path):
+    if path == "translation":
+        return tuple(node.get("translation", [0.0, 0.0, 0.0]))
+    if path == "rotation":
+        return tuple(node.get("rotation", [0.0, 0.0, 0.0, 1.0]))
+    return tuple(node.get("scale", [1.0, 1.0, 1.0]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--rot-tolerance", type=float, default=0.5, help="max rotation error in degrees")
+    parser.add_argument("--pos-tolerance", type=float, default=0.002, help="max translation error in glTF units")
+    parser.add_argument("--scale-tolerance", type=float, default=0.002, help="max scale error")
+    parser.add_argument("--pos-step", type=float, default=1.0 / 4096, help="translation quantization step")
+    parser.add_argument("--scale-step", type=float, default=1.0 / 4096, help="scale quantization step")
+    parser.add_argument("--bone", action="append", default=[], metavar="NAME=FACTOR",
+                        help="scale the tolerances of one bone")
+    parser.add_argument("--report", help="write the per-clip report to this file")
+    parser.add_argument("input")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    bone_factor = {}
+    for spec in args.bone:
+        name, _, factor = spec.partition("=")
+        try:
+            bone_factor[name] = float(factor)
+        except ValueError:
+            sys.exit("gltf_anim_compress: bad --bone '%s', expected NAME=FACTOR" % spec)
+
+    gltf = Gltf.load(args.input)
+    doc = gltf.doc
+    nodes = doc.get("nodes", [])
+    tolerances = {"translation": args.pos_tolerance, "rotation": args.rot_tolerance, "scale": args.scale_tolerance}
+
+    # Read and quantize every reducible channel, then find the tracks that
+    # stay at the rest pose in every clip
+    tracks = {}          # (anim, channel) -> Track
+    moves = set()        # (node, path) animated away from rest somewhere
+    for a, anim in enumerate(doc.get("animations", [])):
+        for c, channel in enumerate(anim["channels"]):
+            target = channel["target"]
+            sampler = anim["samplers"][channel["sampler"]]
+            interp = sampler.get("interpolation", "LINEAR")
+            if "node" not in target or target["path"] not in tolerances or interp == "CUBICSPLINE":
+                if "node" in target:
+                    moves.add((target["node"], target["path"]))
+                continue
+
+            name = nodes[target["node"]].get("name", "")
+            tolerance = tolerances[target["path"]] * bone_factor.get(name, 1.0)
+            times = [e[0] for e in gltf.read_accessor(sampler["input"])]
+            values = [tuple(e) for e in gltf.read_accessor(sampler["output"])]
+            track = Track(target["path"], times, values, tolerance)
+            source = Track(target["path"], times, list(values), tolerance)
+            if target["path"] == "rotation":
+                source.values = [quat_normalize(q) for q in values]
+            quantize(track, args.pos_step, args.scale_step)
+            tracks[(a, c)] = (track, source, interp)
+
+            if not is_constant(source, rest_value(nodes[target["node"]], target["path"])):
+                moves.add((target["node"], target["path"]))
+
+    report = []
+    totals = [0, 0, 0, 0, 0, 0]
+    for a, anim in enumerate(doc.get("animations", [])):
+        bytes_before = sum(accessor_bytes(gltf, i) for i in
+                           set(s["input"] for s in anim["samplers"]) | set(s["output"] for s in anim["samplers"]))
+        keys_before = keys_after = 0
+        tracks_before = len(anim["channels"])
+        max_rot = max_pos = max_scale = 0.0
+
+        channels, samplers = [], []
+        for c, channel in enumerate(anim["channels"]):
+            sampler = anim["samplers"][channel["sampler"]]
+            if (a, c) not in tracks:
+                # Copied as is
+                channels.append(dict(channel, sampler=len(samplers)))
+                samplers.append(dict(sampler))
+                count = doc["accessors"][sampler["input"]]["count"]
+                keys_before += count
+                keys_after += count
+                continue
+
+            track, source, interp = tracks[(a, c)]
+            target = channel["target"]
+            keys_before += len(track.values)
+            if (target["node"], target["path"]) not in moves:
+                continue
+
+            if is_constant(source, track.values[0]):
+                keys = [0]
+            elif interp == "STEP":
+                keys = reduce_step_keys(track, source)
+            else:
+                keys = reduce_keys(track, source)
+            keys_after += len(keys)
+
+            # Error of what is written against the original source keys
+            for i, t in enumerate(source.times):
+                err = track.error(track.sample(keys, t), source.values[i]) if interp != "STEP" else \
+                    track.error(track.values[max(k for k in keys if k <= i)], source.values[i])
+                if track.path == "rotation":
+                    max_rot = max(max_rot, err)
+                elif track.path == "translation":
+                    max_pos = max(max_pos, err)
+                else:
+                    max_scale = max(max_scale, err)
+
+            new_sampler = {"interpolation": interp}
+            new_sampler["input"] = gltf.add_accessor([(track.times[k],) for k in keys], FLOAT, "SCALAR", minmax=True)
+            values = [track.values[k] for k in keys]
+            if track.path == "rotation":
+                new_sampler["output"] = gltf.add_accessor(values, SHORT, "VEC4", normalized=True)
+            else:
+                new_sampler["output"] = gltf.add_accessor(values, FLOAT, "VEC3")
+            channels.append(dict(channel, sampler=len(samplers)))
+            samplers.append(new_sampler)
+
+        anim["channels"] = channels
+        anim["samplers"] = samplers
+        bytes_after = sum(accessor_bytes(gltf, i) for i in
+                          set(s["input"] for s in samplers) | set(s["output"] for s in samplers))
+
+        report.append("%-24s keys %6d -> %6d  tracks %4d -> %4d  bytes %8d -> %8d  "
+                      "max err %.3f deg %.4f pos %.4f scale" %
+                      (anim.get("name", "anim%d" % a), keys_before, keys_after, tracks_before, len(channels),
+                       bytes_before, bytes_after, max_rot, max_pos, max_scale))
+        for i, v in enumerate((keys_before, keys_after, tracks_before, len(channels), bytes_before, bytes_after)):
+            totals[i] += v
+
+    saved = totals[4] - totals[5]
+    report.append("%-24s keys %6d -> %6d  tracks %4d -> %4d  bytes %8d -> %8d  (%d saved, %.0f%%)" %
+                  ("total", totals[0], totals[1], totals[2], totals[3], totals[4], totals[5],
+                   saved, 100.0 * saved / totals[4] if totals[4] else 0.0))
+
+    # glTF needs at least one channel per animation
+    doc["animations"] = [anim for anim in doc.get("animations", []) if anim["channels"]]
+    if not doc["animations"]:
+        del doc["animations"]
+
+    gltf.compact()
+    gltf.save(args.output)
+
+    for line in report:
+        print("gltf_anim_compress: " + line)
+    if args.report:
+        with open(args.report, "w") as f:
+            f.write("\n".join(report) + "\n")
+
+
+if __name__ == "__main__":
+    main()
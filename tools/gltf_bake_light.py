@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Bakes static lighting into the vertex colours of level geometry.
+
+Lights come from a text descriptor, one per line ('#' starts a comment):
+
+    ambient R G B
+    directional R G B DX DY DZ
+    point R G B X Y Z RADIUS
+
+Colours are 0-255. Directions use the runtime's convention
+(t3d_light_set_directional: the vector points towards the light) and
+positions/radii are in t3d world units, i.e. glTF units times
+--base-scale. Directional and point lights are lit like tiny3d does per
+vertex: colour times max(0, N.L), points with a quadratic falloff to zero
+at RADIUS. Unlike the RSP there is no limit on the number of lights.
+
+The lit result multiplies the existing COLOR_0 (white if there is none),
+so the level can be drawn with lighting off. Skinned meshes are skipped.
+
+Usage: gltf_bake_light.py --lights FILE [--base-scale S] input.glb output.glb
+"""
+
+import argparse
+import math
+import sys
+
+from gltfio import FLOAT, TARGET_ARRAY_BUFFER, Gltf, normalize, transform_normal, transform_point
+
+
+def parse_lights(path):
+    lights = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            words = line.split("#", 1)[0].split()
+            if not words:
+                continue
+            kind, args = words[0], words[1:]
+            expected = {"ambient": 3, "directional": 6, "point": 7}.get(kind)
+            if expected is None or len(args) != expected:
+                sys.exit("gltf_bake_light: %s:%d: bad light '%s'" % (path, number, line.strip()))
+            try:
+                values = [float(a) for a in args]
+            except ValueError:
+                sys.exit("gltf_bake_light: %s:%d: bad number in '%s'" % (path, number, line.strip()))
+            color = tuple(c / 255.0 for c in values[:3])
+            if kind == "ambient":
+                lights.append(("ambient", color))
+            elif kind == "directional":
+                lights.append(("directional", color, normalize(values[3:6])))
+            else:
+                lights.append(("point", color, tuple(values[3:6]), values[6]))
+    return lights
+
+
+def light_vertex(lights, pos, normal):
+    r = g = b = 0.0
+    for light in lights:
+        kind, color = light[0], light[1]
+        if kind == "ambient":
+            f = 1.0
+        elif kind == "directional":
+            f = max(0.0, sum(normal[i] * light[2][i] for i in range(3)))
+        else:
+            to_light = tuple(light[2][i] - pos[i] for i in range(3))
+            dist = math.sqrt(sum(c * c for c in to_light))
+            if dist >= light[3]:
+                continue
+            if dist > 1e-6:
+                f = max(0.0, sum(normal[i] * to_light[i] for i in range(3)) / dist)
+            else:
+                f = 1.0
+            f *= (1.0 - dist / light[3]) ** 2
+        r += color[0] * f
+        g += color[1] * f
+        b += color[2] * f
+    return (min(r, 1.0), min(g, 1.0), min(b, 1.0))
+
+
+def bake(gltf, lights, base_scale):
+    doc = gltf.doc
+    baked = set()
+    vertices = 0
+    for node_index, world in gltf.scene_nodes():
+        node = doc["nodes"][node_index]
+        if "mesh" not in node or "skin" in node:
+            continue
+        if node["mesh"] in baked:
+            print("gltf_bake_light: mesh %d is instanced, baked for its first node only" % node["mesh"])
+            continue
+        baked.add(node["mesh"])
+
+        for prim in doc["meshes"][node["mesh"]]["primitives"]:
+            attrs = prim["attributes"]
+            if "NORMAL" not in attrs:
+                continue
+            positions = [tuple(c * base_scale for c in transform_point(world, p))
+                         for p in gltf.read_accessor(attrs["POSITION"])]
+            normals = [transform_normal(world, n) for n in gltf.read_accessor(attrs["NORMAL"])]
+            if "COLOR_0" in attrs:
+                colors = gltf.read_accessor(attrs["COLOR_0"])
+            else:
+                colors = [(1.0, 1.0, 1.0, 1.0)] * len(positions)
+
+            out = []
+            for pos, normal, color in zip(positions, normals, colors):
+                lit = light_vertex(lights, pos, normal)
+                alpha = color[3] if len(color) > 3 else 1.0
+                out.append((color[0] * lit[0], color[1] * lit[1], color[2] * lit[2], alpha))
+            attrs["COLOR_0"] = gltf.add_accessor(out, FLOAT, "VEC4", TARGET_ARRAY_BUFFER)
+            vertices += len(out)
+    return vertices
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--lights", required=True, help="light descriptor")
+    parser.add_argument("--base-scale", type=float, default=64.0, help="gltf_to_t3d base scale")
+    parser.add_argument("input")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    lights = parse_lights(args.lights)
+    gltf = Gltf.load(args.input)
+    vertices = bake(gltf, lights, args.base_scale)
+    gltf.compact()
+    gltf.save(args.output)
+    print("gltf_bake_light: %d lights baked into %d vertices" % (len(lights), vertices))
+
+
+if __name__ == "__main__":
+    main()
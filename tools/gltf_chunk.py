@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""Splits static level geometry into spatial chunks before gltf_to_t3d.
+
+Every triangle of the default scene is assigned to a square XZ grid cell by
+its centroid. Each non-empty cell becomes one node/mesh ("chunk_X_Z") with a
+primitive per material, so the converter emits one object per chunk and
+material, each with its own bounding box for the BVH (--bvh).
+
+With --segments N the level is additionally cut into N streaming segments
+along its longest horizontal axis, balanced by triangle count. Each segment
+is written to OUTPUT_seg<i>.glb and a big-endian manifest describing the
+segments (see code/level_stream.h) is written to --manifest.
+
+Usage: gltf_chunk.py [--cell-size N] input.glb output.glb
+       gltf_chunk.py --segments N --manifest out.segs input.glb output_prefix
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+
+from gltfio import TARGET_ARRAY_BUFFER, Gltf, transform_normal, transform_point
+
+MANIFEST_MAGIC = b"SEGS"
+MANIFEST_VERSION = 1
+MANIFEST_PATH_LEN = 32
+
+
+def collect_triangles(gltf):
+    """Returns [(attrs, a, b, c, material, attr_names, centroid), ...] in world space."""
+    tris = []
+    doc = gltf.doc
+
+    for node_index, world in gltf.scene_nodes():
+        node = doc["nodes"][node_index]
+        if "mesh" not in node:
+            continue
+        if "skin" in node:
+            sys.exit("gltf_chunk: skinned mesh '%s' can't be chunked" % node.get("name", node_index))
+
+        for prim in doc["meshes"][node["mesh"]]["primitives"]:
+            if prim.get("mode", 4) != 4:
+                continue
+
+            attrs = {}
+            for name, acc in prim["attributes"].items():
+                values = gltf.read_accessor(acc)
+                if name == "POSITION":
+                    values = [transform_point(world, v) for v in values]
+                elif name == "NORMAL":
+                    values = [transform_normal(world, v) for v in values]
+                attrs[name] = (values, acc)
+
+            positions = attrs["POSITION"][0]
+            indices = gltf.primitive_indices(prim)
+            key_attrs = tuple(sorted(attrs))
+            material = prim.get("material", -1)
+
+            for t in range(0, len(indices) - 2, 3):
+                a, b, c = indices[t], indices[t + 1], indices[t + 2]
+                centroid = tuple((positions[a][i] + positions[b][i] + positions[c][i]) / 3.0 for i in range(3))
+                tris.append((attrs, a, b, c, material, key_attrs, centroid))
+
+    return tris
+
+
+def bucket_by_cell(tris, cell_size):
+    """Returns {(cx, cz, material, attr_names): [(attrs, a, b, c), ...]}."""
+    buckets = {}
+    for attrs, a, b, c, material, key_attrs, centroid in tris:
+        cell = (int(math.floor(centroid[0] / cell_size)), int(math.floor(centroid[2] / cell_size)))
+        key = (cell[0], cell[1], material, key_attrs)
+        buckets.setdefault(key, []).append((attrs, a, b, c))
+    return buckets
+
+
+def build_primitive(gltf, material, tris):
+    """Re-indexes the triangles of one bucket into a fresh primitive."""
+    remap = {}
+    streams = {}
+    templates = {}
+    indices = []
+
+    for attrs, a, b, c in tris:
+        for v in (a, b, c):
+            key = (id(attrs), v)
+            if key not in remap:
+                remap[key] = len(remap)
+                for name, (values, acc) in attrs.items():
+                    streams.setdefault(name, []).append(values[v])
+                    templates.setdefault(name, acc)
+            indices.append(remap[key])
+
+    prim = {"attributes": {}, "indices": gltf.add_indices(indices), "mode": 4}
+    for name, values in streams.items():
+        prim["attributes"][name] = gltf.add_like(values, templates[name], TARGET_ARRAY_BUFFER)
+        acc = gltf.doc["accessors"][prim["attributes"][name]]
+        if name == "POSITION" and "min" not in acc:
+            # Bounds are mandatory for positions
+            acc["min"] = [min(v[i] for v in values) for i in range(3)]
+            acc["max"] = [max(v[i] for v in values) for i in range(3)]
+    if material >= 0:
+        prim["material"] = material
+    return prim
+
+
+def write_chunked(source_path, tris, cell_size, output):
+    """Writes one glTF with the given triangles grouped into chunk meshes."""
+    # Reload so every output starts from the untouched materials and buffers
+    gltf = Gltf.load(source_path)
+    buckets = bucket_by_cell(tris, cell_size)
+
+    cells = {}
+    for key in sorted(buckets, key=lambda k: (k[0], k[1], k[2])):
+        cells.setdefault((key[0], key[1]), []).append(key)
+
+    meshes, nodes = [], []
+    for (cx, cz), keys in sorted(cells.items()):
+        name = "chunk_%d_%d" % (cx, cz)
+        prims = [build_primitive(gltf, key[2], buckets[key]) for key in keys]
+        meshes.append({"name": name, "primitives": prims})
+        nodes.append({"name": name, "mesh": len(meshes) - 1})
+
+    doc = gltf.doc
+    doc["meshes"] = meshes
+    doc["nodes"] = nodes
+    doc["scenes"] = [{"name": "Chunks", "nodes": list(range(len(nodes)))}]
+    doc["scene"] = 0
+    doc.pop("skins", None)
+    doc.pop("animations", None)
+    gltf.compact()
+    gltf.save(output)
+    return len(nodes)
+
+
+def split_segments(tris, count):
+    """Cuts the level along its longest XZ axis into `count` equal-triangle slices."""
+    xs = [t[6][0] for t in tris]
+    zs = [t[6][2] for t in tris]
+    axis = (1.0, 0.0) if (max(xs) - min(xs)) >= (max(zs) - min(zs)) else (0.0, 1.0)
+
+    def along(p):
+        return p[0] * axis[0] + p[2] * axis[1]
+
+    ordered = sorted(tris, key=lambda t: along(t[6]))
+    segments = []
+    for i in range(count):
+        start = len(ordered) * i // count
+        end = len(ordered) * (i + 1) // count
+        segments.append(ordered[start:end])
+    return axis, along, segments
+
+
+def segment_bounds(tris, along, scale):
+    """World-space (t3d units) AABB and axis range covering every vertex."""
+    lo = [float("inf")] * 3
+    hi = [float("-inf")] * 3
+    rmin, rmax = float("inf"), float("-inf")
+    for attrs, a, b, c, _, _, _ in tris:
+        positions = attrs["POSITION"][0]
+        for v in (a, b, c):
+            p = positions[v]
+            for i in range(3):
+                lo[i] = min(lo[i], p[i] * scale)
+                hi[i] = max(hi[i], p[i] * scale)
+            rmin = min(rmin, along(p) * scale)
+            rmax = max(rmax, along(p) * scale)
+    return lo, hi, rmin, rmax
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cell-size", type=float, default=16.0, help="chunk edge length in glTF units")
+    parser.add_argument("--segments", type=int, default=0, help="number of streaming segments")
+    parser.add_argument("--manifest", help="segment manifest output (with --segments)")
+    parser.add_argument("--base-scale", type=float, default=64.0, help="gltf_to_t3d base scale, for manifest bounds")
+    parser.add_argument("input")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    tris = collect_triangles(Gltf.load(args.input))
+
+    if args.segments <= 0:
+        chunks = write_chunked(args.input, tris, args.cell_size, args.output)
+        print("gltf_chunk: %d triangles in %d chunks (cell %.1f)" % (len(tris), chunks, args.cell_size))
+        return
+
+    if not args.manifest:
+        sys.exit("gltf_chunk: --segments needs --manifest")
+
+    axis, along, segments = split_segments(tris, args.segments)
+    rom_prefix = "rom:/" + os.path.basename(args.output)
+
+    manifest = bytearray()
+    manifest += MANIFEST_MAGIC
+    manifest += struct.pack(">II", MANIFEST_VERSION, len(segments))
+    manifest += struct.pack(">ff", axis[0], axis[1])
+
+    for i, seg_tris in enumerate(segments):
+        chunks = write_chunked(args.input, seg_tris, args.cell_size, "%s_seg%d.glb" % (args.output, i))
+        lo, hi, rmin, rmax = segment_bounds(seg_tris, along, args.base_scale)
+
+        path = ("%s_seg%d.t3dm" % (rom_prefix, i)).encode("ascii")
+        if len(path) >= MANIFEST_PATH_LEN:
+            sys.exit("gltf_chunk: segment path '%s' too long" % path.decode())
+
+        manifest += struct.pack(">ff", rmin, rmax)
+        manifest += struct.pack(">6f", *(lo + hi))
+        manifest += path.ljust(MANIFEST_PATH_LEN, b"\0")
+        print("gltf_chunk: segment %d: %d triangles in %d chunks, range %.0f..%.0f" %
+              (i, len(seg_tris), chunks, rmin, rmax))
+
+    with open(args.manifest, "wb") as f:
+        f.write(manifest)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Bakes the static collision mesh of a level into a uniform XZ grid.
+
+Triangles come from nodes whose name ends in "_col" when the scene has any,
+otherwise from every mesh of the default scene. The mesh is simplified before
+baking: vertices closer than --weld are merged and the degenerate or sliver
+triangles that leaves behind are dropped.
+
+The output is big-endian so the game can use it in place (code/collision.h):
+  char magic[4] "COLL", u32 version, u32 tri_count, u32 index_count,
+  u32 grid_w, u32 grid_h, f32 cell_size, f32 origin_x, f32 origin_z
+  tri_count x { f32 v0[3], v1[3], v2[3], normal[3], d }
+  (grid_w * grid_h + 1) x u32 cell_start
+  index_count x u16 triangle index, padded to 4 bytes
+
+Usage: gltf_collision.py [--cell-size N] [--base-scale S] input.glb output.col
+"""
+
+import argparse
+import math
+import struct
+import sys
+
+from gltfio import Gltf, transform_point
+
+COLLISION_MAGIC = b"COLL"
+COLLISION_VERSION = 1
+
+
+def collect_triangles(gltf, scale):
+    """Returns world-space (t3d units) triangles as ((x, y, z) * 3) tuples."""
+    doc = gltf.doc
+    nodes = list(gltf.scene_nodes())
+    collision_only = any(doc["nodes"][i].get("name", "").endswith("_col") for i, _ in nodes)
+
+    tris = []
+    for node_index, world in nodes:
+        node = doc["nodes"][node_index]
+        if "mesh" not in node:
+            continue
+        if collision_only and not node.get("name", "").endswith("_col"):
+            continue
+
+        for prim in doc["meshes"][node["mesh"]]["primitives"]:
+            if prim.get("mode", 4) != 4:
+                continue
+            positions = [tuple(c * scale for c in transform_point(world, p))
+                         for p in gltf.read_accessor(prim["attributes"]["POSITION"])]
+            indices = gltf.primitive_indices(prim)
+            for t in range(0, len(indices) - 2, 3):
+                tris.append((positions[indices[t]], positions[indices[t + 1]], positions[indices[t + 2]]))
+    return tris
+
+
+def simplify(tris, weld, min_area):
+    """Welds nearby vertices and drops triangles that collapse."""
+    welded = {}
+
+    def snap(p):
+        key = tuple(int(round(c / weld)) for c in p)
+        return welded.setdefault(key, p)
+
+    out = []
+    for a, b, c in tris:
+        a, b, c = snap(a), snap(b), snap(c)
+        if a == b or b == c or a == c:
+            continue
+        if 0.5 * vec_len(cross(sub(b, a), sub(c, a))) < min_area:
+            continue
+        out.append((a, b, c))
+    return out
+
+
+def sub(a, b):
+    return (a[0] - b[0], a[1] - b[1], a[2] - b[2])
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def vec_len(v):
+    return math.sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2])
+
+
+def plane(tri):
+    a, b, c = tri
+    n = cross(sub(b, a), sub(c, a))
+    length = vec_len(n)
+    n = (n[0] / length, n[1] / length, n[2] / length)
+    return n, n[0] * a[0] + n[1] * a[1] + n[2] * a[2]
+
+
+def build_grid(tris, cell_size):
+    """Buckets every triangle into each cell its XZ bounds touch."""
+    min_x = min(min(p[0] for p in t) for t in tris)
+    min_z = min(min(p[2] for p in t) for t in tris)
+    max_x = max(max(p[0] for p in t) for t in tris)
+    max_z = max(max(p[2] for p in t) for t in tris)
+
+    grid_w = int(math.floor((max_x - min_x) / cell_size)) + 1
+    grid_h = int(math.floor((max_z - min_z) / cell_size)) + 1
+    cells = [[] for _ in range(grid_w * grid_h)]
+
+    for i, t in enumerate(tris):
+        x0 = int(math.floor((min(p[0] for p in t) - min_x) / cell_size))
+        x1 = int(math.floor((max(p[0] for p in t) - min_x) / cell_size))
+        z0 = int(math.floor((min(p[2] for p in t) - min_z) / cell_size))
+        z1 = int(math.floor((max(p[2] for p in t) - min_z) / cell_size))
+        for z in range(z0, z1 + 1):
+            for x in range(x0, x1 + 1):
+                cells[z * grid_w + x].append(i)
+
+    return (min_x, min_z), grid_w, grid_h, cells
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cell-size", type=float, default=128.0, help="grid cell edge in t3d units")
+    parser.add_argument("--base-scale", type=float, default=64.0, help="gltf_to_t3d base scale")
+    parser.add_argument("--weld", type=float, default=1.0, help="vertex weld distance in t3d units")
+    parser.add_argument("input")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    source = collect_triangles(Gltf.load(args.input), args.base_scale)
+    tris = simplify(source, args.weld, args.weld * args.weld * 0.5)
+    if not tris:
+        sys.exit("gltf_collision: no collision triangles in '%s'" % args.input)
+    if len(tris) > 0xFFFF:
+        sys.exit("gltf_collision: %d triangles exceed the 16-bit index range" % len(tris))
+
+    origin, grid_w, grid_h, cells = build_grid(tris, args.cell_size)
+
+    out = bytearray()
+    out += COLLISION_MAGIC
+    index_count = sum(len(c) for c in cells)
+    out += struct.pack(">5I", COLLISION_VERSION, len(tris), index_count, grid_w, grid_h)
+    out += struct.pack(">3f", args.cell_size, origin[0], origin[1])
+
+    for t in tris:
+        n, d = plane(t)
+        out += struct.pack(">13f", *(t[0] + t[1] + t[2] + n), d)
+
+    start = 0
+    for c in cells:
+        out += struct.pack(">I", start)
+        start += len(c)
+    out += struct.pack(">I", start)
+
+    for c in cells:
+        out += struct.pack(">%dH" % len(c), *c)
+    out += b"\0" * (-len(out) % 4)
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+
+    print("gltf_collision: %d -> %d triangles, %dx%d grid, %d refs, %d bytes" %
+          (len(source), len(tris), grid_w, grid_h, index_count, len(out)))
+
+
+if __name__ == "__main__":
+    main()
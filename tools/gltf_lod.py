@@ -0,0 +1,367 @@
+#!/usr/bin/env python3
+"""Generates simplified LOD meshes of a model before gltf_to_t3d.
+
+Every triangle primitive is reduced with quadric-error half-edge collapses:
+a vertex is only ever merged into one of its neighbours, never moved, so
+each surviving vertex keeps its exact position, UVs, colour and skin
+weights. The skin, skeleton and materials are carried over unchanged and
+the runtime draws every level with the full model's bone matrices.
+
+Constraints that keep the result usable:
+  - UV seams and material borders only collapse along themselves, both
+    sides together, so levels never crack where the source mesh was split;
+    vertices on open edges stay put
+  - a vertex only collapses into a neighbour influenced mainly by the same
+    joint, unless --cross-joints is given, so limbs keep bending at the
+    right place
+  - collapses that would flip or squash a triangle are skipped
+
+Each --ratio produces one level, OUTPUT_lod<N>.glb for N = 1, 2, ...,
+keeping that fraction of the source triangles (or fewer than the target
+if --max-error, relative to the model's size, stops it first).
+Animations are stripped from the levels; the full model carries them.
+
+Usage: gltf_lod.py [--ratio R]... [--max-error E] [--cross-joints]
+                   input.glb output_prefix
+"""
+
+import argparse
+import heapq
+import math
+import sys
+
+from gltfio import TARGET_ARRAY_BUFFER, Gltf
+
+FLIP_MIN_COS = 0.2          # Cosine between a triangle's old and new normal
+DEGENERATE_AREA = 1e-12
+
+
+# ------------------------------------------------------------------ math
+
+def sub(a, b):
+    return (a[0] - b[0], a[1] - b[1], a[2] - b[2])
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def dot(a, b):
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+
+
+def face_normal(p0, p1, p2):
+    """Unnormalized normal, twice the triangle's area long."""
+    return cross(sub(p1, p0), sub(p2, p0))
+
+
+def plane_quadric(p0, p1, p2):
+    """Area-weighted plane quadric as the 10 unique terms of a symmetric 4x4."""
+    n = face_normal(p0, p1, p2)
+    length = math.sqrt(dot(n, n))
+    if length < DEGENERATE_AREA:
+        return [0.0] * 10
+    a, b, c = n[0] / length, n[1] / length, n[2] / length
+    d = -(a * p0[0] + b * p0[1] + c * p0[2])
+    w = length * 0.5
+    return [w * a * a, w * a * b, w * a * c, w * a * d,
+            w * b * b, w * b * c, w * b * d,
+            w * c * c, w * c * d,
+            w * d * d]
+
+
+def quadric_add(q, r):
+    return [q[i] + r[i] for i in range(10)]
+
+
+def quadric_error(q, p):
+    x, y, z = p
+    return (q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+            + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+            + q[7] * z * z + 2 * q[8] * z
+            + q[9])
+
+
+# ---------------------------------------------------------- simplification
+
+def dominant_joint(joints, weights, v):
+    if joints is None:
+        return 0
+    best = max(range(4), key=lambda i: weights[v][i])
+    return joints[v][best]
+
+
+class Simplifier:
+    """Half-edge collapse over the triangles of one mesh.
+
+    Topology is built on welded positions, so the primitives of a mesh and
+    the sides of a UV seam form one surface. Collapsing position U into V
+    replaces every corner vertex at U with the vertex at V it shares an
+    edge-adjacent triangle with; when some corner at U has no such partner
+    the collapse would need a new vertex, and is skipped.
+    """
+
+    def __init__(self, primitives, cross_joints):
+        # primitives: [(positions, faces, joints, weights)], vertices are
+        # addressed as (primitive, index) pairs from here on
+        self.cross_joints = cross_joints
+        self.faces = []
+        self.face_prim = []
+        self.joint = {}
+        welded = {}
+        self.wid = {}
+        self.positions = []
+
+        for p, (positions, faces, joints, weights) in enumerate(primitives):
+            for i, pos in enumerate(positions):
+                key = tuple(round(c, 6) for c in pos)
+                if key not in welded:
+                    welded[key] = len(self.positions)
+                    self.positions.append(tuple(pos))
+                self.wid[(p, i)] = welded[key]
+                self.joint[(p, i)] = dominant_joint(joints, weights, i)
+            for tri in faces:
+                self.faces.append([(p, v) for v in tri])
+                self.face_prim.append(p)
+
+        count = len(self.positions)
+        self.alive = [True] * len(self.faces)
+        self.live_faces = len(self.faces)
+        self.vertex_faces = [set() for _ in range(count)]
+        self.quadrics = [[0.0] * 10 for _ in range(count)]
+        self.stamp = [0] * count
+
+        edge_uses = {}
+        for f, tri in enumerate(self.faces):
+            a, b, c = (self.wid[v] for v in tri)
+            if a == b or b == c or c == a:
+                continue
+            q = plane_quadric(self.positions[a], self.positions[b], self.positions[c])
+            for w in (a, b, c):
+                self.vertex_faces[w].add(f)
+                self.quadrics[w] = quadric_add(self.quadrics[w], q)
+            for e in ((a, b), (b, c), (c, a)):
+                key = (min(e), max(e))
+                edge_uses[key] = edge_uses.get(key, 0) + 1
+
+        # Open or non-manifold edges stay where they are
+        self.locked = [False] * count
+        for (a, b), uses in edge_uses.items():
+            if uses != 2:
+                self.locked[a] = True
+                self.locked[b] = True
+
+        self.max_cost = 0.0
+        self.heap = []
+        for a, b in edge_uses:
+            self.push(a, b)
+            self.push(b, a)
+
+    def corner(self, f, w):
+        for v in self.faces[f]:
+            if self.wid[v] == w:
+                return v
+        return None
+
+    def neighbours(self, w):
+        out = set()
+        for f in self.vertex_faces[w]:
+            out.update(self.wid[v] for v in self.faces[f])
+        out.discard(w)
+        return out
+
+    def cost(self, u, v):
+        return quadric_error(quadric_add(self.quadrics[u], self.quadrics[v]), self.positions[v])
+
+    def push(self, u, v):
+        if self.locked[u]:
+            return
+        heapq.heappush(self.heap, (self.cost(u, v), u, v, self.stamp[u], self.stamp[v]))
+
+    def plan(self, u, v):
+        """Returns the corner remapping for collapsing u into v, None if invalid."""
+        shared = self.vertex_faces[u] & self.vertex_faces[v]
+        if not shared:
+            return None
+
+        # Link condition: u and v may only share the neighbours across the
+        # edge, or the collapse pinches the surface
+        if len(self.neighbours(u) & self.neighbours(v)) != len(shared):
+            return None
+
+        remap = {}
+        for f in shared:
+            a, b = self.corner(f, u), self.corner(f, v)
+            if remap.setdefault(a, b) != b:
+                return None
+            if not self.cross_joints and self.joint[a] != self.joint[b]:
+                return None
+
+        p = self.positions
+        for f in self.vertex_faces[u] - shared:
+            if self.corner(f, u) not in remap:
+                return None
+            tri = [self.wid[x] for x in self.faces[f]]
+            old = face_normal(p[tri[0]], p[tri[1]], p[tri[2]])
+            moved = [v if x == u else x for x in tri]
+            new = face_normal(p[moved[0]], p[moved[1]], p[moved[2]])
+            new_len = math.sqrt(dot(new, new))
+            old_len = math.sqrt(dot(old, old))
+            if new_len < DEGENERATE_AREA:
+                return None
+            if old_len > DEGENERATE_AREA and dot(old, new) < FLIP_MIN_COS * old_len * new_len:
+                return None
+        return remap
+
+    def collapse(self, u, v, remap):
+        shared = self.vertex_faces[u] & self.vertex_faces[v]
+        for f in list(self.vertex_faces[u]):
+            tri = self.faces[f]
+            if f in shared:
+                self.alive[f] = False
+                self.live_faces -= 1
+                for x in tri:
+                    self.vertex_faces[self.wid[x]].discard(f)
+            else:
+                i = [self.wid[x] for x in tri].index(u)
+                tri[i] = remap[tri[i]]
+                self.vertex_faces[v].add(f)
+        self.vertex_faces[u].clear()
+        self.quadrics[v] = quadric_add(self.quadrics[v], self.quadrics[u])
+
+        ring = self.neighbours(v)
+        self.stamp[u] += 1
+        self.stamp[v] += 1
+        for n in ring:
+            self.stamp[n] += 1
+        for n in ring:
+            self.push(v, n)
+            self.push(n, v)
+            for m in self.neighbours(n):
+                if m != v:
+                    self.push(n, m)
+
+    def reduce(self, target_faces, max_cost):
+        while self.live_faces > target_faces and self.heap:
+            cost, u, v, su, sv = heapq.heappop(self.heap)
+            if su != self.stamp[u] or sv != self.stamp[v]:
+                continue
+            if cost > max_cost:
+                break
+            remap = self.plan(u, v)
+            if remap is not None:
+                self.collapse(u, v, remap)
+                self.max_cost = max(self.max_cost, cost)
+
+    def result(self, prim):
+        """Surviving triangles of one primitive, as vertex index triples."""
+        return [tuple(x[1] for x in tri) for f, tri in enumerate(self.faces)
+                if self.alive[f] and self.face_prim[f] == prim]
+
+
+# ------------------------------------------------------------------ output
+
+def model_size(gltf):
+    lo = [float("inf")] * 3
+    hi = [float("-inf")] * 3
+    for mesh in gltf.doc.get("meshes", []):
+        for prim in mesh["primitives"]:
+            acc = gltf.doc["accessors"][prim["attributes"]["POSITION"]]
+            if "min" in acc:
+                lo = [min(lo[i], acc["min"][i]) for i in range(3)]
+                hi = [max(hi[i], acc["max"][i]) for i in range(3)]
+    if lo[0] > hi[0]:
+        return 1.0
+    return math.sqrt(sum((hi[i] - lo[i]) ** 2 for i in range(3)))
+
+
+def rebuild_primitive(gltf, prim, faces):
+    """Writes the primitive's surviving triangles with only the vertices they use."""
+    remap = {}
+    indices = []
+    for tri in faces:
+        for v in tri:
+            if v not in remap:
+                remap[v] = len(remap)
+            indices.append(remap[v])
+    order = sorted(remap, key=remap.get)
+
+    attributes = {}
+    for name, acc in prim["attributes"].items():
+        values = gltf.read_accessor(acc)
+        attributes[name] = gltf.add_like([values[v] for v in order], acc, TARGET_ARRAY_BUFFER)
+        if name == "POSITION":
+            new_acc = gltf.doc["accessors"][attributes[name]]
+            kept = [values[v] for v in order]
+            new_acc["min"] = [min(p[i] for p in kept) for i in range(3)]
+            new_acc["max"] = [max(p[i] for p in kept) for i in range(3)]
+    prim["attributes"] = attributes
+    prim["indices"] = gltf.add_indices(indices)
+
+
+def write_level(source_path, ratio, max_error, cross_joints, output):
+    gltf = Gltf.load(source_path)
+    size = model_size(gltf)
+    max_cost = (max_error * size) ** 2 if max_error > 0 else float("inf")
+    before = after = 0
+    worst = 0.0
+
+    for mesh in gltf.doc.get("meshes", []):
+        prims = [p for p in mesh["primitives"] if p.get("mode", 4) == 4]
+        inputs = []
+        for prim in prims:
+            attrs = prim["attributes"]
+            indices = gltf.primitive_indices(prim)
+            inputs.append((
+                gltf.read_accessor(attrs["POSITION"]),
+                [tuple(indices[t:t + 3]) for t in range(0, len(indices) - 2, 3)],
+                gltf.read_accessor(attrs["JOINTS_0"]) if "JOINTS_0" in attrs else None,
+                gltf.read_accessor(attrs["WEIGHTS_0"]) if "WEIGHTS_0" in attrs else None,
+            ))
+
+        simplifier = Simplifier(inputs, cross_joints)
+        total = sum(len(i[1]) for i in inputs)
+        simplifier.reduce(int(math.ceil(total * ratio)), max_cost)
+        worst = max(worst, simplifier.max_cost)
+
+        for p, prim in enumerate(prims):
+            kept = simplifier.result(p)
+            if not kept:
+                kept = inputs[p][1]
+            rebuild_primitive(gltf, prim, kept)
+            before += len(inputs[p][1])
+            after += len(kept)
+
+    gltf.doc.pop("animations", None)
+    gltf.compact()
+    gltf.save(output)
+    # Quadric costs are area-weighted squared distances, so this is only a
+    # rough relative figure for comparing levels
+    return before, after, math.sqrt(worst) / size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--ratio", type=float, action="append", help="triangles kept per level (repeatable)")
+    parser.add_argument("--max-error", type=float, default=0.0,
+                        help="stop collapsing past this error, as a fraction of the model's size (0: no limit)")
+    parser.add_argument("--cross-joints", action="store_true",
+                        help="allow collapses between vertices bound to different joints")
+    parser.add_argument("input")
+    parser.add_argument("output_prefix")
+    args = parser.parse_args()
+
+    ratios = args.ratio or [0.5, 0.25]
+    for ratio in ratios:
+        if not 0.0 < ratio <= 1.0:
+            sys.exit("gltf_lod: ratio %g outside (0, 1]" % ratio)
+
+    for level, ratio in enumerate(ratios, 1):
+        output = "%s_lod%d.glb" % (args.output_prefix, level)
+        before, after, error = write_level(args.input, ratio, args.max_error, args.cross_joints, output)
+        print("gltf_lod: %s: %d -> %d triangles (%.0f%%, target %.0f%%), error %.4f"
+              % (output, before, after, 100.0 * after / max(before, 1), 100.0 * ratio, error))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,274 @@
+#!/usr/bin/env python3
+"""Reorders model geometry for tiny3d's vertex cache and material state.
+
+Last pipeline stage before gltf_to_t3d, run on every model:
+  - primitives of a mesh sharing a material (and vertex layout) are merged,
+    so each material becomes one draw part
+  - triangles are regrouped into batches of at most --cache-size distinct
+    vertices, growing each batch through the triangles that add the fewest
+    new vertices. tiny3d loads vertices into its cache in batches and draws
+    the triangles that index them, so fewer, fuller batches mean fewer
+    vertex loads. Vertices are then stored in first-use order.
+  - each mesh's parts are ordered to start with the texture the previous
+    mesh ended on, and otherwise by material, so neighbouring objects
+    share TMEM contents and render modes
+
+The report counts, in draw order, vertex loads (batch sizes as above),
+material switches (pipe syncs and mode changes) and texture switches
+(TMEM reloads), before and after.
+
+Usage: gltf_optimize.py [--cache-size N] [--report FILE] input.glb output.glb
+"""
+
+import argparse
+import sys
+
+from gltfio import TARGET_ARRAY_BUFFER, Gltf
+
+CACHE_SIZE = 70     # T3D_VERTEX_CACHE_SIZE
+
+
+# ---------------------------------------------------------------- analysis
+
+def texture_key(doc, material):
+    """Textures a material loads into TMEM; fast64 keeps them in extras."""
+    if material is None or material < 0:
+        return None
+    mat = doc["materials"][material]
+    f3d = mat.get("extras", {}).get("f3d_mat", {})
+    names = []
+    for slot in ("tex0", "tex1"):
+        tex = f3d.get(slot, {})
+        if tex.get("tex_set"):
+            names.append(tex.get("tex", {}).get("name"))
+    if not names:
+        pbr = mat.get("pbrMetallicRoughness", {})
+        if "baseColorTexture" in pbr:
+            names.append(pbr["baseColorTexture"]["index"])
+    return tuple(names) if names else None
+
+
+def batch_loads(faces, cache_size):
+    """Vertices loaded when triangles are batched in order into the cache."""
+    loads = 0
+    batch = set()
+    for tri in faces:
+        new = set(tri) - batch
+        if len(batch) + len(new) > cache_size:
+            loads += len(batch)
+            batch = set()
+            new = set(tri)
+        batch |= new
+    return loads + len(batch)
+
+
+def draw_order(gltf):
+    """Mesh indices in the order the scene draws them, once each."""
+    seen = []
+    for node_index, _ in gltf.scene_nodes():
+        mesh = gltf.doc["nodes"][node_index].get("mesh")
+        if mesh is not None and mesh not in seen:
+            seen.append(mesh)
+    return seen
+
+
+def measure(gltf, cache_size):
+    stats = {"parts": 0, "tris": 0, "loads": 0, "material": 0, "texture": 0}
+    last_mat = last_tex = object()
+    for mesh in draw_order(gltf):
+        for prim in gltf.doc["meshes"][mesh]["primitives"]:
+            if prim.get("mode", 4) != 4:
+                continue
+            indices = gltf.primitive_indices(prim)
+            faces = [tuple(indices[t:t + 3]) for t in range(0, len(indices) - 2, 3)]
+            stats["parts"] += 1
+            stats["tris"] += len(faces)
+            stats["loads"] += batch_loads(faces, cache_size)
+
+            material = prim.get("material", -1)
+            texture = texture_key(gltf.doc, material)
+            if material != last_mat:
+                stats["material"] += 1
+            if texture != last_tex and texture is not None:
+                stats["texture"] += 1
+            last_mat, last_tex = material, texture
+    return stats
+
+
+# ------------------------------------------------------------ optimization
+
+def merge_primitives(gltf, mesh):
+    """One primitive per material and vertex layout, in first-seen order."""
+    groups = {}
+    order = []
+    for prim in mesh["primitives"]:
+        if prim.get("mode", 4) != 4 or prim.get("targets"):
+            key = id(prim)
+        else:
+            key = (prim.get("material", -1), tuple(sorted(prim["attributes"])))
+        if key not in groups:
+            groups[key] = []
+            order.append(key)
+        groups[key].append(prim)
+
+    merged = []
+    for key in order:
+        prims = groups[key]
+        if len(prims) == 1:
+            merged.append(prims[0])
+            continue
+
+        streams = {name: [] for name in prims[0]["attributes"]}
+        indices = []
+        for prim in prims:
+            base = len(streams["POSITION"])
+            for name, acc in prim["attributes"].items():
+                streams[name].extend(gltf.read_accessor(acc))
+            indices.extend(base + i for i in gltf.primitive_indices(prim))
+
+        out = dict(prims[0])
+        out["attributes"] = {name: ("raw", values, prims[0]["attributes"][name])
+                             for name, values in streams.items()}
+        out["indices"] = ("raw", indices)
+        merged.append(out)
+    mesh["primitives"] = merged
+
+
+def cluster_faces(faces, positions, cache_size):
+    """Regroups triangles into cache-sized batches of neighbouring triangles."""
+    vertex_faces = {}
+    for f, tri in enumerate(faces):
+        for v in tri:
+            vertex_faces.setdefault(v, []).append(f)
+
+    # Seeds follow a coarse spatial sweep, so a new batch starts next to
+    # where the last one ran out of room
+    def centroid(f):
+        return tuple(sum(positions[v][i] for v in faces[f]) / 3.0 for i in range(3))
+
+    sweep = sorted(range(len(faces)), key=lambda f: centroid(f))
+    done = [False] * len(faces)
+    out = []
+    batch = set()
+    candidates = set()
+    cursor = 0
+
+    while len(out) < len(faces):
+        best, best_new = None, 4
+        for f in candidates:
+            new = sum(1 for v in faces[f] if v not in batch)
+            if new < best_new or (new == best_new and f < best):
+                best, best_new = f, new
+                if new == 0:
+                    break
+
+        if best is not None and len(batch) + best_new > cache_size:
+            # Full: start a new batch from the best neighbour
+            batch = set()
+            best_new = 3
+        elif best is None:
+            while done[sweep[cursor]]:
+                cursor += 1
+            best = sweep[cursor]
+            best_new = sum(1 for v in faces[best] if v not in batch)
+            if len(batch) + best_new > cache_size:
+                batch = set()
+
+        done[best] = True
+        out.append(faces[best])
+        candidates.discard(best)
+        for v in faces[best]:
+            batch.add(v)
+            for f in vertex_faces[v]:
+                if not done[f]:
+                    candidates.add(f)
+    return out
+
+
+def write_primitive(gltf, prim, cache_size):
+    attrs = {}
+    templates = {}
+    for name, acc in prim["attributes"].items():
+        if isinstance(acc, tuple):
+            attrs[name], templates[name] = acc[1], acc[2]
+        else:
+            attrs[name], templates[name] = gltf.read_accessor(acc), acc
+    if isinstance(prim.get("indices"), tuple):
+        indices = prim["indices"][1]
+    else:
+        indices = gltf.primitive_indices(prim)
+
+    faces = [tuple(indices[t:t + 3]) for t in range(0, len(indices) - 2, 3)]
+    faces = cluster_faces(faces, attrs["POSITION"], cache_size)
+
+    # Vertices in first-use order
+    remap = {}
+    new_indices = []
+    for tri in faces:
+        for v in tri:
+            if v not in remap:
+                remap[v] = len(remap)
+            new_indices.append(remap[v])
+    order = sorted(remap, key=remap.get)
+
+    for name, values in attrs.items():
+        kept = [values[v] for v in order]
+        prim["attributes"][name] = gltf.add_like(kept, templates[name], TARGET_ARRAY_BUFFER)
+        if name == "POSITION":
+            acc = gltf.doc["accessors"][prim["attributes"][name]]
+            acc["min"] = [min(p[i] for p in kept) for i in range(3)]
+            acc["max"] = [max(p[i] for p in kept) for i in range(3)]
+    prim["indices"] = gltf.add_indices(new_indices)
+
+
+def order_parts(gltf):
+    """Orders each mesh's parts so consecutive meshes share a texture at the seam."""
+    last_tex = None
+    for mesh_index in draw_order(gltf):
+        prims = gltf.doc["meshes"][mesh_index]["primitives"]
+        prims.sort(key=lambda p: (texture_key(gltf.doc, p.get("material", -1)) != last_tex,
+                                  p.get("material", -1)))
+        if prims:
+            last_tex = texture_key(gltf.doc, prims[-1].get("material", -1))
+
+
+def optimize(gltf, cache_size):
+    for mesh in gltf.doc.get("meshes", []):
+        merge_primitives(gltf, mesh)
+        for prim in mesh["primitives"]:
+            if prim.get("mode", 4) == 4:
+                write_primitive(gltf, prim, cache_size)
+    order_parts(gltf)
+    gltf.compact()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cache-size", type=int, default=CACHE_SIZE, help="vertices per cache batch")
+    parser.add_argument("--report", help="also write the report to this file")
+    parser.add_argument("input")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    if args.cache_size < 3:
+        sys.exit("gltf_optimize: cache size %d can't hold a triangle" % args.cache_size)
+
+    gltf = Gltf.load(args.input)
+    before = measure(gltf, args.cache_size)
+    optimize(gltf, args.cache_size)
+    after = measure(gltf, args.cache_size)
+    gltf.save(args.output)
+
+    lines = ["gltf_optimize: %s" % args.output]
+    for key, label in (("parts", "draw parts"), ("tris", "triangles"), ("loads", "vertex loads"),
+                       ("material", "material switches"), ("texture", "texture switches")):
+        lines.append("  %-18s %7d -> %7d" % (label, before[key], after[key]))
+    report = "\n".join(lines) + "\n"
+    sys.stdout.write(report)
+    if args.report:
+        with open(args.report, "w") as f:
+            f.write(report)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,329 @@
+"""Minimal glTF 2.0 reader/writer shared by the asset pipeline tools.
+
+Only the Python standard library is used so the tools run anywhere the
+libdragon toolchain does. Supports .glb and .gltf (embedded or external
+buffers) input, always writes .glb.
+"""
+
+import base64
+import json
+import math
+import os
+import struct
+
+GLB_MAGIC = 0x46546C67
+CHUNK_JSON = 0x4E4F534A
+CHUNK_BIN = 0x004E4942
+
+# componentType -> (struct code, byte size)
+COMPONENT_TYPES = {
+    5120: ("b", 1),
+    5121: ("B", 1),
+    5122: ("h", 2),
+    5123: ("H", 2),
+    5125: ("I", 4),
+    5126: ("f", 4),
+}
+
+TYPE_SIZES = {
+    "SCALAR": 1,
+    "VEC2": 2,
+    "VEC3": 3,
+    "VEC4": 4,
+    "MAT2": 4,
+    "MAT3": 9,
+    "MAT4": 16,
+}
+
+FLOAT = 5126
+UNSIGNED_BYTE = 5121
+UNSIGNED_SHORT = 5123
+UNSIGNED_INT = 5125
+
+TARGET_ARRAY_BUFFER = 34962
+TARGET_ELEMENT_ARRAY_BUFFER = 34963
+
+
+class Gltf:
+    def __init__(self, doc, blob):
+        self.doc = doc
+        self.bin = bytearray(blob)
+
+    # ------------------------------------------------------------------ I/O
+
+    @classmethod
+    def load(cls, path):
+        with open(path, "rb") as f:
+            data = f.read()
+
+        if len(data) >= 12 and struct.unpack_from("<I", data, 0)[0] == GLB_MAGIC:
+            offset = 12
+            doc, blob = None, b""
+            while offset < len(data):
+                length, kind = struct.unpack_from("<II", data, offset)
+                chunk = data[offset + 8:offset + 8 + length]
+                if kind == CHUNK_JSON:
+                    doc = json.loads(chunk.decode("utf-8"))
+                elif kind == CHUNK_BIN:
+                    blob = chunk
+                offset += 8 + length
+            gltf = cls(doc, blob)
+        else:
+            doc = json.loads(data.decode("utf-8"))
+            gltf = cls(doc, b"")
+            gltf._inline_external_buffers(os.path.dirname(path))
+        return gltf
+
+    def _inline_external_buffers(self, base_dir):
+        # Merge every buffer into the single GLB binary chunk
+        blobs = []
+        for buf in self.doc.get("buffers", []):
+            uri = buf.get("uri", "")
+            if uri.startswith("data:"):
+                blobs.append(base64.b64decode(uri.split(",", 1)[1]))
+            else:
+                with open(os.path.join(base_dir, uri), "rb") as f:
+                    blobs.append(f.read())
+
+        offsets, merged = [], bytearray()
+        for blob in blobs:
+            offsets.append(len(merged))
+            merged += blob
+            merged += b"\0" * (-len(merged) % 4)
+
+        for view in self.doc.get("bufferViews", []):
+            view["byteOffset"] = view.get("byteOffset", 0) + offsets[view["buffer"]]
+            view["buffer"] = 0
+        self.doc["buffers"] = [{"byteLength": len(merged)}]
+        self.bin = merged
+
+    def save(self, path):
+        self.bin += b"\0" * (-len(self.bin) % 4)
+        self.doc["buffers"] = [{"byteLength": len(self.bin)}]
+        js = json.dumps(self.doc, separators=(",", ":")).encode("utf-8")
+        js += b" " * (-len(js) % 4)
+
+        total = 12 + 8 + len(js) + 8 + len(self.bin)
+        with open(path, "wb") as f:
+            f.write(struct.pack("<III", GLB_MAGIC, 2, total))
+            f.write(struct.pack("<II", len(js), CHUNK_JSON))
+            f.write(js)
+            f.write(struct.pack("<II", len(self.bin), CHUNK_BIN))
+            f.write(self.bin)
+
+    # ------------------------------------------------------------ accessors
+
+    def read_accessor(self, index):
+        """Returns a list of tuples, one per element, normalized ints as floats."""
+        acc = self.doc["accessors"][index]
+        code, size = COMPONENT_TYPES[acc["componentType"]]
+        ncomp = TYPE_SIZES[acc["type"]]
+        count = acc["count"]
+
+        if "bufferView" not in acc:
+            values = [tuple([0] * ncomp) for _ in range(count)]
+        else:
+            view = self.doc["bufferViews"][acc["bufferView"]]
+            base = view.get("byteOffset", 0) + acc.get("byteOffset", 0)
+            stride = view.get("byteStride", 0) or size * ncomp
+            fmt = "<" + code * ncomp
+            values = [struct.unpack_from(fmt, self.bin, base + i * stride) for i in range(count)]
+
+        if acc.get("normalized"):
+            scale = float((1 << (size * 8 - (1 if code.islower() else 0))) - 1)
+            values = [tuple(max(v / scale, -1.0) for v in e) for e in values]
+        return values
+
+    def add_accessor(self, values, component_type, acc_type, target=None, normalized=False, minmax=False):
+        """Appends tightly packed data and returns the new accessor index."""
+        code, size = COMPONENT_TYPES[component_type]
+        ncomp = TYPE_SIZES[acc_type]
+
+        if normalized:
+            scale = float((1 << (size * 8 - (1 if code.islower() else 0))) - 1)
+            values = [tuple(int(round(v * scale)) for v in e) for e in values]
+
+        self.bin += b"\0" * (-len(self.bin) % 4)
+        offset = len(self.bin)
+        fmt = "<" + code * ncomp
+        for e in values:
+            self.bin += struct.pack(fmt, *e)
+
+        view = {"buffer": 0, "byteOffset": offset, "byteLength": len(self.bin) - offset}
+        if target is not None:
+            view["target"] = target
+        self.doc.setdefault("bufferViews", []).append(view)
+
+        acc = {
+            "bufferView": len(self.doc["bufferViews"]) - 1,
+            "componentType": component_type,
+            "count": len(values),
+            "type": acc_type,
+        }
+        if normalized:
+            acc["normalized"] = True
+        if minmax and values:
+            acc["min"] = [min(e[i] for e in values) for i in range(ncomp)]
+            acc["max"] = [max(e[i] for e in values) for i in range(ncomp)]
+        self.doc.setdefault("accessors", []).append(acc)
+        return len(self.doc["accessors"]) - 1
+
+    def add_like(self, values, template_index, target=None):
+        """Appends data using the encoding of an existing accessor."""
+        tmpl = self.doc["accessors"][template_index]
+        return self.add_accessor(values, tmpl["componentType"], tmpl["type"], target,
+                                 tmpl.get("normalized", False), "min" in tmpl)
+
+    def add_indices(self, indices):
+        ctype = UNSIGNED_SHORT if (not indices or max(indices) < 0xFFFF) else UNSIGNED_INT
+        return self.add_accessor([(i,) for i in indices], ctype, "SCALAR", TARGET_ELEMENT_ARRAY_BUFFER)
+
+    # -------------------------------------------------------------- meshes
+
+    def primitive_indices(self, prim):
+        if "indices" in prim:
+            return [e[0] for e in self.read_accessor(prim["indices"])]
+        count = self.doc["accessors"][prim["attributes"]["POSITION"]]["count"]
+        return list(range(count))
+
+    def scene_nodes(self):
+        """Yields (node_index, world_matrix) for the default scene, depth first."""
+        scenes = self.doc.get("scenes", [])
+        if not scenes:
+            return
+        roots = scenes[self.doc.get("scene", 0)].get("nodes", [])
+        stack = [(n, mat4_identity()) for n in reversed(roots)]
+        while stack:
+            index, parent = stack.pop()
+            node = self.doc["nodes"][index]
+            world = mat4_mul(parent, node_local_matrix(node))
+            yield index, world
+            for child in reversed(node.get("children", [])):
+                stack.append((child, world))
+
+    # ---------------------------------------------------------- compaction
+
+    def compact(self):
+        """Drops accessors and buffer views nothing references any more."""
+        doc = self.doc
+        used = set()
+
+        def mark(index):
+            if index is not None:
+                used.add(index)
+
+        for mesh in doc.get("meshes", []):
+            for prim in mesh["primitives"]:
+                for a in prim["attributes"].values():
+                    mark(a)
+                mark(prim.get("indices"))
+                for target in prim.get("targets", []):
+                    for a in target.values():
+                        mark(a)
+        for skin in doc.get("skins", []):
+            mark(skin.get("inverseBindMatrices"))
+        for anim in doc.get("animations", []):
+            for sampler in anim["samplers"]:
+                mark(sampler["input"])
+                mark(sampler["output"])
+
+        acc_map = {}
+        accessors = []
+        for old in sorted(used):
+            acc_map[old] = len(accessors)
+            accessors.append(doc["accessors"][old])
+
+        view_used = set(a["bufferView"] for a in accessors if "bufferView" in a)
+        view_used |= set(img["bufferView"] for img in doc.get("images", []) if "bufferView" in img)
+
+        view_map = {}
+        views = []
+        blob = bytearray()
+        for old in sorted(view_used):
+            view = dict(doc["bufferViews"][old])
+            start = view.get("byteOffset", 0)
+            blob += b"\0" * (-len(blob) % 4)
+            view["byteOffset"] = len(blob)
+            view["buffer"] = 0
+            blob += self.bin[start:start + view["byteLength"]]
+            view_map[old] = len(views)
+            views.append(view)
+
+        for acc in accessors:
+            if "bufferView" in acc:
+                acc["bufferView"] = view_map[acc["bufferView"]]
+        for img in doc.get("images", []):
+            if "bufferView" in img:
+                img["bufferView"] = view_map[img["bufferView"]]
+
+        for mesh in doc.get("meshes", []):
+            for prim in mesh["primitives"]:
+                prim["attributes"] = {k: acc_map[v] for k, v in prim["attributes"].items()}
+                if "indices" in prim:
+                    prim["indices"] = acc_map[prim["indices"]]
+                for target in prim.get("targets", []):
+                    for k in target:
+                        target[k] = acc_map[target[k]]
+        for skin in doc.get("skins", []):
+            if "inverseBindMatrices" in skin:
+                skin["inverseBindMatrices"] = acc_map[skin["inverseBindMatrices"]]
+        for anim in doc.get("animations", []):
+            for sampler in anim["samplers"]:
+                sampler["input"] = acc_map[sampler["input"]]
+                sampler["output"] = acc_map[sampler["output"]]
+
+        doc["accessors"] = accessors
+        doc["bufferViews"] = views
+        self.bin = blob
+
+
+# ------------------------------------------------------------------ math
+
+def mat4_identity():
+    return [1.0 if r == c else 0.0 for c in range(4) for r in range(4)]
+
+
+def mat4_mul(a, b):
+    """Column-major 4x4 multiply, returns a * b."""
+    out = [0.0] * 16
+    for c in range(4):
+        for r in range(4):
+            out[c * 4 + r] = sum(a[k * 4 + r] * b[c * 4 + k] for k in range(4))
+    return out
+
+
+def node_local_matrix(node):
+    if "matrix" in node:
+        return list(node["matrix"])
+    tx, ty, tz = node.get("translation", [0.0, 0.0, 0.0])
+    qx, qy, qz, qw = node.get("rotation", [0.0, 0.0, 0.0, 1.0])
+    sx, sy, sz = node.get("scale", [1.0, 1.0, 1.0])
+    return [
+        (1 - 2 * (qy * qy + qz * qz)) * sx, (2 * (qx * qy + qz * qw)) * sx, (2 * (qx * qz - qy * qw)) * sx, 0.0,
+        (2 * (qx * qy - qz * qw)) * sy, (1 - 2 * (qx * qx + qz * qz)) * sy, (2 * (qy * qz + qx * qw)) * sy, 0.0,
+        (2 * (qx * qz + qy * qw)) * sz, (2 * (qy * qz - qx * qw)) * sz, (1 - 2 * (qx * qx + qy * qy)) * sz, 0.0,
+        tx, ty, tz, 1.0,
+    ]
+
+
+def transform_point(m, p):
+    x, y, z = p[0], p[1], p[2]
+    return (m[0] * x + m[4] * y + m[8] * z + m[12],
+            m[1] * x + m[5] * y + m[9] * z + m[13],
+            m[2] * x + m[6] * y + m[10] * z + m[14])
+
+
+def transform_normal(m, n):
+    # Adequate for the rotation + uniform scale transforms exported from Blender
+    x, y, z = n[0], n[1], n[2]
+    v = (m[0] * x + m[4] * y + m[8] * z,
+         m[1] * x + m[5] * y + m[9] * z,
+         m[2] * x + m[6] * y + m[10] * z)
+    return normalize(v)
+
+
+def normalize(v):
+    length = math.sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2])
+    if length < 1e-12:
+        return (0.0, 0.0, 0.0)
+    return (v[0] / length, v[1] / length, v[2] / length)
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""Packs a level's scene description and baked data into one binary file.
+
+The scene description is text, one entry per line ('#' starts a comment):
+
+    camera DISTANCE HEIGHT        third-person camera behind the player
+    lights FILE                   light descriptor (see gltf_bake_light.py),
+                                  relative to the description
+    spawn X Y Z YAW               player start, yaw in degrees
+    npc X Y Z YAW CLIP            crowd member playing CLIP
+    sound X Y Z SAMPLE            looping ambient sound emitter
+
+The output is big-endian and laid out so the game uses it in place after
+a single load, resolving section offsets to pointers (code/level.h):
+
+  char magic[4] "LEVL", u32 version, u32 size
+  f32 camera_distance, camera_height
+  u8 ambient[4]
+  2 x { u8 color[4]; f32 dir[3] }            directional lights
+  4 x { u32 offset; u32 count }              entities, lights, segments, collision
+  entities:  count x { u32 type; f32 pos[3]; f32 yaw; char name[16] }
+  lights:    count x { f32 pos[3]; u8 color[4]; f32 radius }
+  segments:  the .segs manifest of gltf_chunk.py, count in bytes
+  collision: the .col grid of gltf_collision.py, count in bytes
+
+Offsets are from the start of the file, sections are 8-byte aligned.
+
+Usage: level_pack.py [--segments FILE] [--collision FILE] scene.txt output.level
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+
+from gltf_bake_light import parse_lights
+
+LEVEL_MAGIC = b"LEVL"
+LEVEL_VERSION = 1
+LEVEL_NAME_LEN = 16
+LEVEL_DIRECTIONAL = 2           # LIGHTS_DIRECTIONAL
+
+ENTITY_SPAWN = 0
+ENTITY_NPC = 1
+ENTITY_SOUND = 2
+
+HEADER_SIZE = 4 + 4 * 4 + 4 + LEVEL_DIRECTIONAL * 16 + 4 * 8
+
+
+def fail(path, number, message):
+    sys.exit("level_pack: %s:%d: %s" % (path, number, message))
+
+
+def parse_scene(path):
+    scene = {"camera": (200.0, 200.0), "lights": [], "entities": []}
+    has_spawn = False
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            words = line.split("#", 1)[0].split()
+            if not words:
+                continue
+            kind, args = words[0], words[1:]
+            try:
+                if kind == "camera" and len(args) == 2:
+                    scene["camera"] = tuple(float(a) for a in args)
+                elif kind == "lights" and len(args) == 1:
+                    scene["lights"] = parse_lights(os.path.join(os.path.dirname(path), args[0]))
+                elif kind == "spawn" and len(args) == 4:
+                    if has_spawn:
+                        fail(path, number, "second spawn point")
+                    has_spawn = True
+                    values = [float(a) for a in args]
+                    scene["entities"].append((ENTITY_SPAWN, values[:3], math.radians(values[3]), ""))
+                elif kind == "npc" and len(args) == 5:
+                    values = [float(a) for a in args[:4]]
+                    if len(args[4]) >= LEVEL_NAME_LEN:
+                        fail(path, number, "clip name '%s' too long" % args[4])
+                    scene["entities"].append((ENTITY_NPC, values[:3], math.radians(values[3]), args[4]))
+                elif kind == "sound" and len(args) == 4:
+                    values = [float(a) for a in args[:3]]
+                    if len(args[3]) >= LEVEL_NAME_LEN:
+                        fail(path, number, "sample name '%s' too long" % args[3])
+                    scene["entities"].append((ENTITY_SOUND, values, 0.0, args[3]))
+                else:
+                    fail(path, number, "bad entry '%s'" % line.strip())
+            except ValueError:
+                fail(path, number, "bad number in '%s'" % line.strip())
+    if not has_spawn:
+        sys.exit("level_pack: %s: no spawn point" % path)
+    return scene
+
+
+def color_bytes(color):
+    return bytes(min(255, int(round(c * 255.0))) for c in color) + b"\xff"
+
+
+def align(out, alignment=8):
+    out += b"\0" * (-len(out) % alignment)
+
+
+def pack(scene, segments, collision):
+    ambient = (0.0, 0.0, 0.0)
+    directional = []
+    points = []
+    for light in scene["lights"]:
+        if light[0] == "ambient":
+            ambient = tuple(min(1.0, a + c) for a, c in zip(ambient, light[1]))
+        elif light[0] == "directional":
+            directional.append(light)
+        else:
+            points.append(light)
+    if len(directional) > LEVEL_DIRECTIONAL:
+        sys.exit("level_pack: %d directional lights, the runtime has %d" % (len(directional), LEVEL_DIRECTIONAL))
+
+    body = bytearray(HEADER_SIZE)
+    sections = []
+
+    align(body)
+    start = len(body)
+    for kind, pos, yaw, name in scene["entities"]:
+        body += struct.pack(">I4f", kind, pos[0], pos[1], pos[2], yaw)
+        body += name.encode("ascii").ljust(LEVEL_NAME_LEN, b"\0")
+    sections.append((start, len(scene["entities"])))
+
+    align(body)
+    start = len(body)
+    for _, color, pos, radius in points:
+        body += struct.pack(">3f", *pos) + color_bytes(color) + struct.pack(">f", radius)
+    sections.append((start, len(points)))
+
+    for blob in (segments, collision):
+        align(body)
+        start = len(body)
+        body += blob
+        sections.append((start if blob else 0, len(blob)))
+    align(body)
+
+    header = bytearray()
+    header += LEVEL_MAGIC
+    header += struct.pack(">I", LEVEL_VERSION)
+    header += struct.pack(">I", len(body))
+    header += struct.pack(">2f", *scene["camera"])
+    header += color_bytes(ambient)
+    for i in range(LEVEL_DIRECTIONAL):
+        if i < len(directional):
+            header += color_bytes(directional[i][1]) + struct.pack(">3f", *directional[i][2])
+        else:
+            header += color_bytes((0.0, 0.0, 0.0)) + struct.pack(">3f", 0.0, -1.0, 0.0)
+    for offset, count in sections:
+        header += struct.pack(">II", offset, count)
+    assert len(header) == HEADER_SIZE
+    body[:HEADER_SIZE] = header
+    return body, len(points)
+
+
+def read_blob(path, magic):
+    if not path:
+        return b""
+    with open(path, "rb") as f:
+        blob = f.read()
+    if blob[:4] != magic:
+        sys.exit("level_pack: %s is not a %s file" % (path, magic.decode()))
+    return blob
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--segments", help="segment manifest from gltf_chunk.py")
+    parser.add_argument("--collision", help="collision grid from gltf_collision.py")
+    parser.add_argument("scene")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    scene = parse_scene(args.scene)
+    segments = read_blob(args.segments, b"SEGS")
+    collision = read_blob(args.collision, b"COLL")
+    data, light_count = pack(scene, segments, collision)
+    with open(args.output, "wb") as f:
+        f.write(data)
+    print("level_pack: %s: %d entities, %d point lights, %d bytes of segments, %d bytes of collision, %d bytes" %
+          (args.output, len(scene["entities"]), light_count, len(segments), len(collision), len(data)))
+
+
+if __name__ == "__main__":
+    main()
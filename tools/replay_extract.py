@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Rebuilds a replay stream from the debug log of a recording run.
+
+A recording build (REPLAY_MODE=1) dumps the stream to the log as
+"REPLAY <hex>" lines ending with "REPLAY END" (see code/replay.c). Save the
+result as assets/replay.rpl and a playback build (REPLAY_MODE=2) will find
+it at rom:/replay.rpl.
+
+Usage: replay_extract.py debug.log assets/replay.rpl
+"""
+
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct(">4sHHIII")
+REPEAT_FLAG = 0x80
+
+
+def count_ticks(data):
+    """Decodes the stream far enough to count the ticks it covers."""
+    ticks, offset = 0, 0
+    while offset < len(data):
+        code = data[offset]
+        offset += 1
+        if code & REPEAT_FLAG:
+            ticks += code & 0x7F
+            continue
+        offset += 2 if code & 1 else 0
+        offset += bin(code & 0x7E).count("1")
+        ticks += 1
+    return ticks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    # The log may hold several recordings, the last complete one wins
+    stream, current = None, None
+    with open(args.log, "r", errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("REPLAY "):
+                continue
+            payload = line[len("REPLAY "):]
+            if payload == "END":
+                stream, current = current, None
+            elif payload.startswith(b"RPLY".hex()):
+                current = bytearray.fromhex(payload)
+            elif current is not None:
+                current += bytes.fromhex(payload)
+
+    if not stream:
+        sys.exit("replay_extract: no REPLAY dump in %s" % args.log)
+
+    magic, version, tick_hz, seed, tick_count, data_size = HEADER.unpack_from(stream)
+    if magic != b"RPLY":
+        sys.exit("replay_extract: dump doesn't start with a replay header")
+    data = stream[HEADER.size:HEADER.size + data_size]
+    if len(data) != data_size:
+        sys.exit("replay_extract: dump truncated, %d of %d bytes" % (len(data), data_size))
+    if count_ticks(data) != tick_count:
+        sys.exit("replay_extract: stream decodes to %d ticks, header says %d" % (count_ticks(data), tick_count))
+
+    with open(args.output, "wb") as f:
+        f.write(stream[:HEADER.size + data_size])
+    print("replay_extract: %d ticks at %d Hz (%.1f s), seed %08x, %d bytes" %
+          (tick_count, tick_hz, tick_count / float(tick_hz), seed, HEADER.size + data_size))
+
+
+if __name__ == "__main__":
+    main()
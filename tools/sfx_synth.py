@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Synthesizes the placeholder sound effects into 16-bit mono WAV files.
+
+Each sound is a few lines of enveloped noise and sine sweeps, generated
+deterministically so builds are reproducible. The WAVs go through
+audioconv64 like any other sample (makefile, [SFX] rule):
+
+    step    footstep, a short damped noise burst
+    jump    rising sweep
+    land    low thump
+    drip    water drop plinks, loops
+
+Usage: sfx_synth.py NAME output.wav
+"""
+
+import argparse
+import math
+import random
+import struct
+import sys
+import wave
+
+RATE = 22050
+
+
+def envelope(t, attack, decay):
+    # Linear attack, exponential decay
+    if t < attack:
+        return t / attack
+    return math.exp(-(t - attack) / decay)
+
+
+def sweep(samples, start, duration, f0, f1, gain, decay):
+    phase = 0.0
+    first = int(start * RATE)
+    for i in range(int(duration * RATE)):
+        t = i / RATE
+        freq = f0 + (f1 - f0) * t / duration
+        phase += 2.0 * math.pi * freq / RATE
+        if first + i < len(samples):
+            samples[first + i] += gain * envelope(t, 0.002, decay) * math.sin(phase)
+
+
+def noise(samples, start, duration, gain, decay, smoothing, rng):
+    # One-pole low-pass over white noise, higher smoothing is duller
+    first = int(start * RATE)
+    value = 0.0
+    for i in range(int(duration * RATE)):
+        value += (rng.uniform(-1.0, 1.0) - value) * (1.0 - smoothing)
+        if first + i < len(samples):
+            samples[first + i] += gain * envelope(i / RATE, 0.003, decay) * value
+
+
+def synth(name):
+    rng = random.Random(name)
+    if name == "step":
+        samples = [0.0] * int(0.09 * RATE)
+        noise(samples, 0.0, 0.09, 1.6, 0.018, 0.85, rng)
+        sweep(samples, 0.0, 0.05, 140.0, 80.0, 0.4, 0.015)
+    elif name == "jump":
+        samples = [0.0] * int(0.2 * RATE)
+        sweep(samples, 0.0, 0.2, 220.0, 640.0, 0.5, 0.08)
+        noise(samples, 0.0, 0.08, 0.5, 0.02, 0.6, rng)
+    elif name == "land":
+        samples = [0.0] * int(0.16 * RATE)
+        sweep(samples, 0.0, 0.16, 95.0, 45.0, 0.8, 0.05)
+        noise(samples, 0.0, 0.1, 1.2, 0.025, 0.9, rng)
+    elif name == "drip":
+        samples = [0.0] * int(1.6 * RATE)
+        sweep(samples, 0.0, 0.15, 1500.0, 900.0, 0.5, 0.03)
+        sweep(samples, 0.9, 0.12, 1300.0, 800.0, 0.3, 0.025)
+    else:
+        sys.exit("sfx_synth: unknown sound '%s'" % name)
+
+    peak = max(abs(s) for s in samples) or 1.0
+    scale = 0.9 * 32767.0 / peak
+    return b"".join(struct.pack("<h", int(round(s * scale))) for s in samples)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("name")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    frames = synth(args.name)
+    with wave.open(args.output, "wb") as out:
+        out.setnchannels(1)
+        out.setsampwidth(2)
+        out.setframerate(RATE)
+        out.writeframes(frames)
+
+
+if __name__ == "__main__":
+    main()